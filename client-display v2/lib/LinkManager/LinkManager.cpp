@@ -0,0 +1,91 @@
+#include "LinkManager.h"
+
+const char* LinkManager::stateName(LinkState s) {
+  switch (s) {
+    case LINK_DOWN: return "down";
+    case LINK_DIRECT: return "direct";
+    case LINK_SCANNING: return "scanning";
+    case LINK_CONNECTING: return "connecting";
+    case LINK_UP: return "up";
+  }
+  return "?";
+}
+
+void LinkManager::enter(LinkState next) {
+  LinkState previous = current;
+  current = next;
+  if (listener != nullptr && previous != next) {
+    listener(previous, next);
+  }
+}
+
+void LinkManager::scan() {
+  scanCount++;
+  driver.startScan();
+  enter(LINK_SCANNING);
+}
+
+// Ends a connect attempt either way
+void LinkManager::attempt(bool ok, uint32_t nowMs) {
+  if (ok && driver.connected()) {
+    connectCount++;
+    reconnectMs = nowMs - downSinceMs;
+    enter(LINK_UP);
+    return;
+  }
+  failureCount++;
+  driver.release();
+  scan();
+}
+
+void LinkManager::tick(uint32_t nowMs) {
+  switch (current) {
+    case LINK_DOWN:
+      if (driver.connected()) {
+        // An attempt that timed out and then completed anyway
+        strayCount++;
+        driver.release();
+      }
+      if (!directTried && driver.haveCachedServer()) {
+        directTried = true;
+        enter(LINK_DIRECT);
+        attempt(driver.connectCached(config.connectTimeoutMs), nowMs);
+      } else {
+        scan();
+      }
+      break;
+
+    case LINK_SCANNING:
+      if (driver.connected()) {
+        strayCount++;
+        driver.release();
+      }
+      if (driver.scanRunning()) {
+        break;
+      }
+      if (driver.scanMatched()) {
+        enter(LINK_CONNECTING);
+        attempt(driver.connectMatched(config.connectTimeoutMs), nowMs);
+      } else {
+        // A whole window without a server; it may be back on its old address
+        directTried = false;
+        enter(LINK_DOWN);
+      }
+      break;
+
+    case LINK_DIRECT:
+    case LINK_CONNECTING:
+      // Only passed through inside tick()
+      break;
+
+    case LINK_UP:
+      if (!driver.connected()) {
+        dropCount++;
+        driver.release();
+        directTried = false;
+        downSinceMs = nowMs;
+        enter(LINK_DOWN);
+      }
+      break;
+  }
+}
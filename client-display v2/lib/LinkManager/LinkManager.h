@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+
+// The BLE side of the display's link to the sensing node. connectCached() and
+// connectMatched() may block for one connect attempt (bounded by timeoutMs); the
+// rest return quickly. A failed connect may leave the client half set up, and
+// release() puts it back: it must be safe to call in any state, any number of times.
+class LinkDriver {
+public:
+  virtual ~LinkDriver() {}
+
+  virtual bool haveCachedServer() = 0;
+  // Connect, discover and subscribe; false on any step failing
+  virtual bool connectCached(uint32_t timeoutMs) = 0;
+  virtual bool connectMatched(uint32_t timeoutMs) = 0;
+  // Background scan that stops by itself on the first server it sees
+  virtual void startScan() = 0;
+  virtual bool scanRunning() = 0;
+  virtual bool scanMatched() = 0;
+  virtual bool connected() = 0;
+  // Disconnects and drops subscriptions
+  virtual void release() = 0;
+};
+
+enum LinkState : uint8_t {
+  LINK_DOWN,
+  LINK_DIRECT,      // Connecting to the cached address
+  LINK_SCANNING,
+  LINK_CONNECTING,  // Connecting to what the scan found
+  LINK_UP,
+};
+
+// Keeps the display connected: a direct connect to the last server first, then
+// background scans until one is found, one step per tick(). Every way out of a
+// connect attempt or of LINK_UP goes through release(), so a flaky link can't
+// leave half-open connections behind, and a connection that completes after its
+// attempt timed out is released too.
+class LinkManager {
+public:
+  struct Config {
+    uint32_t connectTimeoutMs = 2500; // Covers the server's 1.1 s idle advertising interval
+  };
+
+  typedef void (*Listener)(LinkState from, LinkState to);
+
+  LinkManager(LinkDriver& driver) : driver(driver) {}
+  LinkManager(LinkDriver& driver, const Config& config) : driver(driver), config(config) {}
+
+  void setListener(Listener fn) { listener = fn; }
+  void tick(uint32_t nowMs);
+
+  LinkState state() const { return current; }
+  bool up() const { return current == LINK_UP; }
+  // Link down to LINK_UP for the last reconnect
+  uint32_t lastReconnectMs() const { return reconnectMs; }
+  uint32_t connects() const { return connectCount; }
+  uint32_t failures() const { return failureCount; }
+  uint32_t drops() const { return dropCount; }
+  uint32_t scans() const { return scanCount; }
+  uint32_t strays() const { return strayCount; }
+
+  static const char* stateName(LinkState s);
+
+private:
+  void enter(LinkState next);
+  void attempt(bool ok, uint32_t nowMs);
+  void scan();
+
+  LinkDriver& driver;
+  Config config;
+  Listener listener = nullptr;
+
+  LinkState current = LINK_DOWN;
+  bool directTried = false; // Once per outage and after each empty scan
+  uint32_t downSinceMs = 0;
+  uint32_t reconnectMs = 0;
+  uint32_t connectCount = 0;
+  uint32_t failureCount = 0;
+  uint32_t dropCount = 0;
+  uint32_t scanCount = 0;
+  uint32_t strayCount = 0;
+};
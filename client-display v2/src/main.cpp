@@ -7,6 +7,12 @@
 #include <Adafruit_SSD1306.h>
 #include <FastLED.h>
 #include <AccelStepper.h>
+#include <RehabProtocol.h>
+#include <DeferredLog.h>
+#include <SpscQueue.h>
+#include <Preferences.h>
+#include <LinkManager.h>
+#include <esp_heap_caps.h>
 
 #define SCREEN_WIDTH 128
 #define SCREEN_HEIGHT 64
@@ -24,9 +30,34 @@ CRGB leds[NUM_LEDS];
 #define MOTOR_PIN_3 3
 #define MOTOR_PIN_4 4
 AccelStepper stepper(AccelStepper::FULL4WIRE, MOTOR_PIN_1, MOTOR_PIN_3, MOTOR_PIN_2, MOTOR_PIN_4);
+#define STEPPER_MAX_SPEED 5000   // steps/s
+#define STEPPER_ACCELERATION 500 // steps/s^2
+
+// Steps are generated by their own task at the top priority on the app core, woken
+// by a hardware timer, so BLE scans in loop() and I2C display refreshes can't stall
+// the pulse train. AccelStepper uses float math, which isn't allowed in an ISR, so
+// the ISR only wakes the task. The timer stops while the motor is at its target.
+#define STEPPER_TICK_US 40       // 25 kHz; max speed is a whole number of ticks per step
+#define STEPPER_TASK_PRIORITY (configMAX_PRIORITIES - 1)
+hw_timer_t* stepperTimer = nullptr;
+TaskHandle_t stepperTaskHandle = nullptr;
+volatile uint32_t lastStepperTickMicros = 0;
+std::atomic<bool> stepperIdle{true}; // Timer stopped; a new target has to wake the task
+
+// Written by the stepper task, read for the stats line
+struct StepTiming {
+    uint32_t steps = 0;
+    uint32_t ticks = 0;
+    uint32_t missedTicks = 0;        // Ticks that passed while the task was held off
+    uint32_t maxTickLateMicros = 0;  // Timer interrupt to the task running
+    uint64_t totalTickLateMicros = 0;
+    uint32_t maxStepErrorMicros = 0; // Step interval against the one AccelStepper asked for
+    uint64_t totalStepErrorMicros = 0;
+    uint32_t timedSteps = 0;         // Steps with a previous step to measure from
+};
+StepTiming stepTiming;
 
-#define SERVICE_UUID        "49c1c51a-6e2c-48a4-8fde-3e9a02711aed" // Replace with your UUID
-#define CHARACTERISTIC_UUID "bbd6bbb3-318c-4c13-b4f9-d60f6aca4a2e" // Replace with your UUID
+// SERVICE_UUID and CHARACTERISTIC_UUID come from the shared RehabProtocol library
 
 // #define SERVICE_UUID        "ff77370f-5ca6-42ae-aa47-99ae6fd92793" // Replace with your unique UUID
 // #define CHARACTERISTIC_UUID "bf683ee2-db03-40a7-abba-e9a1e9dfcf12" // Replace with your unique UUID
@@ -35,189 +66,488 @@ AccelStepper stepper(AccelStepper::FULL4WIRE, MOTOR_PIN_1, MOTOR_PIN_3, MOTOR_PI
 // bool displayMode = false; // false for angle, true for bend count
 
 // Bluetooth Low Energy (BLE) variables
-static boolean isConnected = false;
 static boolean connected = false;
 static boolean doScan = false;
 // static BLERemoteCharacteristic* pRemoteCharacteristic;
 // static BLEAdvertisedDevice* myDevice;
 
-BLERemoteCharacteristic* pRemoteCharacteristic = nullptr;
+// One client and one callbacks object for the whole run; every connect reuses them
+BLEClient* pClient = nullptr;
+BLERemoteCharacteristic* pRemoteCharacteristic = nullptr; // Set while subscribed
+
+// Reconnecting: a direct connect to the last server's address first, which the
+// controller completes on its next advertisement. If that fails, a background scan
+// runs and the first advertisement with our service is connected to straight away.
+// The address is kept in NVS so a reboot of either side takes the fast path too.
+#define SERVER_NVS_NAMESPACE "display"
+#define SERVER_NVS_KEY "server"
+#define SCAN_WINDOW_S 5                // One background scan; it restarts until something is found
+#define RELEASE_WAIT_MS 500            // Longest release() waits for a disconnect to finish
+Preferences prefs;
+std::string cachedServer;               // "" until a server has been connected to
+uint8_t cachedServerType = BLE_ADDR_TYPE_PUBLIC;
+std::atomic<bool> scanMatchedFlag{false}; // Set by onResult(), taken by loop()
+std::atomic<bool> scanRunningFlag{false};
+BLEAddress matchedServer("");           // Written before scanMatchedFlag is set
+uint8_t matchedServerType = BLE_ADDR_TYPE_PUBLIC;
+std::atomic<uint32_t> linkDownMillis{0}; // When the link went down, 0 once a sample is shown
+
+// The link's BLE side; LinkManager decides when to call what, and releases the
+// client on every failure or drop
+class EspLink : public LinkDriver {
+public:
+    bool haveCachedServer() override { return !cachedServer.empty(); }
+    bool connectCached(uint32_t timeoutMs) override;
+    bool connectMatched(uint32_t timeoutMs) override;
+    void startScan() override;
+    bool scanRunning() override { return scanRunningFlag.load(); }
+    bool scanMatched() override { return scanMatchedFlag.load(); }
+    bool connected() override { return pClient->isConnected(); }
+    void release() override;
+};
+
+EspLink linkDriver;
+LinkManager serverLink(linkDriver);
+uint32_t heapAtFirstLink = 0; // Free heap the first time the link came up; later ones are compared to it
 
-unsigned long lastReconnectAttempt = 0; // This tracks the last reconnect attempt time.
-const unsigned long reconnectInterval = 5000; // Attempt to reconnect every 5 seconds.
+// Serial diagnostics: "heap" and "link"
+char serialCommand[32];
+size_t serialCommandLength = 0;
 
 // Display variables
-bool displayMode = true;
-float lastAngle = 0.0;
-unsigned long lastBendCount = 0;
+// Display modes, cycled with the button
+#define DISPLAY_ANGLE 0
+#define DISPLAY_BENDS 1
+#define DISPLAY_REP   2   // Last rep summary from the server
+#define DISPLAY_MODES 3
+std::atomic<uint8_t> displayMode{DISPLAY_BENDS}; // Cycled by loop(), read by the display task
+
+// The notify callback runs on the BLE stack's task, so it only copies the raw
+// frame into frameQueue. The frame task parses it and hands what changed to the
+// display task (which alone touches the SSD1306) and motor targets through
+// motorQueue to the stepper task (which alone touches the stepper). A full queue
+// drops the newest item and counts it; nothing downstream can hold up the BLE stack.
+#define FRAME_QUEUE_FRAMES 16  // ~4 KB; a few hundred ms of notifications at full rate
+#define FRAME_TASK_PRIORITY 3  // Above loop() and the display, below the BLE stack
+#define DISPLAY_TASK_PRIORITY 1
+#define DISPLAY_REFRESH_MS 100 // Redraws are coalesced to at most this often
+#define STATS_INTERVAL_MS 10000
+
+struct RawFrame {
+    uint32_t receivedMicros;
+    uint16_t length;
+    uint8_t data[MAX_FRAME_BYTES];
+};
+
+// What the screen shows; the frame task sends a copy each time it changes
+struct DisplayState {
+    float angle;
+    unsigned long bendCount;
+    RepFrame rep; // rep == 0 until the first summary arrives
+};
+
+// Link status screens, posted by loop() while it scans and connects
+enum LinkMessage : uint8_t {
+    MSG_NONE,
+    MSG_SCANNING,
+    MSG_CONNECTING,
+    MSG_CONNECTED,
+    MSG_NOT_FOUND,
+    MSG_RECONNECTING,
+};
+
+SpscQueue<RawFrame, FRAME_QUEUE_FRAMES> frameQueue;   // BLE callback -> frame task
+SpscQueue<DisplayState, 4> displayQueue;              // Frame task -> display task
+SpscQueue<long, 8> motorQueue;                        // Frame task -> stepper task, targets
+std::atomic<uint8_t> linkMessage{MSG_NONE};           // loop() -> display task
+TaskHandle_t frameTaskHandle = nullptr;
+TaskHandle_t displayTaskHandle = nullptr;
+
+// Counters; each is written by one task and read for the stats line
+std::atomic<uint32_t> framesReceived{0};   // BLE callback
+std::atomic<uint32_t> framesOversize{0};   // BLE callback, longer than MAX_FRAME_BYTES
+std::atomic<uint32_t> callbackMaxMicros{0}; // BLE callback, time spent per notification
+std::atomic<uint32_t> framesParsed{0};     // Frame task
+std::atomic<uint32_t> framesBad{0};        // Frame task, failed to parse
+std::atomic<uint32_t> streamSamplesReceived{0}; // Frame task, angle samples from the stream characteristic
+std::atomic<uint32_t> frameLatencyMaxMicros{0}; // Frame task, callback to parsed
+std::atomic<uint32_t> rendersDone{0};      // Display task
+unsigned long lastStatsMillis = 0;
+
+// Log records are drained to the UART by a low-priority task, off the BLE callback path
+#define LOG_TASK_PRIORITY 1
+#define LOG_DRAIN_INTERVAL_MS 20
+TaskHandle_t logTaskHandle = nullptr;
 
 static unsigned long lastDebounceTime = 0;
 static bool lastButtonState = HIGH;
 
 class MyClientCallback : public BLEClientCallbacks {
     void onConnect(BLEClient* pclient) override {
-        isConnected = true;
-        Serial.println("Connected to server");
+        LOG_INFO("Connected to server");
     }
 
     void onDisconnect(BLEClient* pclient) override {
-        isConnected = false;
-        Serial.println("Disconnected from server");
+        linkDownMillis.store(millis() | 1); // Never 0
+        LOG_INFO("Disconnected from server");
     }
 };
 
+MyClientCallback clientCallbacks;
+
 void setupDisplay();
 void setupBLE();
-void scanAndConnect();
-bool connectToServer(BLEAddress pAddress);
-void updateDisplay();
+bool connectToServer(BLEAddress pAddress, uint8_t addressType, uint32_t timeoutMs);
+void loadServerAddress();
+void saveServerAddress(BLEAddress address, uint8_t addressType);
+void onScanComplete(BLEScanResults results);
+void onLinkChange(LinkState from, LinkState to);
+void handleSerial();
+void handleSerialCommand(const char* command);
+void printHeap();
+void showLinkMessage(LinkMessage message);
+void drawLinkMessage(LinkMessage message);
+void drawState(const DisplayState& state);
 void handleBLE();
 void handleButton();
+void printStats();
+void startStepper();
+void onStepperTimer();
+void stepperTask(void* param);
+bool applyMotorCommands();
 void notifyCallback(BLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify);
+void handleFrame(const RawFrame& raw, DisplayState& state);
+void startLogTask();
+void logTask(void* param);
+void startFrameTasks();
+void frameTask(void* param);
+void displayTask(void* param);
 
 void setup() {
     Serial.begin(115200);
+    startLogTask();
     setupDisplay();
+    startFrameTasks();
     setupBLE();
     pinMode(BUTTON_PIN, INPUT_PULLUP);
     handleButton();
-    scanAndConnect();
-
-    stepper.setMaxSpeed(5000);
-    stepper.setAcceleration(500);
+    startStepper();
+    loadServerAddress();
+    linkDownMillis.store(millis() | 1); // handleBLE() connects from the first loop()
 }
 
 void loop() {
     handleBLE();
     handleButton();
-    stepper.run();
+    handleSerial();
+    printStats();
+}
+
+void startLogTask() {
+    xTaskCreatePinnedToCore(logTask, "log", 4096, nullptr, LOG_TASK_PRIORITY, &logTaskHandle, ARDUINO_RUNNING_CORE);
+}
+
+void writeLogOutput(const uint8_t* data, size_t len) {
+    Serial.write(data, len);
+}
+
+// Binary frames by default, read them with logdecode from the server project;
+// build with -D LOG_TEXT_OUTPUT to format them here instead
+void logTask(void* param) {
+    for (;;) {
+#ifdef LOG_TEXT_OUTPUT
+        deferredLog.drainText(writeLogOutput, 32);
+#else
+        deferredLog.drainBinary(writeLogOutput, 32);
+#endif
+        if (deferredLog.pendingBytes() == 0) {
+            vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+        }
+    }
+}
+
+void startFrameTasks() {
+    xTaskCreatePinnedToCore(frameTask, "frames", 4096, nullptr, FRAME_TASK_PRIORITY, &frameTaskHandle,
+                            ARDUINO_RUNNING_CORE);
+    xTaskCreatePinnedToCore(displayTask, "display", 4096, nullptr, DISPLAY_TASK_PRIORITY, &displayTaskHandle,
+                            ARDUINO_RUNNING_CORE);
+}
+
+// Parses queued frames; woken by the notify callback
+void frameTask(void* param) {
+    DisplayState state = {0.0f, 0, {}};
+    RawFrame raw;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (frameQueue.pop(raw)) {
+            handleFrame(raw, state);
+        }
+    }
+}
+
+// Owns the SSD1306. A full redraw takes tens of ms over I2C, so whatever piled up
+// meanwhile is drawn once, newest first.
+void displayTask(void* param) {
+    DisplayState state = {0.0f, 0, {}};
+    DisplayState next;
+    uint8_t shownMode = displayMode.load();
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        bool changed = false;
+        while (displayQueue.pop(next)) {
+            state = next;
+            changed = true;
+        }
+        LinkMessage message = (LinkMessage)linkMessage.exchange(MSG_NONE);
+        if (message != MSG_NONE) {
+            drawLinkMessage(message);
+        } else if (changed || displayMode.load() != shownMode) {
+            shownMode = displayMode.load();
+            drawState(state);
+        } else {
+            continue;
+        }
+        rendersDone.fetch_add(1, std::memory_order_relaxed);
+        vTaskDelay(pdMS_TO_TICKS(DISPLAY_REFRESH_MS));
+    }
 }
 
 void setupDisplay() {
     if(!display.begin(SSD1306_SWITCHCAPVCC, 0x3C)) {
-        Serial.println(F("SSD1306 allocation failed"));
+        LOG_ERROR("SSD1306 allocation failed");
         for(;;); // Infinite loop
     }
     display.display();
-    delay(2000); // Pause for 2 seconds
-    display.clearDisplay();
     display.setTextSize(1.2);
     display.setTextColor(SSD1306_WHITE);
+    drawLinkMessage(MSG_SCANNING); // The display task isn't running yet
+}
+
+// Any task; the display task draws it on its next pass
+void showLinkMessage(LinkMessage message) {
+    linkMessage.store(message);
+    if (displayTaskHandle != nullptr) {
+        xTaskNotifyGive(displayTaskHandle);
+    }
+}
+
+void drawLinkMessage(LinkMessage message) {
+    static const char* const text[] = {
+        "",
+        "Scanning for BLE Server...",
+        "Found server\nConnecting...",
+        "Connected",
+        "Server not found",
+        "Lost connection\nReconnecting...",
+    };
+    display.clearDisplay();
     display.setCursor(0,0);
-    display.println(F("Scanning for BLE Server..."));
+    display.println(text[message]);
     display.display();
 }
 
 void setupBLE() {
     BLEDevice::init("");
+    pClient = BLEDevice::createClient();
+    pClient->setClientCallbacks(&clientCallbacks);
+    serverLink.setListener(onLinkChange);
 }
 
-void scanAndConnect() {
-    BLEScan* pBLEScan = BLEDevice::getScan();
-    pBLEScan->setActiveScan(true);
-    BLEScanResults foundDevices = pBLEScan->start(5, false);
-    Serial.println("Scan done!");
-    BLEUUID serviceUUID(SERVICE_UUID);
-    for (int i = 0; i < foundDevices.getCount(); i++) {
-        BLEAdvertisedDevice advertisedDevice = foundDevices.getDevice(i);
-        if (advertisedDevice.haveServiceUUID() && advertisedDevice.isAdvertisingService(serviceUUID)) {
-            Serial.println("Found our device!");
-            display.clearDisplay();
-            display.setCursor(0,0);
-            display.println(F("Found server\nConnecting..."));
-            display.display();
-            if (connectToServer(advertisedDevice.getAddress())) {
-                display.clearDisplay();
-                display.setCursor(0,0);
-                display.println(F("Connected"));
-                display.display();
-                return;
-            }
+// Runs on the BLE task for every advertisement during a background scan
+class ServerScanCallbacks : public BLEAdvertisedDeviceCallbacks {
+    void onResult(BLEAdvertisedDevice advertisedDevice) override {
+        if (scanMatchedFlag.load() || !advertisedDevice.haveServiceUUID() ||
+            !advertisedDevice.isAdvertisingService(BLEUUID(SERVICE_UUID))) {
+            return;
         }
+        matchedServer = advertisedDevice.getAddress();
+        matchedServerType = advertisedDevice.getAddressType();
+        scanMatchedFlag.store(true);
+        BLEDevice::getScan()->stop();
+        // stop() doesn't call the completion callback, so the scan ends here
+        scanRunningFlag.store(false);
     }
-    display.clearDisplay();
-    display.setCursor(0,0);
-    display.println(F("Server not found"));
-    display.display();
+};
+
+ServerScanCallbacks scanCallbacks;
+
+void EspLink::startScan() {
+    BLEScan* pBLEScan = BLEDevice::getScan();
+    pBLEScan->setAdvertisedDeviceCallbacks(&scanCallbacks);
+    pBLEScan->setActiveScan(true); // The service UUID is in the scan response
+    pBLEScan->setInterval(100);
+    pBLEScan->setWindow(99);       // Listen nearly all the time while we're looking
+    scanMatchedFlag.store(false);
+    scanRunningFlag.store(true);
+    pBLEScan->start(SCAN_WINDOW_S, onScanComplete, false);
 }
 
-bool connectToServer(BLEAddress pAddress) {
-    Serial.print("Forming a connection to ");
-    Serial.println(pAddress.toString().c_str());
+// BLE task, when a scan window runs out without being stopped
+void onScanComplete(BLEScanResults results) {
+    scanRunningFlag.store(false);
+}
 
-    BLEClient*  pClient  = BLEDevice::createClient();
-    Serial.println(" - Created client");
-    pClient->setClientCallbacks(new MyClientCallback());
+void loadServerAddress() {
+    prefs.begin(SERVER_NVS_NAMESPACE, true);
+    String address = prefs.getString(SERVER_NVS_KEY, "");
+    cachedServerType = prefs.getUChar("type", BLE_ADDR_TYPE_PUBLIC);
+    prefs.end();
+    cachedServer = address.c_str();
+    if (!cachedServer.empty()) {
+        LOG_INFO("Last server: %s", cachedServer.c_str());
+    }
+}
 
-    if (!pClient->connect(pAddress)) {
-        Serial.println(" - Connection failed");
+// Written only when it changes, to spare the flash
+void saveServerAddress(BLEAddress address, uint8_t addressType) {
+    std::string text = address.toString();
+    if (text == cachedServer && addressType == cachedServerType) {
+        return;
+    }
+    cachedServer = text;
+    cachedServerType = addressType;
+    prefs.begin(SERVER_NVS_NAMESPACE, false);
+    prefs.putString(SERVER_NVS_KEY, text.c_str());
+    prefs.putUChar("type", addressType);
+    prefs.end();
+    LOG_INFO("Server %s saved for fast reconnect", text.c_str());
+}
+
+bool EspLink::connectCached(uint32_t timeoutMs) {
+    return connectToServer(BLEAddress(cachedServer), cachedServerType, timeoutMs);
+}
+
+bool EspLink::connectMatched(uint32_t timeoutMs) {
+    BLEAddress address = matchedServer;
+    uint8_t type = matchedServerType;
+    if (!connectToServer(address, type, timeoutMs)) {
+        return false;
+    }
+    saveServerAddress(address, type);
+    return true;
+}
+
+// Safe in any state: after a failed attempt, a drop, or when already released
+void EspLink::release() {
+    pRemoteCharacteristic = nullptr;
+    if (pClient->isConnected()) {
+        pClient->disconnect();
+        // The disconnect completes on the BLE task; wait so the next attempt starts clean
+        uint32_t start = millis();
+        while (pClient->isConnected() && millis() - start < RELEASE_WAIT_MS) {
+            delay(10);
+        }
+    }
+}
+
+// Returns false on any failure and leaves the cleanup to release()
+bool connectToServer(BLEAddress pAddress, uint8_t addressType, uint32_t timeoutMs) {
+    LOG_INFO("Forming a connection to %s", pAddress.toString().c_str());
+
+    if (!pClient->connect(pAddress, (esp_ble_addr_type_t)addressType, timeoutMs)) {
+        LOG_WARN(" - Connection failed");
         return false;
     }
+    // Ask for the largest MTU so stream notifications can carry ~58 samples each
+    pClient->setMTU(247);
 
     BLERemoteService* pRemoteService = pClient->getService(SERVICE_UUID);
     if (pRemoteService == nullptr) {
-      Serial.print("Failed to find our service UUID: ");
-      Serial.println(SERVICE_UUID);
+      LOG_ERROR("Failed to find our service UUID: %s", SERVICE_UUID);
       return false;
     }
-    Serial.println(" - Found our service");
+    LOG_INFO(" - Found our service");
 
-    BLERemoteCharacteristic* pRemoteCharacteristic = pRemoteService->getCharacteristic(CHARACTERISTIC_UUID);
-    if (pRemoteCharacteristic == nullptr) {
-      Serial.print("Failed to find our characteristic UUID: ");
-      Serial.println(CHARACTERISTIC_UUID);
+    BLERemoteCharacteristic* pCharacteristic = pRemoteService->getCharacteristic(CHARACTERISTIC_UUID);
+    if (pCharacteristic == nullptr) {
+      LOG_ERROR("Failed to find our characteristic UUID: %s", CHARACTERISTIC_UUID);
       return false;
     }
-    Serial.println(" - Found our characteristic");
+    LOG_INFO(" - Found our characteristic");
 
-    if(pRemoteCharacteristic->canNotify())
-      pRemoteCharacteristic->registerForNotify(notifyCallback);
+    if(pCharacteristic->canNotify())
+      pCharacteristic->registerForNotify(notifyCallback);
+
+    // The continuous angle stream is optional; older servers don't have it
+    BLERemoteCharacteristic* pStreamCharacteristic = pRemoteService->getCharacteristic(STREAM_CHARACTERISTIC_UUID);
+    if (pStreamCharacteristic != nullptr && pStreamCharacteristic->canNotify()) {
+      pStreamCharacteristic->registerForNotify(notifyCallback);
+      LOG_INFO(" - Subscribed to angle stream");
+    }
 
-    isConnected = true;
+    pRemoteCharacteristic = pCharacteristic;
     return true;
 }
 
 void handleBLE() {
+    serverLink.tick(millis());
+}
 
-    if (!isConnected && (millis() - lastReconnectAttempt > reconnectInterval)) {
-      lastReconnectAttempt = millis(); // Update the last attempt time
-
-      display.clearDisplay();
-      display.setCursor(0,0);
-      display.println(F("Lost connection\nReconnecting..."));
-      display.display();
-
-      // Scan for BLE servers and find the one that matches our service UUID
-      BLEScan* pBLEScan = BLEDevice::getScan();
-      pBLEScan->setActiveScan(true); // Active scan uses more power, but get results faster
-      BLEScanResults foundDevices = pBLEScan->start(5, false); // 5-second scan, don't continue the scan after 5 seconds
-
-      BLEUUID serviceUUID(SERVICE_UUID);
-      bool foundServer = false;
-      for (int i = 0; i < foundDevices.getCount(); i++) {
-          BLEAdvertisedDevice advertisedDevice = foundDevices.getDevice(i);
-          if (advertisedDevice.haveServiceUUID() && advertisedDevice.isAdvertisingService(serviceUUID)) {
-              if (connectToServer(advertisedDevice.getAddress())) {
-                  display.clearDisplay();
-                  display.setCursor(0,0);
-                  display.println(F("Reconnected"));
-                  display.display();
-                  foundServer = true;
-                  isConnected = true; // Update connection status
-                  break;
-              }
-          }
-      }
-
-      if (!foundServer) {
-          display.clearDisplay();
-          display.setCursor(0,0);
-          display.println(F("Reconnect failed"));
-          display.display();
-          isConnected = false; // Ensure connection status is updated
-      }
-      pBLEScan->clearResults(); // Clear scan results to free up memory
-  }
+// Display messages and reconnect telemetry; runs inside serverLink.tick()
+void onLinkChange(LinkState from, LinkState to) {
+    LOG_INFO("Link: %s -> %s", LinkManager::stateName(from), LinkManager::stateName(to));
+    if (to == LINK_UP) {
+        uint32_t freeHeap = ESP.getFreeHeap();
+        if (heapAtFirstLink == 0) {
+            heapAtFirstLink = freeHeap;
+        }
+        LOG_INFO("Connected %lu ms after the link went down; heap %lu free, %ld since the first link",
+                 (unsigned long)serverLink.lastReconnectMs(), (unsigned long)freeHeap,
+                 (long)freeHeap - (long)heapAtFirstLink);
+        showLinkMessage(MSG_CONNECTED);
+    } else if (from == LINK_UP) {
+        showLinkMessage(MSG_RECONNECTING);
+    } else if (to == LINK_DIRECT || to == LINK_CONNECTING) {
+        showLinkMessage(MSG_CONNECTING);
+    } else if (to == LINK_SCANNING) {
+        showLinkMessage(MSG_SCANNING);
+    } else if (from == LINK_SCANNING) {
+        LOG_INFO("No server found after %lu scans, still looking", (unsigned long)serverLink.scans());
+        showLinkMessage(MSG_NOT_FOUND);
+    }
+}
+
+void handleSerial() {
+    while (Serial.available() > 0) {
+        char c = Serial.read();
+        if (c == '\r' || c == '\n') {
+            if (serialCommandLength > 0) {
+                serialCommand[serialCommandLength] = '\0';
+                handleSerialCommand(serialCommand);
+                serialCommandLength = 0;
+            }
+        } else if (serialCommandLength < sizeof(serialCommand) - 1) {
+            serialCommand[serialCommandLength++] = c;
+        }
+    }
+}
+
+void handleSerialCommand(const char* command) {
+    if (strcmp(command, "heap") == 0) {
+        multi_heap_info_t info;
+        heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+        Serial.printf("free %u, largest block %u, min free %u, allocated %u bytes in %u blocks, %u free blocks\n",
+                      (unsigned)info.total_free_bytes, (unsigned)info.largest_free_block,
+                      (unsigned)info.minimum_free_bytes, (unsigned)info.total_allocated_bytes,
+                      (unsigned)info.allocated_blocks, (unsigned)info.free_blocks);
+    } else if (strcmp(command, "link") == 0) {
+        Serial.printf("%s, %lu connects, %lu failed, %lu drops, %lu strays, %lu scans, last reconnect %lu ms\n",
+                      LinkManager::stateName(serverLink.state()), (unsigned long)serverLink.connects(),
+                      (unsigned long)serverLink.failures(), (unsigned long)serverLink.drops(), (unsigned long)serverLink.strays(),
+                      (unsigned long)serverLink.scans(), (unsigned long)serverLink.lastReconnectMs());
+    } else {
+        Serial.printf("Unknown command: %s (try \"heap\" or \"link\")\n", command);
+    }
+}
+
+// Free memory and fragmentation; a steady fall across reconnects is a leak
+void printHeap() {
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+    LOG_INFO("Heap: %lu free, largest block %lu, min free %lu, %lu blocks allocated; link %lu up, %lu failed, %lu drops",
+             (unsigned long)info.total_free_bytes, (unsigned long)info.largest_free_block,
+             (unsigned long)info.minimum_free_bytes, (unsigned long)info.allocated_blocks,
+             (unsigned long)serverLink.connects(), (unsigned long)serverLink.failures(), (unsigned long)serverLink.drops());
 }
 
 void handleButton() {
@@ -228,13 +558,11 @@ void handleButton() {
 
         // Check if the button was pressed (assuming active low configuration)
         if (currentButtonState == LOW) {
-            Serial.println("Button Pressed");
+            LOG_INFO("Button Pressed");
 
-            // Toggle the display mode
-            displayMode = !displayMode;
-            
-            // Update the display based on the new mode
-            updateDisplay();
+            // Cycle to the next display mode; the display task redraws
+            displayMode.store((displayMode.load() + 1) % DISPLAY_MODES);
+            xTaskNotifyGive(displayTaskHandle);
         }
     }
 
@@ -242,18 +570,31 @@ void handleButton() {
 }
 
 
-void updateDisplay() {
+// Display task only
+void drawState(const DisplayState& state) {
     display.clearDisplay();
     display.setTextSize(1.2);
     display.setTextColor(SSD1306_WHITE);
     display.setCursor(0,0);
     
-    if (!displayMode) {
-        display.print("Max Angle: ");
-        display.print(lastAngle);
-    } else {
+    uint8_t mode = displayMode.load();
+    if (mode == DISPLAY_ANGLE) {
+        display.print("Angle: "); // Latest streamed or bend angle, not a maximum
+        display.print(state.angle);
+    } else if (mode == DISPLAY_BENDS) {
         display.print("Bend Count: ");
-        display.print(lastBendCount);
+        display.print(state.bendCount);
+    } else if (state.rep.rep == 0) {
+        display.print("No reps yet");
+    } else {
+        display.printf("Rep %u\n", state.rep.rep);
+        display.printf("ROM: %.1f deg\n", state.rep.romDeg);
+        display.printf("Peak: %.0f deg/s\n", state.rep.peakVelocityDps);
+        if (state.rep.consistency == REP_CONSISTENCY_UNKNOWN) {
+            display.print("Consistency: --"); // Compact frame from a default-MTU link
+        } else {
+            display.printf("Consistency: %u%%", state.rep.consistency);
+        }
     }
     display.display();
 }
@@ -261,46 +602,226 @@ void updateDisplay() {
 const long positionLeft = -500;  // Adjust as necessary
 const long positionRight = 500;  // Adjust as necessary
 
+// Runs on the BLE stack's task: copy the frame out and wake the frame task, nothing else
 void notifyCallback(BLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify) {
-    String dataString = (char*)pData;
+    uint32_t start = micros();
+    framesReceived.fetch_add(1, std::memory_order_relaxed);
+    if (length > MAX_FRAME_BYTES) {
+        framesOversize.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    RawFrame raw;
+    raw.receivedMicros = start;
+    raw.length = (uint16_t)length;
+    memcpy(raw.data, pData, length);
+    if (frameQueue.push(raw)) {
+        xTaskNotifyGive(frameTaskHandle);
+    }
+    uint32_t took = micros() - start;
+    if (took > callbackMaxMicros.load(std::memory_order_relaxed)) {
+        callbackMaxMicros.store(took, std::memory_order_relaxed);
+    }
+}
+
+// Frame task. state is the task's copy of what the screen shows.
+void handleFrame(const RawFrame& raw, DisplayState& state) {
+    // Parse the binary frame in place; the data is not NUL-terminated
+    FrameView frame(raw.data, raw.length);
+    ParseResult result = frame.parse();
+    if (result != PARSE_OK) {
+        framesBad.fetch_add(1, std::memory_order_relaxed);
+        LOG_WARN("Dropped frame (%u bytes), parse error %u", (unsigned)raw.length, (unsigned)result);
+        return;
+    }
+    framesParsed.fetch_add(1, std::memory_order_relaxed);
+    uint32_t latency = micros() - raw.receivedMicros;
+    if (latency > frameLatencyMaxMicros.load(std::memory_order_relaxed)) {
+        frameLatencyMaxMicros.store(latency, std::memory_order_relaxed);
+    }
 
-    // Print the raw data received to the serial monitor
-    Serial.print("Received Data: ");
-    Serial.println(dataString);
+    uint32_t downAt = frame.type() != FRAME_STATUS ? linkDownMillis.exchange(0) : 0;
+    if (downAt != 0) {
+        LOG_INFO("First data %lu ms after the link went down", (unsigned long)(millis() - downAt));
+    }
 
-    // Find indices for key substrings
-    int angleIndex = dataString.indexOf("A: ") + 3;
-    int bendCountIndex = dataString.indexOf(", B: ") + 4;
+    if (frame.type() == FRAME_STATUS) {
+        // Status text isn't NUL-terminated in the frame
+        char text[LOG_MAX_STRING_ARG + 1];
+        size_t n = frame.statusLength() < LOG_MAX_STRING_ARG ? frame.statusLength() : LOG_MAX_STRING_ARG;
+        memcpy(text, frame.statusText(), n);
+        text[n] = '\0';
+        LOG_INFO("Server status: %s", text);
+        return;
+    }
 
-    if (angleIndex != -1 && bendCountIndex != -1) {
-        int commaIndex = dataString.indexOf(',', angleIndex);
-        
-        if (commaIndex != -1) {
-            // Extract substrings based on identified indices
-            String angleString = dataString.substring(angleIndex, commaIndex);
-            String bendCountString = dataString.substring(bendCountIndex);
-            
-            // Convert extracted substrings to appropriate types
-            lastAngle = angleString.toFloat();
-            lastBendCount = bendCountString.toInt();
-            
-            // Update display with new data
-            updateDisplay();
-
-            // Motor control logic based on the angle
-            if (lastAngle < 50) {
-                // Turn the motor to the left (counter-clockwise)
-                Serial.println("Turning motor left.");
-                stepper.moveTo(positionLeft); // Move 100 steps counter-clockwise
-            } else {
-                // Turn the motor to the right (clockwise)
-                Serial.println("Turning motor right.");
-                stepper.moveTo(positionRight); // Move 100 steps clockwise
+    if (frame.type() == FRAME_STREAM) {
+        // Keep the newest angle; the display still refreshes on bend frames
+        if (frame.streamCount() > 0) {
+            StreamSample sample;
+            frame.streamSample(frame.streamCount() - 1, sample);
+            state.angle = sample.angle;
+            streamSamplesReceived.fetch_add(frame.streamCount(), std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    if (frame.type() == FRAME_REP) {
+        frame.toRep(state.rep);
+        LOG_INFO("Rep #%u: ROM %.1f, peak %.0f deg/s, consistency %u", state.rep.rep, state.rep.romDeg,
+                 state.rep.peakVelocityDps, state.rep.consistency);
+        // Pushed whatever the mode, so switching to the rep screen shows this one;
+        // the display task coalesces the redraws
+        if (displayQueue.push(state)) {
+            xTaskNotifyGive(displayTaskHandle);
+        }
+        return;
+    }
+
+    state.angle = frame.angle();
+    state.bendCount = frame.bendCount();
+
+    LOG_INFO("Received #%u: A: %.2f, B: %lu", frame.seq(), state.angle, state.bendCount);
+
+    // Update display with new data
+    if (displayQueue.push(state)) {
+        xTaskNotifyGive(displayTaskHandle);
+    }
+
+    // Motor control logic based on the angle
+    if (state.angle < 50) {
+        // Turn the motor to the left (counter-clockwise)
+        LOG_DEBUG("Turning motor left.");
+        motorQueue.push(positionLeft); // Move 100 steps counter-clockwise
+    } else {
+        // Turn the motor to the right (clockwise)
+        LOG_DEBUG("Turning motor right.");
+        motorQueue.push(positionRight); // Move 100 steps clockwise
+    }
+    if (stepperIdle.load()) {
+        xTaskNotifyGive(stepperTaskHandle);
+    }
+}
+
+void startStepper() {
+    stepper.setMaxSpeed(STEPPER_MAX_SPEED);
+    stepper.setAcceleration(STEPPER_ACCELERATION);
+    // 80 MHz APB clock / 80 = 1 MHz timer, so the alarm value is in microseconds
+    stepperTimer = timerBegin(0, 80, true);
+    timerAttachInterrupt(stepperTimer, &onStepperTimer, true);
+    timerAlarmWrite(stepperTimer, STEPPER_TICK_US, true);
+    xTaskCreatePinnedToCore(stepperTask, "stepper", 4096, nullptr, STEPPER_TASK_PRIORITY, &stepperTaskHandle,
+                            ARDUINO_RUNNING_CORE);
+}
+
+void IRAM_ATTR onStepperTimer() {
+    BaseType_t woken = pdFALSE;
+    lastStepperTickMicros = micros();
+    vTaskNotifyGiveFromISR(stepperTaskHandle, &woken);
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+// Owns the stepper once started. Sleeps with the timer off until the frame task
+// queues a target, then runs AccelStepper on every tick until it gets there.
+void stepperTask(void* param) {
+    uint32_t lastStepMicros = 0;
+    uint32_t expectedIntervalMicros = 0; // 0: no previous step to measure from
+    for (;;) {
+        uint32_t wakes = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uint32_t now = micros();
+        if (stepperIdle.load()) {
+            // Woken by a new target, not the timer
+            if (!applyMotorCommands()) {
+                continue;
+            }
+            stepperIdle.store(false);
+            expectedIntervalMicros = 0;
+            timerAlarmEnable(stepperTimer);
+            continue;
+        }
+
+        uint32_t late = now - lastStepperTickMicros;
+        stepTiming.ticks++;
+        stepTiming.missedTicks += wakes - 1;
+        stepTiming.totalTickLateMicros += late;
+        if (late > stepTiming.maxTickLateMicros) {
+            stepTiming.maxTickLateMicros = late;
+        }
+
+        applyMotorCommands();
+        long before = stepper.currentPosition();
+        stepper.run();
+        if (stepper.currentPosition() != before) {
+            now = micros();
+            if (expectedIntervalMicros > 0) {
+                uint32_t actual = now - lastStepMicros;
+                uint32_t error = actual > expectedIntervalMicros ? actual - expectedIntervalMicros
+                                                                 : expectedIntervalMicros - actual;
+                stepTiming.timedSteps++;
+                stepTiming.totalStepErrorMicros += error;
+                if (error > stepTiming.maxStepErrorMicros) {
+                    stepTiming.maxStepErrorMicros = error;
+                }
+            }
+            stepTiming.steps++;
+            lastStepMicros = now;
+            // run() has already worked out the speed for the next step
+            float speed = fabsf(stepper.speed());
+            expectedIntervalMicros = speed > 0.0f ? (uint32_t)(1000000.0f / speed) : 0;
+        }
+
+        if (stepper.distanceToGo() == 0) {
+            // Cleared first so a target queued from here on wakes us again
+            stepperIdle.store(true);
+            timerAlarmDisable(stepperTimer);
+            if (applyMotorCommands()) {
+                stepperIdle.store(false);
+                timerAlarmEnable(stepperTimer);
             }
+            expectedIntervalMicros = 0;
         }
     }
 }
 
+// Stepper task; only the newest target matters. Returns true if there's somewhere to go.
+bool applyMotorCommands() {
+    long target;
+    bool have = false;
+    while (motorQueue.pop(target)) {
+        have = true;
+    }
+    if (have) {
+        stepper.moveTo(target);
+    }
+    return stepper.distanceToGo() != 0;
+}
+
+void printStats() {
+    if (millis() - lastStatsMillis < STATS_INTERVAL_MS) {
+        return;
+    }
+    lastStatsMillis = millis();
+    LOG_INFO("Frames: %lu received, %lu parsed, %lu bad, %lu oversize, %lu stream samples",
+             (unsigned long)framesReceived.load(), (unsigned long)framesParsed.load(),
+             (unsigned long)framesBad.load(), (unsigned long)framesOversize.load(),
+             (unsigned long)streamSamplesReceived.load());
+    LOG_INFO("Queues: frames %u now, hwm %u/%u, %lu dropped; display hwm %u/%u, %lu dropped; motor %lu dropped",
+             (unsigned)frameQueue.size(), (unsigned)frameQueue.highWaterMark(), (unsigned)frameQueue.capacity(),
+             (unsigned long)frameQueue.overruns(), (unsigned)displayQueue.highWaterMark(),
+             (unsigned)displayQueue.capacity(), (unsigned long)displayQueue.overruns(),
+             (unsigned long)motorQueue.overruns());
+    LOG_INFO("Callback max %lu us, notify to parsed max %lu us, %lu renders",
+             (unsigned long)callbackMaxMicros.exchange(0), (unsigned long)frameLatencyMaxMicros.exchange(0),
+             (unsigned long)rendersDone.load());
+    const StepTiming& t = stepTiming;
+    LOG_INFO("Stepper: %lu steps, interval error mean/max %lu/%lu us, tick late mean/max %lu/%lu us, %lu missed",
+             (unsigned long)t.steps, (unsigned long)(t.timedSteps ? t.totalStepErrorMicros / t.timedSteps : 0),
+             (unsigned long)t.maxStepErrorMicros, (unsigned long)(t.ticks ? t.totalTickLateMicros / t.ticks : 0),
+             (unsigned long)t.maxTickLateMicros, (unsigned long)t.missedTicks);
+    printHeap();
+}
+
 
 //////////////////////////////////
 
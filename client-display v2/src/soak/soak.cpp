@@ -0,0 +1,286 @@
+// Soaks LinkManager through thousands of connect/disconnect cycles against a fake
+// BLE link that fails connects, drops the link, misses scans, stops scans early on
+// a match and completes connects after they timed out, checking that no connection
+// is ever leaked.
+// Built by the `soak` environment:  pio run -e soak
+// then:  .pio/build/soak/program [options]
+//
+//   --cycles 10000      links brought up and dropped again
+//   --seed 1            random seed, for repeating a failing run
+//   --fail 0.3          chance a connect attempt fails
+//   --stray 0.1         chance a failed attempt connects anyway a little later
+//   --miss 0.3          chance a scan window ends without finding the server
+//
+// The fake allocates a connection object on every connect, like BLEClient builds
+// its service map, and frees it in release(). Global new/delete are counted, so a
+// path that skips release() shows up as live allocations. Exits with 3 if at any
+// point more than one connection was live, a connect started on a connected
+// link, or allocations didn't return to the baseline at the end.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <vector>
+
+#include <LinkManager.h>
+
+static std::atomic<long> liveAllocations{0};
+
+void* operator new(size_t size) {
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    liveAllocations++;
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (p != nullptr) {
+        liveAllocations--;
+        free(p);
+    }
+}
+
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+struct Options {
+    unsigned long cycles = 10000;
+    unsigned seed = 1;
+    double fail = 0.3;
+    double stray = 0.1;
+    double miss = 0.3;
+};
+
+static Options options;
+static unsigned long violations = 0;
+
+static void violation(const char* what) {
+    if (violations < 10) {
+        fprintf(stderr, "violation: %s\n", what);
+    }
+    violations++;
+}
+
+// What the real client holds per connection: remote services and their characteristics
+struct Connection {
+    static int live;
+    std::vector<int> services;
+    bool up = true;
+
+    Connection() : services(8) { live++; }
+    ~Connection() { live--; }
+};
+
+int Connection::live = 0;
+
+class FakeLink : public LinkDriver {
+public:
+    explicit FakeLink(unsigned seed) : rng(seed) {}
+
+    bool haveCachedServer() override { return cached; }
+    bool connectCached(uint32_t timeoutMs) override { return connect(timeoutMs); }
+
+    bool connectMatched(uint32_t timeoutMs) override {
+        if (!matched) {
+            violation("connect to a server no scan found");
+        }
+        if (!connect(timeoutMs)) {
+            return false;
+        }
+        cached = true;
+        return true;
+    }
+
+    void startScan() override {
+        if (scanning) {
+            violation("scan started while one was running");
+        }
+        scanTicks = 1 + rng() % 5;
+        matchTicks = chance(options.miss) ? 0 : 1 + rng() % scanTicks;
+        matched = false;
+        scanning = true;
+    }
+
+    bool scanRunning() override { return scanning; }
+    bool scanMatched() override { return matched; }
+    bool connected() override { return connection != nullptr && connection->up; }
+
+    void release() override {
+        delete connection;
+        connection = nullptr;
+        releases++;
+    }
+
+    // One loop() worth of time passing on the radio side
+    void advance() {
+        if (scanning) {
+            if (matchTicks > 0 && --matchTicks == 0) {
+                // onResult() stops the scan on the first match; stop() fires no
+                // completion callback, so the scan must end here
+                matched = true;
+                scanTicks = 0;
+                scanning = false;
+            } else if (--scanTicks == 0) {
+                scanning = false; // The window ran out: the completion callback
+            }
+        }
+        if (strayTicks > 0 && --strayTicks == 0) {
+            // The attempt timed out but the controller finished it anyway
+            open();
+        }
+    }
+
+    void dropLink() {
+        if (connection != nullptr) {
+            connection->up = false;
+        }
+    }
+
+    uint32_t elapsedMs = 0; // Time spent blocked in connect attempts
+    unsigned long attempts = 0;
+    unsigned long releases = 0;
+    unsigned long lateConnects = 0;
+
+private:
+    bool chance(double p) { return std::uniform_real_distribution<double>(0, 1)(rng) < p; }
+
+    void open() {
+        if (connection != nullptr) {
+            violation("second connection opened over a live one");
+        }
+        connection = new Connection();
+        if (Connection::live > 1) {
+            violation("more than one connection live");
+        }
+    }
+
+    bool connect(uint32_t timeoutMs) {
+        attempts++;
+        if (connection != nullptr) {
+            violation("connect on a link that was never released");
+        }
+        strayTicks = 0; // One client: a new attempt supersedes a late one
+        if (chance(options.fail)) {
+            elapsedMs += timeoutMs;
+            if (chance(options.stray)) {
+                lateConnects++;
+                strayTicks = 1 + rng() % 3;
+            } else if (chance(0.5)) {
+                // Connected, then discovery failed: half set up until release()
+                open();
+            }
+            return false;
+        }
+        elapsedMs += 100 + rng() % 400;
+        open();
+        return true;
+    }
+
+    std::mt19937 rng;
+    Connection* connection = nullptr;
+    bool cached = false;
+    bool matched = false;
+    bool scanning = false;
+    int scanTicks = 0;
+    int matchTicks = 0;  // Ticks into the window until the server advertises; 0 if it won't
+    int strayTicks = 0;
+};
+
+static std::vector<uint32_t> reconnectMs;
+static LinkManager* manager = nullptr;
+
+static void onLinkChange(LinkState, LinkState to) {
+    if (to == LINK_UP) {
+        reconnectMs.push_back(manager->lastReconnectMs());
+    }
+}
+
+static void usage() {
+    fprintf(stderr, "usage: soak [--cycles N] [--seed S] [--fail P] [--stray P] [--miss P]\n");
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+            return 2;
+        }
+        const char* value = argv[++i];
+        if (strcmp(arg, "--cycles") == 0) {
+            options.cycles = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--seed") == 0) {
+            options.seed = (unsigned)strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--fail") == 0) {
+            options.fail = atof(value);
+        } else if (strcmp(arg, "--stray") == 0) {
+            options.stray = atof(value);
+        } else if (strcmp(arg, "--miss") == 0) {
+            options.miss = atof(value);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (options.cycles < 1 || options.fail >= 1 || options.miss >= 1) {
+        usage();
+        return 2;
+    }
+
+    reconnectMs.reserve(options.cycles);
+    long baseline = liveAllocations.load();
+    FakeLink link(options.seed);
+    LinkManager links(link);
+    manager = &links;
+    links.setListener(onLinkChange);
+
+    std::mt19937 rng(options.seed ^ 0x5eed);
+    uint32_t nowMs = 0;
+    unsigned long ticks = 0;
+    while (links.connects() < options.cycles) {
+        link.elapsedMs = 0;
+        links.tick(nowMs);
+        link.advance();
+        nowMs += 10 + link.elapsedMs;
+        ticks++;
+        if (links.up() && rng() % 8 == 0) {
+            link.dropLink();
+        }
+        if (Connection::live > 1) {
+            violation("more than one connection live");
+        }
+        if (ticks > options.cycles * 10000UL) {
+            violation("link stopped making progress");
+            break;
+        }
+    }
+    link.dropLink();
+    links.tick(nowMs);
+    link.release();
+    long leaked = liveAllocations.load() - baseline;
+    if (Connection::live != 0 || leaked != 0) {
+        violation("allocations left after the last release");
+    }
+
+    std::sort(reconnectMs.begin(), reconnectMs.end());
+    auto pct = [&](double p) { return reconnectMs.empty() ? 0u : reconnectMs[(size_t)(p * (reconnectMs.size() - 1))]; };
+    printf("%lu ticks, %.0f s simulated, seed %u\n", ticks, nowMs / 1000.0, options.seed);
+    printf("link: %lu up, %lu failed, %lu drops, %lu scans, %lu strays released, %lu late connects\n",
+           (unsigned long)links.connects(), (unsigned long)links.failures(), (unsigned long)links.drops(),
+           (unsigned long)links.scans(), (unsigned long)links.strays(), link.lateConnects);
+    printf("driver: %lu attempts, %lu releases, %ld allocations leaked\n", link.attempts, link.releases, leaked);
+    printf("reconnect ms: p50 %u, p90 %u, p99 %u, max %u\n", pct(0.5), pct(0.9), pct(0.99),
+           reconnectMs.empty() ? 0u : reconnectMs.back());
+    if (violations > 0) {
+        printf("%lu violation(s)\n", violations);
+        return 3;
+    }
+    return 0;
+}
@@ -0,0 +1,288 @@
+#include "DeferredLog.h"
+
+#include <stdio.h>
+
+DeferredLog deferredLog;
+
+#define LOG_RING_MASK (LOG_RING_BYTES - 1)
+// Records sit in the ring with the format as a native pointer; on the wire it's a u32 id
+#define LOG_RING_HEADER_BYTES (sizeof(const char*) + 5)
+
+uint8_t logCrc8(const uint8_t* data, size_t len, uint8_t crc) {
+  // CRC-8, polynomial 0x07
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+char logLevelLetter(uint8_t level) {
+  switch (level) {
+    case LOG_LEVEL_ERROR: return 'E';
+    case LOG_LEVEL_WARN: return 'W';
+    case LOG_LEVEL_INFO: return 'I';
+    case LOG_LEVEL_DEBUG: return 'D';
+    default: return '?';
+  }
+}
+
+static uint32_t readU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void writeU32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+void LogRecordBuilder::add(const char* s) {
+  if (s == nullptr) {
+    s = "(null)";
+  }
+  if (len + 2 > cap) {
+    return;
+  }
+  size_t n = strnlen(s, LOG_MAX_STRING_ARG);
+  if (n > cap - len - 2) {
+    n = cap - len - 2;
+  }
+  buf[len++] = LOG_ARG_STRING;
+  buf[len++] = (uint8_t)n;
+  memcpy(buf + len, s, n);
+  len += n;
+}
+
+size_t formatLogRecord(const char* format, const uint8_t* args, size_t argsLen, char* out, size_t cap) {
+  if (cap == 0) {
+    return 0;
+  }
+  size_t n = 0;
+  size_t a = 0;
+  const char* p = format;
+  while (*p != '\0' && n + 1 < cap) {
+    if (*p != '%') {
+      out[n++] = *p++;
+      continue;
+    }
+    if (p[1] == '%') {
+      out[n++] = '%';
+      p += 2;
+      continue;
+    }
+
+    // Keep flags, width and precision; drop length modifiers, the tag sets the type
+    char spec[16];
+    size_t s = 0;
+    spec[s++] = *p++;
+    while (*p != '\0' && strchr("-+ #0123456789.", *p) != nullptr && s < sizeof(spec) - 4) {
+      spec[s++] = *p++;
+    }
+    while (*p != '\0' && strchr("hlLqjzt", *p) != nullptr) {
+      p++;
+    }
+    char conv = *p;
+    if (conv == '\0') {
+      break;
+    }
+    p++;
+
+    // Next argument
+    uint8_t tag = 0;
+    long long ival = 0;
+    unsigned long long uval = 0;
+    double fval = 0;
+    char text[LOG_MAX_STRING_ARG + 1] = "";
+    if (a < argsLen) {
+      tag = args[a++];
+      if ((tag == LOG_ARG_INT || tag == LOG_ARG_UINT || tag == LOG_ARG_FLOAT) && a + 4 <= argsLen) {
+        uint32_t v = readU32(args + a);
+        a += 4;
+        if (tag == LOG_ARG_FLOAT) {
+          float f;
+          memcpy(&f, &v, 4);
+          fval = f;
+          ival = (long long)f;
+        } else {
+          ival = tag == LOG_ARG_INT ? (long long)(int32_t)v : (long long)v;
+          fval = (double)ival;
+        }
+      } else if ((tag == LOG_ARG_INT64 || tag == LOG_ARG_UINT64) && a + 8 <= argsLen) {
+        uint64_t v = readU32(args + a) | ((uint64_t)readU32(args + a + 4) << 32);
+        a += 8;
+        ival = (long long)v;
+        fval = tag == LOG_ARG_INT64 ? (double)ival : (double)v;
+      } else if (tag == LOG_ARG_STRING && a < argsLen && a + 1 + args[a] <= argsLen) {
+        size_t len = args[a];
+        memcpy(text, args + a + 1, len);
+        text[len] = '\0';
+        a += 1 + len;
+      } else {
+        tag = 0; // Truncated record
+        a = argsLen;
+      }
+    }
+    uval = (unsigned long long)ival;
+
+    size_t room = cap - n;
+    int w;
+    if (tag == 0) {
+      w = snprintf(out + n, room, "?");
+    } else if (conv == 'd' || conv == 'i') {
+      memcpy(spec + s, "lld", 4);
+      w = snprintf(out + n, room, spec, ival);
+    } else if (conv == 'u' || conv == 'x' || conv == 'X' || conv == 'o') {
+      spec[s] = 'l';
+      spec[s + 1] = 'l';
+      spec[s + 2] = conv;
+      spec[s + 3] = '\0';
+      w = snprintf(out + n, room, spec, uval);
+    } else if (conv == 'c') {
+      memcpy(spec + s, "c", 2);
+      w = snprintf(out + n, room, spec, (int)ival);
+    } else if (strchr("fFeEgGaA", conv) != nullptr) {
+      spec[s] = conv;
+      spec[s + 1] = '\0';
+      w = snprintf(out + n, room, spec, fval);
+    } else if (conv == 's') {
+      memcpy(spec + s, "s", 2);
+      w = snprintf(out + n, room, spec, tag == LOG_ARG_STRING ? text : "?");
+    } else if (conv == 'p') {
+      w = snprintf(out + n, room, "0x%llx", uval);
+    } else {
+      w = snprintf(out + n, room, "%c", conv);
+    }
+    if (w < 0) {
+      break;
+    }
+    n += (size_t)w < room ? (size_t)w : room - 1;
+  }
+  out[n] = '\0';
+  return n;
+}
+
+bool DeferredLog::push(const uint8_t* record, size_t len) {
+  if (writeLock.test_and_set(std::memory_order_acquire)) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  uint32_t h = head.load(std::memory_order_relaxed);
+  size_t used = h - tail.load(std::memory_order_acquire);
+  if (used + 1 + len > LOG_RING_BYTES) {
+    writeLock.clear(std::memory_order_release);
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  ring[h & LOG_RING_MASK] = (uint8_t)len;
+  uint32_t start = (h + 1) & LOG_RING_MASK;
+  size_t first = len < LOG_RING_BYTES - start ? len : LOG_RING_BYTES - start;
+  memcpy(ring + start, record, first);
+  memcpy(ring, record + first, len - first);
+  head.store(h + 1 + len, std::memory_order_release);
+
+  used += 1 + len;
+  if (used > hwm.load(std::memory_order_relaxed)) {
+    hwm.store(used, std::memory_order_relaxed);
+  }
+  written.fetch_add(1, std::memory_order_relaxed);
+  writeLock.clear(std::memory_order_release);
+  return true;
+}
+
+bool DeferredLog::pop(uint8_t* record, size_t& len) {
+  uint32_t t = tail.load(std::memory_order_relaxed);
+  if (t == head.load(std::memory_order_acquire)) {
+    return false;
+  }
+  len = ring[t & LOG_RING_MASK];
+  uint32_t start = (t + 1) & LOG_RING_MASK;
+  size_t first = len < LOG_RING_BYTES - start ? len : LOG_RING_BYTES - start;
+  memcpy(record, ring + start, first);
+  memcpy(record + first, ring, len - first);
+  tail.store(t + 1 + len, std::memory_order_release);
+  return true;
+}
+
+bool DeferredLog::formatSent(const char* format) {
+  for (uint8_t i = 0; i < sentFormatCount; i++) {
+    if (sentFormats[i] == format) {
+      return true;
+    }
+  }
+  if (sentFormatCount == LOG_FORMAT_CACHE) {
+    sentFormatCount = 0;
+  }
+  sentFormats[sentFormatCount++] = format;
+  return false;
+}
+
+void DeferredLog::sendFormat(Output out, const char* format) {
+  uint8_t frame[LOG_FRAME_OVERHEAD + 255];
+  size_t textLen = strnlen(format, 255 - 4);
+  uint32_t id = (uint32_t)(uintptr_t)format;
+  frame[0] = LOG_SYNC0;
+  frame[1] = LOG_SYNC1;
+  frame[2] = LOG_FRAME_FORMAT;
+  frame[3] = (uint8_t)(4 + textLen);
+  writeU32(frame + 4, id);
+  memcpy(frame + 8, format, textLen);
+  frame[8 + textLen] = logCrc8(frame + 2, 6 + textLen);
+  out(frame, 9 + textLen);
+}
+
+size_t DeferredLog::drainBinary(Output out, size_t maxRecords) {
+  uint8_t record[LOG_MAX_RECORD_BYTES];
+  uint8_t frame[LOG_FRAME_OVERHEAD + LOG_MAX_RECORD_BYTES];
+  size_t len;
+  size_t sent = 0;
+  while (sent < maxRecords && pop(record, len)) {
+    const char* format;
+    memcpy(&format, record, sizeof(format));
+    if (++recordsSinceResend >= LOG_FORMAT_RESEND_RECORDS) {
+      recordsSinceResend = 0;
+      sentFormatCount = 0;
+    }
+    if (!formatSent(format)) {
+      sendFormat(out, format);
+    }
+
+    uint32_t id = (uint32_t)(uintptr_t)format;
+    size_t rest = len - sizeof(format);
+    frame[0] = LOG_SYNC0;
+    frame[1] = LOG_SYNC1;
+    frame[2] = LOG_FRAME_RECORD;
+    frame[3] = (uint8_t)(4 + rest);
+    writeU32(frame + 4, id);
+    memcpy(frame + 8, record + sizeof(format), rest);
+    frame[8 + rest] = logCrc8(frame + 2, 6 + rest);
+    out(frame, 9 + rest);
+    sent++;
+  }
+  return sent;
+}
+
+size_t DeferredLog::drainText(Output out, size_t maxRecords) {
+  uint8_t record[LOG_MAX_RECORD_BYTES];
+  char line[256];
+  size_t len;
+  size_t sent = 0;
+  while (sent < maxRecords && pop(record, len)) {
+    const char* format;
+    memcpy(&format, record, sizeof(format));
+    uint32_t micros = readU32(record + sizeof(format));
+    uint8_t level = record[sizeof(format) + 4];
+    int n = snprintf(line, sizeof(line), "[%lu.%06lu %c] ", (unsigned long)(micros / 1000000),
+                     (unsigned long)(micros % 1000000), logLevelLetter(level));
+    n += formatLogRecord(format, record + LOG_RING_HEADER_BYTES, len - LOG_RING_HEADER_BYTES,
+                         line + n, sizeof(line) - n - 1);
+    line[n++] = '\n';
+    out((const uint8_t*)line, n);
+    sent++;
+  }
+  return sent;
+}
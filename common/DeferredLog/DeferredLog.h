@@ -0,0 +1,216 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+// Deferred logging. LOG_* calls copy the format string pointer, a timestamp and the
+// raw argument values into a RAM ring; a low-priority task drains the ring to the
+// UART later, either as compact binary frames (decoded on the host by logdecode)
+// or formatted as text on the device. Levels above LOG_LEVEL compile to nothing.
+//
+// Format strings must be literals (the macros enforce it) since only their address
+// is stored. String arguments are copied, up to LOG_MAX_STRING_ARG bytes.
+//
+// Any task may log. Writers serialize on a try-lock and never wait: if another
+// writer holds it, or the ring is full, the record is dropped and counted, so a
+// high-priority task can't be held up behind a low-priority one.
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifndef LOG_RING_BYTES
+#define LOG_RING_BYTES 4096 // Power of two
+#endif
+
+#define LOG_MAX_RECORD_BYTES 160
+#define LOG_MAX_STRING_ARG 64
+#define LOG_FORMAT_CACHE 64       // Format strings remembered as already sent to the host
+#define LOG_FORMAT_RESEND_RECORDS 1024 // Resend formats this often so a late decoder catches up
+
+// Wire frame: [0xA5][0x5A][type:u8][length:u8][payload][crc8 over type, length, payload]
+// FORMAT payload: [formatId:u32][format text]
+// RECORD payload: [formatId:u32][micros:u32][level:u8] then per argument [tag:u8][value]
+// Values are little-endian; 'i'/'u'/'f' are 4 bytes, 'I'/'U' 8 bytes, 's' is [len:u8][bytes].
+#define LOG_SYNC0 0xA5
+#define LOG_SYNC1 0x5A
+#define LOG_FRAME_HEADER_BYTES 4
+#define LOG_FRAME_OVERHEAD 5
+#define LOG_FRAME_FORMAT 1
+#define LOG_FRAME_RECORD 2
+#define LOG_RECORD_HEADER_BYTES 9
+
+enum LogArgTag : uint8_t {
+  LOG_ARG_INT = 'i',
+  LOG_ARG_UINT = 'u',
+  LOG_ARG_INT64 = 'I',
+  LOG_ARG_UINT64 = 'U',
+  LOG_ARG_FLOAT = 'f',
+  LOG_ARG_STRING = 's',
+};
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+inline uint32_t logClockMicros() { return micros(); }
+#else
+#include <chrono>
+inline uint32_t logClockMicros() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+uint8_t logCrc8(const uint8_t* data, size_t len, uint8_t crc = 0);
+
+// Formats one record's arguments with its printf-style format string. Length
+// modifiers in the format are ignored; the argument tags decide the C type.
+// Returns the length written, always NUL-terminated when cap > 0.
+size_t formatLogRecord(const char* format, const uint8_t* args, size_t argsLen, char* out, size_t cap);
+
+char logLevelLetter(uint8_t level);
+
+// Serializes one record into a fixed buffer; arguments that don't fit are dropped.
+class LogRecordBuilder {
+public:
+  LogRecordBuilder(uint8_t* buf, size_t cap) : buf(buf), cap(cap) {}
+
+  void header(const char* format, uint32_t micros, uint8_t level) {
+    memcpy(buf, &format, sizeof(format));
+    len = sizeof(format);
+    putU32(micros);
+    buf[len++] = level;
+  }
+
+  void add(int v) { putTagged(LOG_ARG_INT, (uint32_t)v); }
+  void add(long v) { sizeof(long) > 4 ? add((long long)v) : putTagged(LOG_ARG_INT, (uint32_t)v); }
+  void add(short v) { add((int)v); }
+  void add(signed char v) { add((int)v); }
+  void add(char v) { add((int)v); }
+  void add(unsigned v) { putTagged(LOG_ARG_UINT, (uint32_t)v); }
+  void add(unsigned long v) {
+    sizeof(long) > 4 ? add((unsigned long long)v) : putTagged(LOG_ARG_UINT, (uint32_t)v);
+  }
+  void add(unsigned short v) { add((unsigned)v); }
+  void add(unsigned char v) { add((unsigned)v); }
+  void add(bool v) { add((unsigned)v); }
+  void add(long long v) { putTagged64(LOG_ARG_INT64, (uint64_t)v); }
+  void add(unsigned long long v) { putTagged64(LOG_ARG_UINT64, (uint64_t)v); }
+  void add(float v) { uint32_t bits; memcpy(&bits, &v, 4); putTagged(LOG_ARG_FLOAT, bits); }
+  void add(double v) { add((float)v); }
+  void add(const char* s);
+  void add(char* s) { add((const char*)s); }
+
+  size_t length() const { return len; }
+
+private:
+  void putU32(uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+      buf[len++] = (uint8_t)(v >> (8 * i));
+    }
+  }
+  void putTagged(uint8_t tag, uint32_t v) {
+    if (len + 5 <= cap) {
+      buf[len++] = tag;
+      putU32(v);
+    }
+  }
+  void putTagged64(uint8_t tag, uint64_t v) {
+    if (len + 9 <= cap) {
+      buf[len++] = tag;
+      putU32((uint32_t)v);
+      putU32((uint32_t)(v >> 32));
+    }
+  }
+
+  uint8_t* buf;
+  size_t cap;
+  size_t len = 0;
+};
+
+inline void logArgs(LogRecordBuilder&) {}
+
+template <typename T, typename... Rest>
+void logArgs(LogRecordBuilder& b, T first, Rest... rest) {
+  b.add(first);
+  logArgs(b, rest...);
+}
+
+class DeferredLog {
+public:
+  typedef void (*Output)(const uint8_t* data, size_t len);
+
+  static_assert((LOG_RING_BYTES & (LOG_RING_BYTES - 1)) == 0, "LOG_RING_BYTES must be a power of two");
+
+  template <typename... Args>
+  void write(uint8_t level, const char* format, Args... args) {
+    uint8_t record[LOG_MAX_RECORD_BYTES];
+    LogRecordBuilder b(record, sizeof(record));
+    b.header(format, logClockMicros(), level);
+    logArgs(b, args...);
+    push(record, b.length());
+  }
+
+  // Drain side, one task only. Each sends up to maxRecords records through out
+  // and returns how many were sent.
+  size_t drainBinary(Output out, size_t maxRecords);
+  size_t drainText(Output out, size_t maxRecords);
+
+  uint32_t writtenCount() const { return written.load(std::memory_order_relaxed); }
+  uint32_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+  size_t highWaterMark() const { return hwm.load(std::memory_order_relaxed); }
+  size_t pendingBytes() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+private:
+  bool push(const uint8_t* record, size_t len);
+  bool pop(uint8_t* record, size_t& len);
+  void sendFormat(Output out, const char* format);
+  bool formatSent(const char* format);
+
+  uint8_t ring[LOG_RING_BYTES];
+  std::atomic<uint32_t> head{0};
+  std::atomic<uint32_t> tail{0};
+  std::atomic_flag writeLock = ATOMIC_FLAG_INIT;
+  std::atomic<uint32_t> written{0};
+  std::atomic<uint32_t> dropped{0};
+  std::atomic<size_t> hwm{0};
+
+  // Drain task only
+  const char* sentFormats[LOG_FORMAT_CACHE];
+  uint8_t sentFormatCount = 0;
+  uint32_t recordsSinceResend = 0;
+};
+
+extern DeferredLog deferredLog;
+
+// "" fmt rejects anything but a string literal. Disabled levels still type-check
+// their arguments but compile to nothing.
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(fmt, ...) deferredLog.write(LOG_LEVEL_ERROR, "" fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...) do { if (0) deferredLog.write(LOG_LEVEL_ERROR, "" fmt, ##__VA_ARGS__); } while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(fmt, ...) deferredLog.write(LOG_LEVEL_WARN, "" fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(fmt, ...) do { if (0) deferredLog.write(LOG_LEVEL_WARN, "" fmt, ##__VA_ARGS__); } while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(fmt, ...) deferredLog.write(LOG_LEVEL_INFO, "" fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...) do { if (0) deferredLog.write(LOG_LEVEL_INFO, "" fmt, ##__VA_ARGS__); } while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(fmt, ...) deferredLog.write(LOG_LEVEL_DEBUG, "" fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...) do { if (0) deferredLog.write(LOG_LEVEL_DEBUG, "" fmt, ##__VA_ARGS__); } while (0)
+#endif
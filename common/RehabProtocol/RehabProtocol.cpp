@@ -0,0 +1,213 @@
+#include "RehabProtocol.h"
+
+#include <string.h>
+
+static void writeU16(uint8_t* out, uint16_t v) {
+  out[0] = (uint8_t)v;
+  out[1] = (uint8_t)(v >> 8);
+}
+
+static void writeU32(uint8_t* out, uint32_t v) {
+  out[0] = (uint8_t)v;
+  out[1] = (uint8_t)(v >> 8);
+  out[2] = (uint8_t)(v >> 16);
+  out[3] = (uint8_t)(v >> 24);
+}
+
+static void writeHeader(uint8_t* out, FrameType type, uint16_t seq) {
+  out[0] = PROTOCOL_VERSION;
+  out[1] = type;
+  writeU16(out + 2, seq);
+}
+
+// Rounds and clamps an angle to the int16 centidegree range
+static int16_t toCentidegrees(float angle) {
+  float centi = angle * 100.0f;
+  centi += centi < 0 ? -0.5f : 0.5f;
+  if (centi > 32767.0f) centi = 32767.0f;
+  if (centi < -32768.0f) centi = -32768.0f;
+  return (int16_t)centi;
+}
+
+size_t encodeSampleFrame(const SampleFrame& sample, uint8_t* out, size_t capacity) {
+  if (capacity < SAMPLE_FRAME_BYTES) {
+    return 0;
+  }
+
+  writeHeader(out, FRAME_SAMPLE, sample.seq);
+  writeU32(out + 4, sample.timestampMs);
+  writeU16(out + 8, (uint16_t)toCentidegrees(sample.angle));
+  writeU32(out + 10, sample.bendCount);
+  out[14] = sample.flags;
+  return SAMPLE_FRAME_BYTES;
+}
+
+// Scales and clamps a non-negative value into a u16
+static uint16_t toU16(float value, float scale) {
+  float scaled = value * scale + 0.5f;
+  if (scaled < 0.0f) return 0;
+  if (scaled > 65535.0f) return 65535;
+  return (uint16_t)scaled;
+}
+
+size_t encodeRepFrame(const RepFrame& rep, uint8_t* out, size_t capacity) {
+  if (capacity < REP_COMPACT_FRAME_BYTES) {
+    return 0;
+  }
+
+  writeHeader(out, FRAME_REP, rep.seq);
+  writeU16(out + 4, rep.rep);
+  writeU16(out + 6, rep.durationMs);
+  writeU16(out + 8, toU16(rep.romDeg, 100));
+  writeU16(out + 10, toU16(rep.peakVelocityDps, 10));
+  writeU16(out + 12, toU16(rep.meanVelocityDps, 10));
+  writeU16(out + 14, rep.tensionMs);
+  writeU16(out + 16, toU16(rep.cadenceRpm, 10));
+  writeU16(out + 18, toU16(rep.sessionMeanRomDeg, 100));
+  if (capacity < REP_FRAME_BYTES) {
+    return REP_COMPACT_FRAME_BYTES;
+  }
+  out[20] = rep.consistency;
+  return REP_FRAME_BYTES;
+}
+
+size_t encodeConfigFrame(const ConfigFrame& config, uint8_t* out, size_t capacity) {
+  if (capacity < CONFIG_FRAME_BYTES) {
+    return 0;
+  }
+
+  writeHeader(out, FRAME_CONFIG, config.seq);
+  writeU16(out + 4, toU16(config.thresholdMultiplier, 1000));
+  writeU16(out + 6, toU16(config.minDifference, 1000));
+  writeU16(out + 8, toU16(config.angleChangeTolerance, 100));
+  writeU16(out + 10, config.inactivityTimeoutS);
+  writeU32(out + 12, config.uploadIntervalMinMs);
+  writeU32(out + 16, config.uploadIntervalMaxMs);
+  out[20] = config.recordRateMinHz;
+  out[21] = config.recordRateMaxHz;
+  out[22] = config.streamRateMinHz;
+  out[23] = config.streamRateMaxHz;
+  writeU16(out + 24, toU16(config.activeRateDps, 10));
+  out[26] = (uint8_t)config.rssiFloorDbm;
+  writeU16(out + 27, config.latencyCeilingMs);
+  out[29] = config.flags;
+  return CONFIG_FRAME_BYTES;
+}
+
+size_t encodeStatusFrame(uint16_t seq, const char* text, uint8_t* out, size_t capacity) {
+  size_t textLength = strlen(text);
+  if (capacity > MAX_FRAME_BYTES) {
+    capacity = MAX_FRAME_BYTES;
+  }
+  if (capacity < FRAME_HEADER_BYTES) {
+    return 0;
+  }
+  // Long messages are cut rather than dropped
+  if (textLength > capacity - FRAME_HEADER_BYTES) {
+    textLength = capacity - FRAME_HEADER_BYTES;
+  }
+  writeHeader(out, FRAME_STATUS, seq);
+  memcpy(out + FRAME_HEADER_BYTES, text, textLength);
+  return FRAME_HEADER_BYTES + textLength;
+}
+
+size_t encodeStreamFrame(uint16_t seq, const StreamSample* samples, size_t count,
+                         uint8_t* out, size_t capacity, size_t& packed) {
+  packed = 0;
+  if (capacity > MAX_FRAME_BYTES) {
+    capacity = MAX_FRAME_BYTES;
+  }
+  size_t headerBytes = FRAME_HEADER_BYTES + STREAM_PAYLOAD_HEADER_BYTES;
+  if (count == 0 || capacity < headerBytes + STREAM_SAMPLE_BYTES) {
+    return 0;
+  }
+
+  size_t room = (capacity - headerBytes) / STREAM_SAMPLE_BYTES;
+  if (room > 255) {
+    room = 255;
+  }
+  uint32_t base = samples[0].timestampMs;
+  uint8_t* at = out + headerBytes;
+  while (packed < count && packed < room) {
+    uint32_t offset = samples[packed].timestampMs - base;
+    if (offset > 0xFFFF) {
+      break; // Leave it for the next frame, which gets its own base time
+    }
+    writeU16(at, (uint16_t)offset);
+    writeU16(at + 2, (uint16_t)toCentidegrees(samples[packed].angle));
+    at += STREAM_SAMPLE_BYTES;
+    packed++;
+  }
+
+  writeHeader(out, FRAME_STREAM, seq);
+  writeU32(out + 4, base);
+  out[8] = (uint8_t)packed;
+  return headerBytes + packed * STREAM_SAMPLE_BYTES;
+}
+
+ParseResult FrameView::parse() const {
+  if (data == nullptr || length < FRAME_HEADER_BYTES) {
+    return PARSE_TOO_SHORT;
+  }
+  if (data[0] != PROTOCOL_VERSION) {
+    return PARSE_BAD_VERSION;
+  }
+  switch (data[1]) {
+    case FRAME_SAMPLE:
+      // Newer minor revisions may append fields; accept and ignore the extra bytes
+      return length >= SAMPLE_FRAME_BYTES ? PARSE_OK : PARSE_BAD_LENGTH;
+    case FRAME_STREAM:
+      if (length < FRAME_HEADER_BYTES + STREAM_PAYLOAD_HEADER_BYTES) {
+        return PARSE_BAD_LENGTH;
+      }
+      return length >= FRAME_HEADER_BYTES + STREAM_PAYLOAD_HEADER_BYTES + (size_t)data[8] * STREAM_SAMPLE_BYTES
+                 ? PARSE_OK : PARSE_BAD_LENGTH;
+    case FRAME_STATUS:
+      return length <= MAX_FRAME_BYTES ? PARSE_OK : PARSE_BAD_LENGTH;
+    case FRAME_REP:
+      return length >= REP_COMPACT_FRAME_BYTES ? PARSE_OK : PARSE_BAD_LENGTH;
+    case FRAME_CONFIG:
+      return length >= CONFIG_FRAME_BYTES ? PARSE_OK : PARSE_BAD_LENGTH;
+    default:
+      return PARSE_BAD_TYPE;
+  }
+}
+
+void FrameView::toSample(SampleFrame& out) const {
+  out.seq = seq();
+  out.timestampMs = timestampMs();
+  out.angle = angle();
+  out.bendCount = bendCount();
+  out.flags = flags();
+}
+
+void FrameView::toRep(RepFrame& out) const {
+  out.seq = seq();
+  out.rep = readU16(4);
+  out.durationMs = readU16(6);
+  out.romDeg = readU16(8) / 100.0f;
+  out.peakVelocityDps = readU16(10) / 10.0f;
+  out.meanVelocityDps = readU16(12) / 10.0f;
+  out.tensionMs = readU16(14);
+  out.cadenceRpm = readU16(16) / 10.0f;
+  out.sessionMeanRomDeg = readU16(18) / 100.0f;
+  out.consistency = length >= REP_FRAME_BYTES ? data[20] : REP_CONSISTENCY_UNKNOWN;
+}
+
+void FrameView::toConfig(ConfigFrame& out) const {
+  out.seq = seq();
+  out.thresholdMultiplier = readU16(4) / 1000.0f;
+  out.minDifference = readU16(6) / 1000.0f;
+  out.angleChangeTolerance = readU16(8) / 100.0f;
+  out.inactivityTimeoutS = readU16(10);
+  out.uploadIntervalMinMs = readU32(12);
+  out.uploadIntervalMaxMs = readU32(16);
+  out.recordRateMinHz = data[20];
+  out.recordRateMaxHz = data[21];
+  out.streamRateMinHz = data[22];
+  out.streamRateMaxHz = data[23];
+  out.activeRateDps = readU16(24) / 10.0f;
+  out.rssiFloorDbm = (int8_t)data[26];
+  out.latencyCeilingMs = readU16(27);
+  out.flags = data[29];
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// BLE protocol shared by the sensing server and the display client.
+//
+// Every notification is one little-endian frame:
+//   [version:u8][type:u8][seq:u16][payload...]
+// SAMPLE payload: [timestampMs:u32][angle centidegrees:i16][bendCount:u32][flags:u8]
+// STATUS payload: UTF-8 text, not NUL-terminated, length implied by the frame
+// STREAM payload: [baseTimestampMs:u32][count:u8] then count x [offsetMs:u16][angle centidegrees:i16]
+// REP payload:    [rep:u16][durationMs:u16][rom centidegrees:u16][peak velocity 0.1 deg/s:u16]
+//                 [mean velocity 0.1 deg/s:u16][timeUnderTensionMs:u16][cadence 0.1 reps/min:u16]
+//                 [session mean rom centidegrees:u16][consistency %:u8]
+//                 On a link still at the default 23-byte MTU the consistency byte is
+//                 left off, so the frame fits the 20-byte notification payload.
+// CONFIG payload: [threshold multiplier x1000:u16][min difference mG:u16][angle tolerance centidegrees:u16]
+//                 [inactivity timeout s:u16][upload interval min ms:u32][upload interval max ms:u32]
+//                 [record rate min Hz:u8][record rate max Hz:u8][stream rate min Hz:u8][stream rate max Hz:u8]
+//                 [active rate 0.1 deg/s:u16][rssi floor dBm:i8][latency ceiling ms:u16][flags:u8]
+//                 Read from, and written to, the config characteristic rather than notified.
+//
+// Parsing works in place on the received buffer: no copies, no allocation.
+
+#define SERVICE_UUID        "49c1c51a-6e2c-48a4-8fde-3e9a02711aed"
+#define CHARACTERISTIC_UUID "bbd6bbb3-318c-4c13-b4f9-d60f6aca4a2e"
+#define STREAM_CHARACTERISTIC_UUID "bbd6bbb4-318c-4c13-b4f9-d60f6aca4a2e" // Continuous angle samples
+#define DIAGNOSTICS_CHARACTERISTIC_UUID "bbd6bbb5-318c-4c13-b4f9-d60f6aca4a2e" // Read-only profiler report, plain text
+#define CONFIG_CHARACTERISTIC_UUID "bbd6bbb6-318c-4c13-b4f9-d60f6aca4a2e" // Read/write CONFIG frame
+
+#define PROTOCOL_VERSION 1
+
+#define FRAME_HEADER_BYTES 4
+#define SAMPLE_PAYLOAD_BYTES 11
+#define SAMPLE_FRAME_BYTES (FRAME_HEADER_BYTES + SAMPLE_PAYLOAD_BYTES)
+#define STREAM_PAYLOAD_HEADER_BYTES 5
+#define STREAM_SAMPLE_BYTES 4
+#define REP_PAYLOAD_BYTES 17
+#define REP_FRAME_BYTES (FRAME_HEADER_BYTES + REP_PAYLOAD_BYTES)
+#define REP_COMPACT_FRAME_BYTES (REP_FRAME_BYTES - 1) // Without consistency
+#define CONFIG_PAYLOAD_BYTES 26
+#define CONFIG_FRAME_BYTES (FRAME_HEADER_BYTES + CONFIG_PAYLOAD_BYTES)
+#define MAX_FRAME_BYTES 244 // Largest notification payload: 247-byte ATT MTU minus 3 header bytes
+
+enum FrameType : uint8_t {
+  FRAME_SAMPLE = 1,
+  FRAME_STATUS = 2,
+  FRAME_STREAM = 3,
+  FRAME_REP = 4,
+  FRAME_CONFIG = 5,
+};
+
+// SAMPLE flags
+#define SAMPLE_FLAG_BEND        0x01 // Sent because a bend was just detected
+#define SAMPLE_FLAG_TIME_SYNCED 0x02 // Server clock has been set from NTP
+
+// CONFIG flags
+#define CONFIG_FLAG_ADAPTIVE 0x01 // Rates follow activity and link quality; otherwise they stay at max
+
+enum ParseResult : uint8_t {
+  PARSE_OK = 0,
+  PARSE_TOO_SHORT,
+  PARSE_BAD_VERSION,
+  PARSE_BAD_TYPE,
+  PARSE_BAD_LENGTH,
+};
+
+struct SampleFrame {
+  uint16_t seq;
+  uint32_t timestampMs;
+  float angle;        // degrees, sent with 0.01 degree resolution
+  uint32_t bendCount;
+  uint8_t flags;
+};
+
+// One finished rep plus the running session figures, sent as it completes
+struct RepFrame {
+  uint16_t seq;
+  uint16_t rep;                // 1-based within the session, which is also the session rep count
+  uint16_t durationMs;
+  float romDeg;
+  float peakVelocityDps;
+  float meanVelocityDps;
+  uint16_t tensionMs;
+  float cadenceRpm;
+  float sessionMeanRomDeg;
+  uint8_t consistency;         // 0-100, REP_CONSISTENCY_UNKNOWN from a compact frame
+};
+
+#define REP_CONSISTENCY_UNKNOWN 0xFF
+
+// Detection thresholds and rate limits, tunable live per patient
+struct ConfigFrame {
+  uint16_t seq;
+  float thresholdMultiplier;
+  float minDifference;         // G
+  float angleChangeTolerance;  // degrees
+  uint16_t inactivityTimeoutS; // 0 never disconnects
+  uint32_t uploadIntervalMinMs;
+  uint32_t uploadIntervalMaxMs;
+  uint8_t recordRateMinHz;
+  uint8_t recordRateMaxHz;
+  uint8_t streamRateMinHz;
+  uint8_t streamRateMaxHz;
+  float activeRateDps;         // Joint rate above which the patient counts as exercising
+  int8_t rssiFloorDbm;         // WiFi RSSI below this counts as a poor link
+  uint16_t latencyCeilingMs;   // Upload latency above this counts as a poor link
+  uint8_t flags;
+};
+
+struct StreamSample {
+  uint32_t timestampMs;
+  float angle; // degrees
+};
+
+// Encoders return the number of bytes written, or 0 if out is too small.
+size_t encodeSampleFrame(const SampleFrame& sample, uint8_t* out, size_t capacity);
+size_t encodeStatusFrame(uint16_t seq, const char* text, uint8_t* out, size_t capacity);
+// A REP frame falls back to the compact form when capacity is one byte short.
+size_t encodeRepFrame(const RepFrame& rep, uint8_t* out, size_t capacity);
+size_t encodeConfigFrame(const ConfigFrame& config, uint8_t* out, size_t capacity);
+// Packs as many of the samples as fit in capacity (and within 65 s of the first);
+// packed is set to how many went in.
+size_t encodeStreamFrame(uint16_t seq, const StreamSample* samples, size_t count,
+                         uint8_t* out, size_t capacity, size_t& packed);
+
+// Read-only view over a received frame. Call parse() before any accessor.
+class FrameView {
+public:
+  FrameView(const uint8_t* data, size_t length) : data(data), length(length) {}
+
+  ParseResult parse() const;
+
+  FrameType type() const { return (FrameType)data[1]; }
+  uint16_t seq() const { return readU16(2); }
+
+  // SAMPLE accessors
+  uint32_t timestampMs() const { return readU32(4); }
+  float angle() const { return (int16_t)readU16(8) / 100.0f; }
+  uint32_t bendCount() const { return readU32(10); }
+  uint8_t flags() const { return data[14]; }
+  void toSample(SampleFrame& out) const;
+
+  // STREAM accessors
+  uint8_t streamCount() const { return data[8]; }
+  void streamSample(size_t i, StreamSample& out) const {
+    size_t at = FRAME_HEADER_BYTES + STREAM_PAYLOAD_HEADER_BYTES + i * STREAM_SAMPLE_BYTES;
+    out.timestampMs = readU32(4) + readU16(at);
+    out.angle = (int16_t)readU16(at + 2) / 100.0f;
+  }
+
+  // REP accessor
+  void toRep(RepFrame& out) const;
+
+  // CONFIG accessor
+  void toConfig(ConfigFrame& out) const;
+
+  // STATUS accessors; the text is not NUL-terminated
+  const char* statusText() const { return (const char*)data + FRAME_HEADER_BYTES; }
+  size_t statusLength() const { return length - FRAME_HEADER_BYTES; }
+
+private:
+  uint16_t readU16(size_t at) const { return (uint16_t)(data[at] | (data[at + 1] << 8)); }
+  uint32_t readU32(size_t at) const {
+    return (uint32_t)data[at] | ((uint32_t)data[at + 1] << 8) |
+           ((uint32_t)data[at + 2] << 16) | ((uint32_t)data[at + 3] << 24);
+  }
+
+  const uint8_t* data;
+  size_t length;
+};
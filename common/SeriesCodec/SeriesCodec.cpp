@@ -0,0 +1,474 @@
+#include "SeriesCodec.h"
+
+#include <string.h>
+
+enum {
+  COLUMN_TIME,
+  COLUMN_SEQ,
+  COLUMN_PITCH,
+  COLUMN_GYRO,
+  COLUMN_BENDS,
+};
+
+// Worst-case bits one row can add to each column, checked before every add()
+static const uint8_t worstBits[SERIES_COLUMNS] = {36, 41, 44, 44, 41};
+
+static inline uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+static inline int32_t unzigzag(uint32_t u) { return (int32_t)((u >> 1) ^ (0u - (u & 1))); }
+
+static void putU16(uint8_t* p, uint16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+static void putU32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; i++) {
+    p[i] = (v >> (8 * i)) & 0xFF;
+  }
+}
+
+static void putU64(uint8_t* p, uint64_t v) {
+  putU32(p, (uint32_t)v);
+  putU32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint16_t getU16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+static uint32_t getU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t getU64(const uint8_t* p) { return getU32(p) | ((uint64_t)getU32(p + 4) << 32); }
+
+// --- Bit streams ---
+
+void BitWriter::write(uint32_t value, uint8_t n) {
+  if (used + n > capacityBits) {
+    return; // add() reserves room up front, so this only guards direct misuse
+  }
+  while (n > 0) {
+    size_t index = used >> 3;
+    uint8_t offset = used & 7;
+    uint8_t room = 8 - offset;
+    uint8_t take = n < room ? n : room;
+    uint8_t chunk = (value >> (n - take)) & ((1u << take) - 1);
+    if (offset == 0) {
+      buf[index] = 0;
+    }
+    buf[index] |= chunk << (room - take);
+    used += take;
+    n -= take;
+  }
+}
+
+void BitWriter::writeVarint(uint32_t value) {
+  while (value >= 0x80) {
+    write((value & 0x7F) | 0x80, 8);
+    value >>= 7;
+  }
+  write(value, 8);
+}
+
+bool BitReader::read(uint8_t n, uint32_t& value) {
+  if (pos + n > lengthBits) {
+    return false;
+  }
+  uint32_t v = 0;
+  while (n > 0) {
+    uint8_t offset = pos & 7;
+    uint8_t room = 8 - offset;
+    uint8_t take = n < room ? n : room;
+    uint8_t chunk = (buf[pos >> 3] >> (room - take)) & ((1u << take) - 1);
+    v = (v << take) | chunk;
+    pos += take;
+    n -= take;
+  }
+  value = v;
+  return true;
+}
+
+bool BitReader::readVarint(uint32_t& value) {
+  uint32_t v = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7) {
+    uint32_t byte;
+    if (!read(8, byte)) {
+      return false;
+    }
+    v |= (byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      value = v;
+      return true;
+    }
+  }
+  return false; // More than 5 bytes can't be a 32-bit value
+}
+
+// --- Encoder ---
+
+SeriesEncoder::SeriesEncoder(uint8_t dropMantissaBits)
+  : dropBits(dropMantissaBits > 23 ? 23 : dropMantissaBits),
+    writers{
+      BitWriter(columns[0], SERIES_COLUMN_BYTES), BitWriter(columns[1], SERIES_COLUMN_BYTES),
+      BitWriter(columns[2], SERIES_COLUMN_BYTES), BitWriter(columns[3], SERIES_COLUMN_BYTES),
+      BitWriter(columns[4], SERIES_COLUMN_BYTES),
+    } {
+  begin(0, 0);
+}
+
+void SeriesEncoder::begin(uint32_t bootId, uint64_t epochMicros) {
+  header.version = SERIES_VERSION;
+  header.flags = epochMicros != 0 ? SERIES_FLAG_EPOCH : 0;
+  header.count = 0;
+  header.bootId = bootId;
+  header.epochMicros = epochMicros;
+  header.firstUptimeMs = 0;
+  header.firstSeq = 0;
+  header.dropMantissaBits = dropBits;
+  rows = 0;
+  lastDelta = 0;
+  memset(&last, 0, sizeof(last));
+  memset(&pitchState, 0, sizeof(pitchState));
+  memset(&gyroState, 0, sizeof(gyroState));
+  for (uint8_t i = 0; i < SERIES_COLUMNS; i++) {
+    writers[i].reset();
+  }
+}
+
+bool SeriesEncoder::add(const SeriesRow& row) {
+  if (rows == UINT16_MAX) {
+    return false;
+  }
+  for (uint8_t i = 0; i < SERIES_COLUMNS; i++) {
+    if (writers[i].remainingBits() < worstBits[i]) {
+      return false;
+    }
+  }
+
+  if (rows == 0) {
+    header.firstUptimeMs = row.uptimeMs;
+    header.firstSeq = row.seq;
+    last.uptimeMs = row.uptimeMs;
+    last.seq = row.seq;
+  }
+
+  // Delta-of-delta: a steady sample interval costs one bit
+  int32_t delta = (int32_t)(row.uptimeMs - last.uptimeMs);
+  int32_t dod = delta - lastDelta;
+  lastDelta = delta;
+  BitWriter& time = writers[COLUMN_TIME];
+  uint32_t z = zigzag(dod);
+  if (dod == 0) {
+    time.write(0, 1);
+  } else if (z < (1u << 7)) {
+    time.write(0x2, 2);
+    time.write(z, 7);
+  } else if (z < (1u << 9)) {
+    time.write(0x6, 3);
+    time.write(z, 9);
+  } else if (z < (1u << 12)) {
+    time.write(0xE, 4);
+    time.write(z, 12);
+  } else {
+    time.write(0xF, 4);
+    time.write(z, 32);
+  }
+
+  putCounter(writers[COLUMN_SEQ], (int32_t)(row.seq - last.seq), rows == 0 ? 0 : 1);
+  putFloat(writers[COLUMN_PITCH], pitchState, row.pitch);
+  putFloat(writers[COLUMN_GYRO], gyroState, row.gyroY);
+  putCounter(writers[COLUMN_BENDS], (int32_t)(row.bendCount - last.bendCount), 0);
+
+  last = row;
+  rows++;
+  return true;
+}
+
+uint32_t SeriesEncoder::quantize(float value) const {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  if (dropBits > 0 && (bits & 0x7F800000) != 0x7F800000) {
+    // Round to nearest; a carry into the exponent is still the right value
+    bits = (bits + (1u << (dropBits - 1))) & ~((1u << dropBits) - 1);
+  }
+  return bits;
+}
+
+void SeriesEncoder::putFloat(BitWriter& w, FloatState& state, float value) {
+  uint32_t bits = quantize(value);
+  uint32_t x = bits ^ state.prev;
+  state.prev = bits;
+  if (x == 0) {
+    w.write(0, 1);
+    return;
+  }
+
+  uint8_t leading = __builtin_clz(x);
+  uint8_t trailing = __builtin_ctz(x);
+  if (state.window && leading >= state.leading && trailing >= state.trailing) {
+    // Fits the previous meaningful-bit window, so skip re-sending it
+    w.write(0x2, 2);
+    w.write(x >> state.trailing, 32 - state.leading - state.trailing);
+  } else {
+    uint8_t length = 32 - leading - trailing;
+    w.write(0x3, 2);
+    w.write(leading, 5);
+    w.write(length - 1, 5);
+    w.write(x >> trailing, length);
+    state.leading = leading;
+    state.trailing = trailing;
+    state.window = true;
+  }
+}
+
+void SeriesEncoder::putCounter(BitWriter& w, int32_t delta, int32_t expected) {
+  if (delta == expected) {
+    w.write(0, 1);
+  } else {
+    w.write(1, 1);
+    w.writeVarint(zigzag(delta));
+  }
+}
+
+size_t SeriesEncoder::encodedBytes() const {
+  size_t total = SERIES_HEADER_BYTES;
+  for (uint8_t i = 0; i < SERIES_COLUMNS; i++) {
+    total += writers[i].bytes();
+  }
+  return total;
+}
+
+size_t SeriesEncoder::finish(uint8_t* out, size_t capacity) {
+  size_t total = encodedBytes();
+  if (rows == 0 || total > capacity) {
+    return 0;
+  }
+
+  header.count = rows;
+  out[0] = header.version;
+  out[1] = header.flags;
+  putU16(out + 2, header.count);
+  putU32(out + 4, header.bootId);
+  putU64(out + 8, header.epochMicros);
+  putU32(out + 16, header.firstUptimeMs);
+  putU32(out + 20, header.firstSeq);
+  out[24] = header.dropMantissaBits;
+
+  size_t offset = SERIES_HEADER_BYTES;
+  for (uint8_t i = 0; i < SERIES_COLUMNS; i++) {
+    size_t length = writers[i].bytes();
+    putU16(out + 25 + 2 * i, (uint16_t)length);
+    memcpy(out + offset, columns[i], length);
+    offset += length;
+  }
+  return total;
+}
+
+// --- Decoder ---
+
+bool SeriesDecoder::begin(const uint8_t* data, size_t length) {
+  decoded = 0;
+  head.count = 0;
+  if (length < SERIES_HEADER_BYTES) {
+    return false;
+  }
+
+  head.version = data[0];
+  head.flags = data[1];
+  head.count = getU16(data + 2);
+  head.bootId = getU32(data + 4);
+  head.epochMicros = getU64(data + 8);
+  head.firstUptimeMs = getU32(data + 16);
+  head.firstSeq = getU32(data + 20);
+  head.dropMantissaBits = data[24];
+  if (head.version != SERIES_VERSION || head.dropMantissaBits > 23) {
+    head.count = 0;
+    return false;
+  }
+
+  size_t offset = SERIES_HEADER_BYTES;
+  for (uint8_t i = 0; i < SERIES_COLUMNS; i++) {
+    size_t columnBytes = getU16(data + 25 + 2 * i);
+    if (offset + columnBytes > length) {
+      head.count = 0;
+      return false;
+    }
+    readers[i] = BitReader(data + offset, columnBytes);
+    offset += columnBytes;
+  }
+
+  memset(&last, 0, sizeof(last));
+  last.uptimeMs = head.firstUptimeMs;
+  last.seq = head.firstSeq;
+  lastDelta = 0;
+  memset(&pitchState, 0, sizeof(pitchState));
+  memset(&gyroState, 0, sizeof(gyroState));
+  return true;
+}
+
+bool SeriesDecoder::next(SeriesRow& row) {
+  if (decoded >= head.count) {
+    return false;
+  }
+
+  BitReader& time = readers[COLUMN_TIME];
+  uint32_t flag;
+  uint8_t width = 0;
+  for (uint8_t prefix = 0; prefix < 4; prefix++) {
+    if (!time.read(1, flag)) {
+      return false;
+    }
+    if (!flag) {
+      static const uint8_t widths[] = {0, 7, 9, 12};
+      width = widths[prefix];
+      break;
+    }
+    width = 32;
+  }
+  int32_t dod = 0;
+  if (width > 0) {
+    uint32_t z;
+    if (!time.read(width, z)) {
+      return false;
+    }
+    dod = unzigzag(z);
+  }
+  lastDelta += dod;
+
+  int32_t seqDelta, bendDelta;
+  SeriesRow out;
+  out.uptimeMs = last.uptimeMs + (uint32_t)lastDelta;
+  if (!getCounter(readers[COLUMN_SEQ], decoded == 0 ? 0 : 1, seqDelta) ||
+      !getFloat(readers[COLUMN_PITCH], pitchState, out.pitch) ||
+      !getFloat(readers[COLUMN_GYRO], gyroState, out.gyroY) ||
+      !getCounter(readers[COLUMN_BENDS], 0, bendDelta)) {
+    return false;
+  }
+  out.seq = last.seq + (uint32_t)seqDelta;
+  out.bendCount = last.bendCount + (uint32_t)bendDelta;
+
+  last = out;
+  row = out;
+  decoded++;
+  return true;
+}
+
+bool SeriesDecoder::getFloat(BitReader& r, FloatState& state, float& value) {
+  uint32_t flag;
+  if (!r.read(1, flag)) {
+    return false;
+  }
+  if (flag) {
+    if (!r.read(1, flag)) {
+      return false;
+    }
+    uint32_t meaningful;
+    if (!flag) {
+      if (!state.window || !r.read(32 - state.leading - state.trailing, meaningful)) {
+        return false;
+      }
+      state.prev ^= meaningful << state.trailing;
+    } else {
+      uint32_t leading, length;
+      if (!r.read(5, leading) || !r.read(5, length)) {
+        return false;
+      }
+      length += 1;
+      if (leading + length > 32 || !r.read(length, meaningful)) {
+        return false;
+      }
+      state.leading = leading;
+      state.trailing = 32 - leading - length;
+      state.window = true;
+      state.prev ^= meaningful << state.trailing;
+    }
+  }
+  memcpy(&value, &state.prev, sizeof(value));
+  return true;
+}
+
+bool SeriesDecoder::getCounter(BitReader& r, int32_t expected, int32_t& delta) {
+  uint32_t flag;
+  if (!r.read(1, flag)) {
+    return false;
+  }
+  if (!flag) {
+    delta = expected;
+    return true;
+  }
+  uint32_t z;
+  if (!r.readVarint(z)) {
+    return false;
+  }
+  delta = unzigzag(z);
+  return true;
+}
+
+uint64_t SeriesDecoder::epochMicrosOf(const SeriesRow& row) const {
+  if (!(head.flags & SERIES_FLAG_EPOCH)) {
+    return 0;
+  }
+  return head.epochMicros + (uint64_t)(row.uptimeMs - head.firstUptimeMs) * 1000;
+}
+
+// --- Base64 ---
+
+static const char base64Alphabet[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+size_t base64Encode(const uint8_t* data, size_t length, char* out, size_t capacity) {
+  size_t needed = (length + 2) / 3 * 4;
+  if (needed + 1 > capacity) {
+    return 0;
+  }
+  size_t o = 0;
+  for (size_t i = 0; i < length; i += 3) {
+    uint32_t v = (uint32_t)data[i] << 16;
+    if (i + 1 < length) v |= (uint32_t)data[i + 1] << 8;
+    if (i + 2 < length) v |= data[i + 2];
+    out[o++] = base64Alphabet[(v >> 18) & 0x3F];
+    out[o++] = base64Alphabet[(v >> 12) & 0x3F];
+    out[o++] = i + 1 < length ? base64Alphabet[(v >> 6) & 0x3F] : '=';
+    out[o++] = i + 2 < length ? base64Alphabet[v & 0x3F] : '=';
+  }
+  out[o] = '\0';
+  return o;
+}
+
+static int base64Value(char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '+') return 62;
+  if (c == '/') return 63;
+  return -1;
+}
+
+size_t base64Decode(const char* text, size_t length, uint8_t* out, size_t capacity) {
+  if (length % 4 != 0) {
+    return 0;
+  }
+  size_t o = 0;
+  for (size_t i = 0; i < length; i += 4) {
+    int pad = 0;
+    uint32_t v = 0;
+    for (int k = 0; k < 4; k++) {
+      char c = text[i + k];
+      int x;
+      if (c == '=' && i + 4 == length && k >= 2) {
+        pad++;
+        x = 0;
+      } else if (pad > 0 || (x = base64Value(c)) < 0) {
+        return 0;
+      }
+      v = (v << 6) | (uint32_t)x;
+    }
+    size_t bytes = 3 - pad;
+    if (o + bytes > capacity) {
+      return 0;
+    }
+    out[o++] = (v >> 16) & 0xFF;
+    if (bytes > 1) out[o++] = (v >> 8) & 0xFF;
+    if (bytes > 2) out[o++] = v & 0xFF;
+  }
+  return o;
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compact columnar encoding for batches of IMU upload rows, Gorilla style:
+//   uptimeMs   delta-of-delta, 1 bit when the sample interval is steady
+//   seq        1 bit when it steps by one, else a zigzag varint of the delta
+//   pitch      XOR with the previous value, sharing the leading/trailing zero window
+//   gyroY      same as pitch
+//   bendCount  1 bit when unchanged, else a zigzag varint of the delta
+//
+// Block layout (little-endian):
+//   [version:u8][flags:u8][count:u16][bootId:u32][epochMicros:u64][firstUptimeMs:u32]
+//   [firstSeq:u32][dropMantissaBits:u8][5 x column bytes:u16][columns in the order above]
+// epochMicros is the wall time of the first row when SERIES_FLAG_EPOCH is set;
+// later rows are placed from their uptime. Version 1 had epochSeconds:u32 there.
+//
+// The encoder is streaming with fixed memory: each column has SERIES_COLUMN_BYTES
+// and add() refuses a row that might not fit, at which point the caller finishes
+// the block and starts another. The decoder checks every bound, so it is safe on
+// untrusted input (e.g. in the backend).
+
+#ifndef SERIES_COLUMN_BYTES
+#define SERIES_COLUMN_BYTES 512
+#endif
+
+#define SERIES_VERSION 2
+#define SERIES_HEADER_BYTES 35
+#define SERIES_COLUMNS 5
+#define SERIES_MAX_BLOCK_BYTES (SERIES_HEADER_BYTES + SERIES_COLUMNS * SERIES_COLUMN_BYTES)
+#define SERIES_FLAG_EPOCH 0x01
+
+struct SeriesRow {
+  uint32_t uptimeMs;
+  uint32_t seq;
+  float pitch;
+  float gyroY;
+  uint32_t bendCount;
+};
+
+struct SeriesHeader {
+  uint8_t version;
+  uint8_t flags;
+  uint16_t count;
+  uint32_t bootId;
+  uint64_t epochMicros;
+  uint32_t firstUptimeMs;
+  uint32_t firstSeq;
+  uint8_t dropMantissaBits;
+};
+
+class BitWriter {
+public:
+  BitWriter(uint8_t* buf, size_t capacityBytes) : buf(buf), capacityBits(capacityBytes * 8) {}
+
+  // Writes the low n bits of value (n <= 32), most significant first
+  void write(uint32_t value, uint8_t n);
+  void writeVarint(uint32_t value);
+
+  size_t bits() const { return used; }
+  size_t bytes() const { return (used + 7) / 8; }
+  size_t remainingBits() const { return capacityBits - used; }
+  void reset() { used = 0; }
+
+private:
+  uint8_t* buf;
+  size_t capacityBits;
+  size_t used = 0;
+};
+
+class BitReader {
+public:
+  BitReader(const uint8_t* buf, size_t lengthBytes) : buf(buf), lengthBits(lengthBytes * 8) {}
+
+  // Returns false (and leaves value alone) past the end
+  bool read(uint8_t n, uint32_t& value);
+  bool readVarint(uint32_t& value);
+
+private:
+  const uint8_t* buf;
+  size_t lengthBits;
+  size_t pos = 0;
+};
+
+class SeriesEncoder {
+public:
+  // dropMantissaBits > 0 rounds the floats to fewer mantissa bits before XOR
+  // coding: lossy, but the relative error stays under 2^(dropMantissaBits - 24).
+  SeriesEncoder(uint8_t dropMantissaBits = 0);
+
+  // epochMicros is the wall time of the first row, 0 if unknown
+  void begin(uint32_t bootId, uint64_t epochMicros);
+  // Returns false if the row might not fit; finish() this block and begin another.
+  bool add(const SeriesRow& row);
+  // Writes the block, returns its length (0 if out is too small or it's empty)
+  size_t finish(uint8_t* out, size_t capacity);
+
+  uint16_t count() const { return rows; }
+  size_t encodedBytes() const;
+
+private:
+  struct FloatState {
+    uint32_t prev;
+    uint8_t leading;
+    uint8_t trailing;
+    bool window;
+  };
+
+  uint32_t quantize(float value) const;
+  void putFloat(BitWriter& w, FloatState& state, float value);
+  void putCounter(BitWriter& w, int32_t delta, int32_t expected);
+
+  uint8_t dropBits;
+  SeriesHeader header;
+  uint16_t rows = 0;
+  SeriesRow last;
+  int32_t lastDelta = 0;
+  FloatState pitchState;
+  FloatState gyroState;
+
+  uint8_t columns[SERIES_COLUMNS][SERIES_COLUMN_BYTES];
+  BitWriter writers[SERIES_COLUMNS];
+};
+
+class SeriesDecoder {
+public:
+  // Parses the block header; false if the block is malformed or a newer version
+  bool begin(const uint8_t* data, size_t length);
+  const SeriesHeader& header() const { return head; }
+  // Next row, false at the end or if a column is truncated
+  bool next(SeriesRow& row);
+  // Wall time of a row in epoch microseconds, 0 if the block has none
+  uint64_t epochMicrosOf(const SeriesRow& row) const;
+
+private:
+  struct FloatState {
+    uint32_t prev;
+    uint8_t leading;
+    uint8_t trailing;
+    bool window;
+  };
+
+  bool getFloat(BitReader& r, FloatState& state, float& value);
+  bool getCounter(BitReader& r, int32_t expected, int32_t& delta);
+
+  SeriesHeader head;
+  uint16_t decoded = 0;
+  SeriesRow last;
+  int32_t lastDelta = 0;
+  FloatState pitchState;
+  FloatState gyroState;
+  BitReader readers[SERIES_COLUMNS] = {
+    BitReader(nullptr, 0), BitReader(nullptr, 0), BitReader(nullptr, 0),
+    BitReader(nullptr, 0), BitReader(nullptr, 0),
+  };
+};
+
+// Standard base64 (with padding), for carrying blocks in JSON. Both return the
+// output length, or 0 if it doesn't fit / the input isn't valid base64.
+size_t base64Encode(const uint8_t* data, size_t length, char* out, size_t capacity);
+size_t base64Decode(const char* text, size_t length, uint8_t* out, size_t capacity);
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Wait-free single-producer/single-consumer ring buffer. One task may call push(),
+// one other task may call pop(); neither ever blocks or takes a lock. When the
+// queue is full push() fails and the overrun counter goes up, so the producer
+// (the sensing task, a BLE callback) is never held up by a slow consumer.
+template <typename T, size_t Capacity>
+class SpscQueue {
+public:
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "capacity must be a power of two");
+
+  // Producer side
+  bool push(const T& item) {
+    size_t head = headIndex.load(std::memory_order_relaxed);
+    size_t tail = tailIndex.load(std::memory_order_acquire);
+    if (head - tail >= Capacity) {
+      overrunCount.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    slots[head & (Capacity - 1)] = item;
+    headIndex.store(head + 1, std::memory_order_release);
+
+    size_t depth = head + 1 - tail;
+    if (depth > highWater.load(std::memory_order_relaxed)) {
+      highWater.store(depth, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  // Consumer side
+  bool pop(T& out) {
+    size_t tail = tailIndex.load(std::memory_order_relaxed);
+    size_t head = headIndex.load(std::memory_order_acquire);
+    if (tail == head) {
+      return false;
+    }
+    out = slots[tail & (Capacity - 1)];
+    tailIndex.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Safe from either side or a third task; only a snapshot
+  size_t size() const {
+    return headIndex.load(std::memory_order_acquire) - tailIndex.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+  size_t capacity() const { return Capacity; }
+  size_t highWaterMark() const { return highWater.load(std::memory_order_relaxed); }
+  uint32_t overruns() const { return overrunCount.load(std::memory_order_relaxed); }
+
+private:
+  T slots[Capacity];
+  // Free-running indices; unsigned wrap keeps head - tail correct
+  std::atomic<size_t> headIndex{0};
+  std::atomic<size_t> tailIndex{0};
+  std::atomic<size_t> highWater{0};
+  std::atomic<uint32_t> overrunCount{0};
+};
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+
+// Streaming bend (peak) detector. Everything lives in fixed-size members, so there
+// is no heap use and each update is O(1) regardless of the window length. No
+// Arduino headers are pulled in, so this also builds for the native environment.
+// T is float or one of the Fixed types from SensingMath.h; filter design runs in
+// double at setup so only the per-sample math is in T.
+
+// Fixed-length moving window that keeps a running sum instead of re-summing.
+template <typename T, size_t N>
+class RunningWindow {
+public:
+  static_assert(N > 0, "window length must be non-zero");
+
+  void push(T x) {
+    if (count < N) {
+      count++;
+    } else {
+      sum -= buf[head];
+    }
+    buf[head] = x;
+    sum += x;
+    head++;
+    if (head == N) {
+      head = 0;
+      // Re-sum once per lap so floating point add/subtract error can't build up
+      recompute();
+    }
+  }
+
+  T mean() const { return count == 0 ? T(0) : sum / T(count); }
+  size_t size() const { return count; }
+  bool full() const { return count == N; }
+  void reset() { head = 0; count = 0; sum = T(0); }
+
+private:
+  void recompute() {
+    T s = T(0);
+    for (size_t i = 0; i < count; i++) {
+      s += buf[i];
+    }
+    sum = s;
+  }
+
+  T buf[N];
+  size_t head = 0;
+  size_t count = 0;
+  T sum = T(0);
+};
+
+// Pass-through prefilter, the default.
+template <typename T>
+struct NoFilter {
+  T process(T x) { return x; }
+  void reset() {}
+};
+
+// First-order low-pass: y += alpha * (x - y).
+template <typename T>
+class OnePoleLowPass {
+public:
+  OnePoleLowPass(T alpha = T(1)) : alpha(alpha) {}
+
+  static OnePoleLowPass fromCutoff(double sampleRateHz, double cutoffHz) {
+    double dt = 1 / sampleRateHz;
+    double rc = 1 / (2 * M_PI * cutoffHz);
+    return OnePoleLowPass(T(dt / (rc + dt)));
+  }
+
+  T process(T x) {
+    if (!primed) {
+      y = x;
+      primed = true;
+    }
+    y += alpha * (x - y);
+    return y;
+  }
+
+  void reset() { primed = false; }
+
+private:
+  T alpha;
+  T y = T(0);
+  bool primed = false;
+};
+
+// Second-order IIR section (transposed direct form II).
+template <typename T>
+class Biquad {
+public:
+  Biquad() : b0(1), b1(0), b2(0), a1(0), a2(0) {}
+  Biquad(T b0, T b1, T b2, T a1, T a2) : b0(b0), b1(b1), b2(b2), a1(a1), a2(a2) {}
+
+  // Butterworth-style low-pass (RBJ cookbook coefficients)
+  static Biquad lowPass(double sampleRateHz, double cutoffHz, double q = 0.70710678) {
+    double w0 = 2 * M_PI * cutoffHz / sampleRateHz;
+    double cosw = cos(w0);
+    double alpha = sin(w0) / (2 * q);
+    double a0 = 1 + alpha;
+    return Biquad(T(((1 - cosw) / 2) / a0), T((1 - cosw) / a0), T(((1 - cosw) / 2) / a0),
+                  T((-2 * cosw) / a0), T((1 - alpha) / a0));
+  }
+
+  T process(T x) {
+    if (!primed) {
+      // Start from steady state at the first input so the output doesn't ramp from zero
+      T gain = (b0 + b1 + b2) / (T(1) + a1 + a2);
+      T y = gain * x;
+      z2 = b2 * x - a2 * y;
+      z1 = b1 * x - a1 * y + z2;
+      primed = true;
+    }
+    T y = b0 * x + z1;
+    z1 = b1 * x - a1 * y + z2;
+    z2 = b2 * x - a2 * y;
+    return y;
+  }
+
+  void reset() { primed = false; z1 = z2 = T(0); }
+
+private:
+  T b0, b1, b2, a1, a2;
+  T z1 = T(0), z2 = T(0);
+  bool primed = false;
+};
+
+// Detects a bend when the (optionally filtered) signal rises more than minDifference
+// above mean * thresholdMultiplier over the last N samples, and re-arms once it falls
+// back under the threshold. A refractory period suppresses double counts.
+template <typename T, size_t N, typename Filter = NoFilter<T>>
+class BendDetector {
+public:
+  BendDetector(T thresholdMultiplier, T minDifference, uint32_t refractoryMicros = 0,
+               Filter filter = Filter())
+    : prefilter(filter), multiplier(thresholdMultiplier), minDiff(minDifference),
+      refractory(refractoryMicros) {}
+
+  // Feeds one sample; returns true if it completes a new bend.
+  bool update(T x, uint32_t nowMicros) {
+    x = prefilter.process(x);
+    window.push(x);
+    dynamicThreshold = window.mean() * multiplier;
+
+    if (!above && x > dynamicThreshold + minDiff) {
+      above = true;
+      if (bends > 0 && (uint32_t)(nowMicros - lastBendMicros) < refractory) {
+        return false; // Too soon after the last bend, treat as the same movement
+      }
+      lastBendMicros = nowMicros;
+      bends++;
+      return true;
+    } else if (above && x < dynamicThreshold) {
+      above = false;
+    }
+    return false;
+  }
+
+  void setThresholdMultiplier(T m) { multiplier = m; }
+  void setMinDifference(T d) { minDiff = d; }
+  void setRefractoryMicros(uint32_t us) { refractory = us; }
+
+  T threshold() const { return dynamicThreshold; }
+  bool aboveThreshold() const { return above; }
+  uint32_t count() const { return bends; }
+  Filter& filter() { return prefilter; }
+
+  void reset() {
+    prefilter.reset();
+    window.reset();
+    above = false;
+    dynamicThreshold = T(0);
+    bends = 0;
+    lastBendMicros = 0;
+  }
+
+private:
+  Filter prefilter;
+  RunningWindow<T, N> window;
+  T multiplier;
+  T minDiff;
+  uint32_t refractory;
+  T dynamicThreshold = T(0);
+  bool above = false;
+  uint32_t bends = 0;
+  uint32_t lastBendMicros = 0;
+};
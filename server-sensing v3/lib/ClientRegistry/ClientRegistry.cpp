@@ -0,0 +1,156 @@
+#include "ClientRegistry.h"
+
+#define DEFAULT_MTU 23 // Until the client negotiates a bigger one
+
+bool ClientRegistry::apply(const ClientEvent& event, uint32_t nowMs) {
+  ClientSlot* client = find(event.connId);
+  if (event.type == CLIENT_CONNECTED) {
+    if (client == nullptr) {
+      for (uint8_t i = 0; i < MAX_CLIENTS && client == nullptr; i++) {
+        if (!slots[i].active) {
+          client = &slots[i];
+        }
+      }
+      if (client == nullptr) {
+        return false;
+      }
+    }
+    *client = ClientSlot();
+    client->active = true;
+    client->connId = event.connId;
+    client->mtu = DEFAULT_MTU;
+    client->connectedMs = nowMs;
+    client->inactivityMs = defaultInactivityMs;
+    client->stillSinceMs = nowMs;
+    return true;
+  }
+
+  if (client == nullptr) {
+    return false;
+  }
+  switch (event.type) {
+    case CLIENT_DISCONNECTED:
+      client->active = false;
+      break;
+    case CLIENT_MTU:
+      client->mtu = event.value;
+      break;
+    case CLIENT_SUBSCRIBED:
+      client->topics |= event.value;
+      break;
+    case CLIENT_UNSUBSCRIBED:
+      client->topics &= ~event.value;
+      break;
+    default:
+      break;
+  }
+  return true;
+}
+
+ClientSlot* ClientRegistry::find(uint16_t connId) {
+  for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+    if (slots[i].active && slots[i].connId == connId) {
+      return &slots[i];
+    }
+  }
+  return nullptr;
+}
+
+uint8_t ClientRegistry::count() const {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+    n += slots[i].active;
+  }
+  return n;
+}
+
+uint8_t ClientRegistry::mask(uint8_t topic) const {
+  uint8_t m = 0;
+  for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+    if (slots[i].active && (slots[i].topics & topic)) {
+      m |= 1 << i;
+    }
+  }
+  return m;
+}
+
+uint8_t ClientRegistry::dueMask(uint32_t nowMs) const {
+  uint8_t m = mask(TOPIC_STREAM);
+  for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+    const ClientSlot& s = slots[i];
+    if ((m & (1 << i)) && nowMs - s.lastStreamMs < s.streamIntervalMs) {
+      m &= ~(1 << i);
+    }
+  }
+  return m;
+}
+
+void ClientRegistry::markStreamed(uint8_t slotMask, uint32_t nowMs) {
+  for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+    ClientSlot& s = slots[i];
+    if (!(slotMask & (1 << i))) {
+      continue;
+    }
+    if (s.streamIntervalMs > 0 && nowMs - s.lastStreamMs < 2 * s.streamIntervalMs) {
+      s.lastStreamMs += s.streamIntervalMs;
+    } else {
+      s.lastStreamMs = nowMs; // First frame, or fell behind: restart from now
+    }
+  }
+}
+
+uint16_t ClientRegistry::minMtu(uint8_t slotMask) const {
+  uint16_t mtu = 0;
+  for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+    if ((slotMask & (1 << i)) && slots[i].active && (mtu == 0 || slots[i].mtu < mtu)) {
+      mtu = slots[i].mtu;
+    }
+  }
+  return mtu == 0 ? DEFAULT_MTU : mtu;
+}
+
+bool ClientRegistry::setStreamInterval(uint16_t connId, uint32_t ms) {
+  ClientSlot* client = find(connId);
+  if (client == nullptr) {
+    return false;
+  }
+  client->streamIntervalMs = ms;
+  return true;
+}
+
+bool ClientRegistry::setStreamRateLimits(uint16_t connId, uint8_t minHz, uint8_t maxHz) {
+  ClientSlot* client = find(connId);
+  if (client == nullptr) {
+    return false;
+  }
+  client->streamRateMinHz = minHz;
+  client->streamRateMaxHz = maxHz;
+  return true;
+}
+
+bool ClientRegistry::setInactivityTimeout(uint16_t connId, uint32_t ms) {
+  ClientSlot* client = find(connId);
+  if (client == nullptr) {
+    return false;
+  }
+  client->inactivityMs = ms;
+  return true;
+}
+
+void ClientRegistry::noteMovement(uint32_t nowMs) {
+  for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+    slots[i].stillSinceMs = nowMs;
+  }
+}
+
+uint8_t ClientRegistry::expired(uint32_t nowMs, uint16_t* connIds, uint8_t max) {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < MAX_CLIENTS && n < max; i++) {
+    ClientSlot& s = slots[i];
+    if (s.active && s.inactivityMs > 0 && nowMs - s.stillSinceMs > s.inactivityMs) {
+      connIds[n++] = s.connId;
+      s.stillSinceMs = nowMs;
+    }
+  }
+  return n;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdint.h>
+
+// Tracks every connected BLE client: what it subscribed to, its MTU, how often it
+// wants stream frames and its own inactivity timer. The BLE stack reports changes
+// as ClientEvents (from its own task, through a queue); loop() applies them and
+// owns the registry, so nothing here needs a lock. Sending lives with the caller,
+// which encodes a frame once and hands it to every client in a mask.
+
+#ifndef CLIENT_REGISTRY_MAX
+#define CLIENT_REGISTRY_MAX 4 // CONFIG_BT_ACL_CONNECTIONS on the ESP32 Arduino core
+#endif
+
+// Subscription bits, one per notifying characteristic
+enum ClientTopic : uint8_t {
+  TOPIC_EVENTS = 0x01, // Sample, status and rep frames on the main characteristic
+  TOPIC_STREAM = 0x02, // Angle stream
+};
+
+enum ClientEventType : uint8_t {
+  CLIENT_CONNECTED,
+  CLIENT_DISCONNECTED,
+  CLIENT_MTU,         // value = negotiated MTU
+  CLIENT_SUBSCRIBED,  // value = topic
+  CLIENT_UNSUBSCRIBED // value = topic
+};
+
+struct ClientEvent {
+  ClientEventType type;
+  uint16_t connId;
+  uint16_t value;
+};
+
+struct ClientSlot {
+  bool active;
+  uint16_t connId;
+  uint16_t mtu;
+  uint8_t topics;
+  uint32_t connectedMs;
+  uint32_t streamIntervalMs; // 0 sends every stream frame
+  uint32_t lastStreamMs;
+  uint8_t streamRateMinHz;   // This client's own limits from its CONFIG write,
+  uint8_t streamRateMaxHz;   // 0 follows the shared ones
+  uint32_t inactivityMs;     // 0 never times out
+  uint32_t stillSinceMs;
+  uint32_t framesSent;
+  uint32_t framesSkipped;    // Not sent because the client had no free buffers
+  uint32_t framesTooLong;    // Not sent because the frame was bigger than the client's MTU allows
+  uint32_t streamSends;      // Stream sends and skips since the caller last cleared them,
+  uint32_t streamSkips;      // this client's link quality for its rate
+};
+
+class ClientRegistry {
+public:
+  static const uint8_t MAX_CLIENTS = CLIENT_REGISTRY_MAX;
+
+  ClientRegistry(uint32_t inactivityMs = 60000) : defaultInactivityMs(inactivityMs) {}
+
+  // Returns false for an unknown client, or a new one with every slot taken
+  bool apply(const ClientEvent& event, uint32_t nowMs);
+
+  ClientSlot* find(uint16_t connId);
+  ClientSlot& slot(uint8_t index) { return slots[index]; }
+  const ClientSlot& slot(uint8_t index) const { return slots[index]; }
+  uint8_t count() const;
+
+  // Slot bitmask of the clients subscribed to topic
+  uint8_t mask(uint8_t topic) const;
+  // Stream subscribers whose interval has elapsed
+  uint8_t dueMask(uint32_t nowMs) const;
+  // Advances each client's schedule by its interval, so tick jitter doesn't make a
+  // client miss every other tick
+  void markStreamed(uint8_t slotMask, uint32_t nowMs);
+  // Smallest MTU in the mask, so one encoded frame fits every client in it
+  uint16_t minMtu(uint8_t slotMask) const;
+
+  bool setStreamInterval(uint16_t connId, uint32_t ms);
+  bool setStreamRateLimits(uint16_t connId, uint8_t minHz, uint8_t maxHz);
+  bool setInactivityTimeout(uint16_t connId, uint32_t ms);
+  // Timeout for clients that connect from now on; connected ones keep their own
+  void setDefaultInactivityTimeout(uint32_t ms) { defaultInactivityMs = ms; }
+
+  // Restarts every client's inactivity timer
+  void noteMovement(uint32_t nowMs);
+  // Fills connIds with clients whose timer ran out and restarts theirs, so each
+  // is reported once. Returns how many.
+  uint8_t expired(uint32_t nowMs, uint16_t* connIds, uint8_t max);
+
+private:
+  ClientSlot slots[MAX_CLIENTS] = {};
+  uint32_t defaultInactivityMs;
+};
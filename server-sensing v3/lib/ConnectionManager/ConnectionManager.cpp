@@ -0,0 +1,98 @@
+#include "ConnectionManager.h"
+
+const char* ConnectionManager::stateName(ConnState s) {
+  switch (s) {
+    case CONN_IDLE: return "idle";
+    case CONN_WIFI_CONNECTING: return "wifi-connecting";
+    case CONN_TIME_SYNCING: return "time-syncing";
+    case CONN_CLOUD_STARTING: return "cloud-starting";
+    case CONN_ONLINE: return "online";
+    case CONN_BACKOFF: return "backoff";
+  }
+  return "?";
+}
+
+void ConnectionManager::enter(ConnState next, uint32_t nowMs) {
+  ConnState previous = current;
+  current = next;
+  enteredMs = nowMs;
+  if (listener != nullptr && previous != next) {
+    listener(previous, next);
+  }
+}
+
+void ConnectionManager::fail(uint32_t nowMs) {
+  failures++;
+  consecutiveFailures++;
+  // 1x, 2x, 4x ... the minimum, capped
+  uint32_t shift = consecutiveFailures - 1;
+  backoffMs = shift >= 16 ? config.backoffMaxMs : config.backoffMinMs << shift;
+  if (backoffMs > config.backoffMaxMs) {
+    backoffMs = config.backoffMaxMs;
+  }
+  driver.stopWiFi();
+  enter(CONN_BACKOFF, nowMs);
+}
+
+void ConnectionManager::tick(uint32_t nowMs) {
+  uint32_t elapsed = nowMs - enteredMs;
+
+  // The clock can land in any state once SNTP has been started
+  if (!clockSet && current != CONN_IDLE && driver.timeSynced()) {
+    clockSet = true;
+  }
+
+  switch (current) {
+    case CONN_IDLE:
+      driver.startWiFi();
+      enter(CONN_WIFI_CONNECTING, nowMs);
+      break;
+
+    case CONN_WIFI_CONNECTING:
+      if (driver.wifiConnected()) {
+        if (clockSet) {
+          enter(CONN_CLOUD_STARTING, nowMs);
+        } else {
+          driver.startTimeSync();
+          enter(CONN_TIME_SYNCING, nowMs);
+        }
+      } else if (elapsed > config.wifiTimeoutMs) {
+        fail(nowMs);
+      }
+      break;
+
+    case CONN_TIME_SYNCING:
+      if (!driver.wifiConnected()) {
+        fail(nowMs);
+      } else if (clockSet || elapsed > config.timeSyncTimeoutMs) {
+        enter(CONN_CLOUD_STARTING, nowMs);
+      }
+      break;
+
+    case CONN_CLOUD_STARTING:
+      if (!driver.wifiConnected()) {
+        fail(nowMs);
+      } else if (cloudStarted || driver.startCloud()) {
+        // The cloud client reconnects by itself after the first start
+        cloudStarted = true;
+        consecutiveFailures = 0;
+        backoffMs = 0;
+        enter(CONN_ONLINE, nowMs);
+      } else {
+        fail(nowMs);
+      }
+      break;
+
+    case CONN_ONLINE:
+      if (!driver.wifiConnected()) {
+        fail(nowMs);
+      }
+      break;
+
+    case CONN_BACKOFF:
+      if (elapsed >= backoffMs) {
+        enter(CONN_IDLE, nowMs);
+      }
+      break;
+  }
+}
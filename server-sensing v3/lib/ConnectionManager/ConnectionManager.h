@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+
+// The hardware side of bring-up. Every call must return quickly except
+// startCloud(), which may block for one sign-up request (it runs in the cloud task).
+class ConnectivityDriver {
+public:
+  virtual ~ConnectivityDriver() {}
+
+  virtual void startWiFi() = 0;
+  virtual void stopWiFi() = 0;
+  virtual bool wifiConnected() = 0;
+  virtual void startTimeSync() = 0;
+  virtual bool timeSynced() = 0;
+  // Sign up and start the cloud client; returns false to retry later
+  virtual bool startCloud() = 0;
+};
+
+enum ConnState : uint8_t {
+  CONN_IDLE,
+  CONN_WIFI_CONNECTING,
+  CONN_TIME_SYNCING,
+  CONN_CLOUD_STARTING,
+  CONN_ONLINE,
+  CONN_BACKOFF,
+};
+
+// Brings up WiFi, then NTP, then the cloud client, one non-blocking step per
+// tick(). Any failure waits out an exponential backoff and starts over from WiFi;
+// nothing ever restarts the chip. A slow NTP sync doesn't hold up the cloud: the
+// clock keeps syncing in the background and timeValid() flips when it lands.
+class ConnectionManager {
+public:
+  struct Config {
+    uint32_t wifiTimeoutMs = 10000;
+    uint32_t timeSyncTimeoutMs = 5000;
+    uint32_t backoffMinMs = 1000;
+    uint32_t backoffMaxMs = 60000;
+  };
+
+  typedef void (*Listener)(ConnState from, ConnState to);
+
+  ConnectionManager(ConnectivityDriver& driver) : driver(driver) {}
+  ConnectionManager(ConnectivityDriver& driver, const Config& config) : driver(driver), config(config) {}
+
+  void setListener(Listener fn) { listener = fn; }
+  void tick(uint32_t nowMs);
+
+  ConnState state() const { return current; }
+  bool online() const { return current == CONN_ONLINE; }
+  bool timeValid() const { return clockSet; }
+  uint32_t failureCount() const { return failures; }
+  uint32_t currentBackoffMs() const { return backoffMs; }
+
+  static const char* stateName(ConnState s);
+
+private:
+  void enter(ConnState next, uint32_t nowMs);
+  void fail(uint32_t nowMs);
+
+  ConnectivityDriver& driver;
+  Config config;
+  Listener listener = nullptr;
+
+  ConnState current = CONN_IDLE;
+  uint32_t enteredMs = 0;
+  uint32_t backoffMs = 0;
+  uint32_t consecutiveFailures = 0;
+  uint32_t failures = 0;
+  bool clockSet = false;
+  bool cloudStarted = false;
+};
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Lean MPU6050 driver for the sampling hot path. Accel and gyro come in as raw
+// int16 counts, either in one 14-byte burst (the two temperature bytes sit between
+// them and are skipped) or straight from the on-chip FIFO at 12 bytes a sample,
+// many samples per transaction. Scaling to SI units is left to the caller, so
+// nothing is converted that isn't used.
+//
+// The bus is a template parameter with three calls:
+//   bool writeRegister(uint8_t address, uint8_t reg, uint8_t value);
+//   bool readRegisters(uint8_t address, uint8_t reg, uint8_t* out, size_t length);
+//   void delayMs(uint32_t ms);
+// WireBus below is the ESP32 one; Mpu6050Sim is a register-map model for the host.
+
+#define MPU6050_ADDRESS 0x68
+#define MPU6050_WHO_AM_I_VALUE 0x68
+#define MPU6050_FIFO_BYTES 1024
+#define MPU6050_FRAME_BYTES 12 // Accel then gyro, big-endian int16 each, as the FIFO stores them
+#define MPU6050_BURST_BYTES 14 // Accel, temperature, gyro
+
+#define MPU6050_REG_SMPLRT_DIV 0x19
+#define MPU6050_REG_CONFIG 0x1A
+#define MPU6050_REG_GYRO_CONFIG 0x1B
+#define MPU6050_REG_ACCEL_CONFIG 0x1C
+#define MPU6050_REG_FIFO_EN 0x23
+#define MPU6050_REG_INT_STATUS 0x3A
+#define MPU6050_REG_ACCEL_XOUT_H 0x3B
+#define MPU6050_REG_TEMP_OUT_H 0x41
+#define MPU6050_REG_GYRO_XOUT_H 0x43
+#define MPU6050_REG_USER_CTRL 0x6A
+#define MPU6050_REG_PWR_MGMT_1 0x6B
+#define MPU6050_REG_FIFO_COUNT_H 0x72
+#define MPU6050_REG_FIFO_R_W 0x74
+#define MPU6050_REG_WHO_AM_I 0x75
+
+#define MPU6050_FIFO_EN_ACCEL 0x08
+#define MPU6050_FIFO_EN_GYRO 0x70 // X, Y and Z
+#define MPU6050_FIFO_EN_TEMP 0x80
+#define MPU6050_USER_CTRL_FIFO_EN 0x40
+#define MPU6050_USER_CTRL_FIFO_RESET 0x04
+#define MPU6050_PWR_RESET 0x80
+#define MPU6050_PWR_SLEEP 0x40
+#define MPU6050_PWR_CLOCK_PLL_X 0x01
+#define MPU6050_INT_FIFO_OFLOW 0x10
+
+// Raw counts straight off the chip
+struct Mpu6050Raw {
+  int16_t ax, ay, az;
+  int16_t gx, gy, gz;
+};
+
+template <typename Bus>
+class Mpu6050Driver {
+public:
+  // Frames per FIFO transaction: 120 bytes, inside the 128-byte Wire buffer
+  static const size_t FIFO_CHUNK_FRAMES = 10;
+
+  struct Config {
+    uint8_t accelRange = 2;       // 0-3 for +-2/4/8/16 g
+    uint8_t gyroRange = 1;        // 0-3 for +-250/500/1000/2000 deg/s
+    uint8_t dlpf = 2;             // Digital low-pass setting, 2 = 94 Hz
+    uint16_t sampleRateHz = 200;  // Must divide the 1 kHz (or 8 kHz with dlpf 0) gyro rate
+  };
+
+  Mpu6050Driver(Bus& bus, uint8_t address = MPU6050_ADDRESS) : bus(bus), address(address) {}
+
+  // Resets the chip and sets it up; false if it doesn't answer as an MPU6050
+  bool begin(const Config& config) {
+    if (!bus.writeRegister(address, MPU6050_REG_PWR_MGMT_1, MPU6050_PWR_RESET)) {
+      return false;
+    }
+    bus.delayMs(100);
+    uint8_t id = 0;
+    if (!bus.readRegisters(address, MPU6050_REG_WHO_AM_I, &id, 1) || id != MPU6050_WHO_AM_I_VALUE) {
+      return false;
+    }
+
+    uint32_t gyroRateHz = (config.dlpf == 0 || config.dlpf == 7) ? 8000 : 1000;
+    uint32_t divider = config.sampleRateHz == 0 ? 1 : gyroRateHz / config.sampleRateHz;
+    if (divider < 1) divider = 1;
+    if (divider > 256) divider = 256;
+    rateHz = gyroRateHz / divider;
+
+    // Gyro-referenced PLL clock, which also wakes the chip from sleep
+    bool ok = bus.writeRegister(address, MPU6050_REG_PWR_MGMT_1, MPU6050_PWR_CLOCK_PLL_X) &&
+              bus.writeRegister(address, MPU6050_REG_SMPLRT_DIV, (uint8_t)(divider - 1)) &&
+              bus.writeRegister(address, MPU6050_REG_CONFIG, config.dlpf & 0x07) &&
+              bus.writeRegister(address, MPU6050_REG_GYRO_CONFIG, (config.gyroRange & 0x03) << 3) &&
+              bus.writeRegister(address, MPU6050_REG_ACCEL_CONFIG, (config.accelRange & 0x03) << 3);
+    accelScale = 9.80665f / (float)(16384 >> (config.accelRange & 0x03));
+    gyroScale = (250.0f * (1 << (config.gyroRange & 0x03)) / 32768.0f) * 0.0174532925f;
+    fifoOn = false;
+    return ok;
+  }
+
+  // Latest accel and gyro in one transaction
+  bool readBurst(Mpu6050Raw& out) {
+    uint8_t buf[MPU6050_BURST_BYTES];
+    if (!bus.readRegisters(address, MPU6050_REG_ACCEL_XOUT_H, buf, sizeof(buf))) {
+      return false;
+    }
+    decode(buf, out.ax, out.ay, out.az);
+    decode(buf + 8, out.gx, out.gy, out.gz);
+    return true;
+  }
+
+  // Accel and gyro (no temperature) go into the FIFO at the sample rate
+  bool startFifo() {
+    fifoOn = bus.writeRegister(address, MPU6050_REG_FIFO_EN, MPU6050_FIFO_EN_ACCEL | MPU6050_FIFO_EN_GYRO) &&
+             resetFifo();
+    return fifoOn;
+  }
+
+  // Empties the FIFO, e.g. after a pause in reading it
+  bool resetFifo() {
+    return bus.writeRegister(address, MPU6050_REG_USER_CTRL, MPU6050_USER_CTRL_FIFO_RESET) &&
+           bus.writeRegister(address, MPU6050_REG_USER_CTRL, MPU6050_USER_CTRL_FIFO_EN);
+  }
+
+  // Bytes waiting in the FIFO, or -1 on a bus error
+  int fifoCount() {
+    uint8_t buf[2];
+    if (!bus.readRegisters(address, MPU6050_REG_FIFO_COUNT_H, buf, sizeof(buf))) {
+      return -1;
+    }
+    return (buf[0] << 8) | buf[1];
+  }
+
+  // Reads up to max whole samples from the FIFO, oldest first. A full FIFO has
+  // overwritten its oldest bytes and lost frame alignment, so it is reset and
+  // counted instead.
+  size_t readFifo(Mpu6050Raw* out, size_t max) {
+    int count = fifoCount();
+    if (count < 0) {
+      return 0;
+    }
+    if (count > MPU6050_FIFO_BYTES - MPU6050_FRAME_BYTES) {
+      overflows++;
+      resetFifo();
+      return 0;
+    }
+
+    size_t frames = count / MPU6050_FRAME_BYTES;
+    if (frames > max) {
+      frames = max;
+    }
+    uint8_t buf[FIFO_CHUNK_FRAMES * MPU6050_FRAME_BYTES];
+    size_t done = 0;
+    while (done < frames) {
+      size_t chunk = frames - done < FIFO_CHUNK_FRAMES ? frames - done : FIFO_CHUNK_FRAMES;
+      if (!bus.readRegisters(address, MPU6050_REG_FIFO_R_W, buf, chunk * MPU6050_FRAME_BYTES)) {
+        break;
+      }
+      for (size_t i = 0; i < chunk; i++) {
+        const uint8_t* frame = buf + i * MPU6050_FRAME_BYTES;
+        Mpu6050Raw& raw = out[done + i];
+        decode(frame, raw.ax, raw.ay, raw.az);
+        decode(frame + 6, raw.gx, raw.gy, raw.gz);
+      }
+      done += chunk;
+    }
+    return done;
+  }
+
+  bool fifoEnabled() const { return fifoOn; }
+  uint32_t fifoOverflows() const { return overflows; }
+  // Actual sample rate after rounding to a whole divider
+  uint16_t sampleRateHz() const { return rateHz; }
+
+  // Count to SI conversion for the configured ranges
+  float accelMs2(int16_t counts) const { return counts * accelScale; }
+  float gyroRads(int16_t counts) const { return counts * gyroScale; }
+
+private:
+  static void decode(const uint8_t* p, int16_t& x, int16_t& y, int16_t& z) {
+    x = (int16_t)((p[0] << 8) | p[1]);
+    y = (int16_t)((p[2] << 8) | p[3]);
+    z = (int16_t)((p[4] << 8) | p[5]);
+  }
+
+  Bus& bus;
+  uint8_t address;
+  float accelScale = 0;
+  float gyroScale = 0;
+  uint16_t rateHz = 0;
+  bool fifoOn = false;
+  uint32_t overflows = 0;
+};
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#include <Wire.h>
+
+// Register access over an Arduino TwoWire port; set the clock with Wire.setClock()
+class WireBus {
+public:
+  WireBus(TwoWire& wire) : wire(wire) {}
+
+  bool writeRegister(uint8_t address, uint8_t reg, uint8_t value) {
+    wire.beginTransmission(address);
+    wire.write(reg);
+    wire.write(value);
+    return wire.endTransmission() == 0;
+  }
+
+  bool readRegisters(uint8_t address, uint8_t reg, uint8_t* out, size_t length) {
+    wire.beginTransmission(address);
+    wire.write(reg);
+    if (wire.endTransmission(false) != 0) { // Repeated start, the bus stays ours
+      return false;
+    }
+    if (wire.requestFrom(address, (uint8_t)length) != length) {
+      return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+      out[i] = wire.read();
+    }
+    return true;
+  }
+
+  void delayMs(uint32_t ms) { delay(ms); }
+
+private:
+  TwoWire& wire;
+};
+#endif
@@ -0,0 +1,156 @@
+#include "Mpu6050Sim.h"
+
+#include <math.h>
+#include <string.h>
+
+void Mpu6050Sim::reset() {
+  memset(regs, 0, sizeof(regs));
+  regs[MPU6050_REG_PWR_MGMT_1] = MPU6050_PWR_SLEEP;
+  regs[MPU6050_REG_WHO_AM_I] = MPU6050_WHO_AM_I_VALUE;
+  fifoHead = 0;
+  fifoLength = 0;
+}
+
+bool Mpu6050Sim::writeRegister(uint8_t address, uint8_t reg, uint8_t value) {
+  if (address != MPU6050_ADDRESS || reg >= sizeof(regs)) {
+    return false;
+  }
+  transactionCount++;
+  byteCount += 3; // Address, register, value
+
+  switch (reg) {
+    case MPU6050_REG_PWR_MGMT_1:
+      if (value & MPU6050_PWR_RESET) {
+        reset();
+        return true;
+      }
+      break;
+    case MPU6050_REG_USER_CTRL:
+      if (value & MPU6050_USER_CTRL_FIFO_RESET) {
+        fifoHead = 0;
+        fifoLength = 0;
+        value &= ~MPU6050_USER_CTRL_FIFO_RESET; // Self-clearing
+      }
+      break;
+    case MPU6050_REG_WHO_AM_I:
+    case MPU6050_REG_INT_STATUS:
+    case MPU6050_REG_FIFO_COUNT_H:
+    case MPU6050_REG_FIFO_COUNT_H + 1:
+      return true; // Read-only
+    case MPU6050_REG_FIFO_R_W:
+      pushFifo(value);
+      return true;
+    default:
+      break;
+  }
+  regs[reg] = value;
+  return true;
+}
+
+bool Mpu6050Sim::readRegisters(uint8_t address, uint8_t reg, uint8_t* out, size_t length) {
+  if (address != MPU6050_ADDRESS || length == 0) {
+    return false;
+  }
+  transactionCount++;
+  byteCount += 3 + length; // Address + register, repeated-start address, data
+
+  // The FIFO port doesn't auto-increment, every byte pops the FIFO
+  for (size_t i = 0; i < length; i++) {
+    uint8_t r = reg == MPU6050_REG_FIFO_R_W ? reg : (uint8_t)((reg + i) & 0x7F);
+    out[i] = readRegister(r);
+  }
+  return true;
+}
+
+uint8_t Mpu6050Sim::readRegister(uint8_t r) {
+  switch (r) {
+    case MPU6050_REG_FIFO_COUNT_H:
+      return (uint8_t)(fifoLength >> 8);
+    case MPU6050_REG_FIFO_COUNT_H + 1:
+      return (uint8_t)fifoLength;
+    case MPU6050_REG_FIFO_R_W: {
+      if (fifoLength == 0) {
+        return 0xFF;
+      }
+      uint8_t b = fifo[fifoHead];
+      fifoHead = (fifoHead + 1) % MPU6050_FIFO_BYTES;
+      fifoLength--;
+      return b;
+    }
+    case MPU6050_REG_INT_STATUS: {
+      uint8_t status = regs[r];
+      regs[r] = 0; // Cleared on read
+      return status;
+    }
+    default:
+      return regs[r];
+  }
+}
+
+void Mpu6050Sim::pushFifo(uint8_t b) {
+  if (fifoLength == MPU6050_FIFO_BYTES) {
+    // Full: the chip overwrites the oldest byte and flags the overflow
+    fifoHead = (fifoHead + 1) % MPU6050_FIFO_BYTES;
+    fifoLength--;
+    regs[MPU6050_REG_INT_STATUS] |= MPU6050_INT_FIFO_OFLOW;
+  }
+  fifo[(fifoHead + fifoLength) % MPU6050_FIFO_BYTES] = b;
+  fifoLength++;
+}
+
+static int16_t toCounts(float value, float countsPerUnit) {
+  float c = roundf(value * countsPerUnit);
+  if (c > 32767.0f) return 32767;
+  if (c < -32768.0f) return -32768;
+  return (int16_t)c;
+}
+
+static void putBigEndian(uint8_t* p, int16_t v) {
+  p[0] = (uint8_t)((uint16_t)v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+void Mpu6050Sim::sample(float ax, float ay, float az, float gx, float gy, float gz) {
+  if (regs[MPU6050_REG_PWR_MGMT_1] & MPU6050_PWR_SLEEP) {
+    return;
+  }
+  uint8_t accelRange = (regs[MPU6050_REG_ACCEL_CONFIG] >> 3) & 0x03;
+  uint8_t gyroRange = (regs[MPU6050_REG_GYRO_CONFIG] >> 3) & 0x03;
+  float accelCounts = (16384 >> accelRange) / 9.80665f;
+  float gyroCounts = 32768.0f / (250.0f * (1 << gyroRange)) * 57.2957795f;
+
+  uint8_t* data = regs + MPU6050_REG_ACCEL_XOUT_H;
+  putBigEndian(data + 0, toCounts(ax, accelCounts));
+  putBigEndian(data + 2, toCounts(ay, accelCounts));
+  putBigEndian(data + 4, toCounts(az, accelCounts));
+  putBigEndian(data + 6, 0); // Temperature, 36.53 C
+  putBigEndian(data + 8, toCounts(gx, gyroCounts));
+  putBigEndian(data + 10, toCounts(gy, gyroCounts));
+  putBigEndian(data + 12, toCounts(gz, gyroCounts));
+  regs[MPU6050_REG_INT_STATUS] |= 0x01; // DATA_RDY
+
+  if (!(regs[MPU6050_REG_USER_CTRL] & MPU6050_USER_CTRL_FIFO_EN)) {
+    return;
+  }
+  // FIFO order: accel, temperature, then gyro X, Y, Z, each only if enabled
+  uint8_t enabled = regs[MPU6050_REG_FIFO_EN];
+  if (enabled & MPU6050_FIFO_EN_ACCEL) {
+    for (int i = 0; i < 6; i++) pushFifo(data[i]);
+  }
+  if (enabled & MPU6050_FIFO_EN_TEMP) {
+    for (int i = 6; i < 8; i++) pushFifo(data[i]);
+  }
+  for (int axis = 0; axis < 3; axis++) {
+    if (enabled & (0x40 >> axis)) {
+      pushFifo(data[8 + 2 * axis]);
+      pushFifo(data[9 + 2 * axis]);
+    }
+  }
+}
+
+double Mpu6050Sim::busMicros(uint32_t clockHz) const {
+  // Reads are two transfers (write register, repeated start, read); count one
+  // start and one stop bit per transaction, a close enough upper bound
+  double bits = byteCount * 9.0 + transactionCount * 2.0;
+  return bits * 1e6 / clockHz;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Mpu6050Driver.h"
+
+// Register-map model of an MPU6050 for host builds: reset, sleep, full-scale
+// ranges, auto-incrementing reads, the data registers and the 1 KB FIFO with its
+// overflow behaviour. It implements the bus interface Mpu6050Driver expects and
+// counts the bytes a real I2C bus would carry, to estimate bus time per sample.
+class Mpu6050Sim {
+public:
+  Mpu6050Sim() { reset(); }
+
+  // Bus interface
+  bool writeRegister(uint8_t address, uint8_t reg, uint8_t value);
+  bool readRegisters(uint8_t address, uint8_t reg, uint8_t* out, size_t length);
+  void delayMs(uint32_t) {}
+
+  // Latches one sample (m/s^2 and rad/s) into the data registers, scaled to the
+  // configured ranges, and appends it to the FIFO if enabled. Does nothing while
+  // the chip sleeps.
+  void sample(float ax, float ay, float az, float gx, float gy, float gz);
+
+  uint8_t reg(uint8_t r) const { return regs[r]; }
+  size_t fifoSize() const { return fifoLength; }
+  uint32_t transactions() const { return transactionCount; }
+  uint32_t busBytes() const { return byteCount; }
+  // Time the counted traffic takes at clockHz: 9 bits per byte plus start/stop
+  double busMicros(uint32_t clockHz) const;
+  void resetCounters() { transactionCount = 0; byteCount = 0; }
+
+private:
+  void reset();
+  void pushFifo(uint8_t b);
+  uint8_t readRegister(uint8_t r);
+
+  uint8_t regs[128];
+  uint8_t fifo[MPU6050_FIFO_BYTES];
+  size_t fifoHead = 0; // Oldest byte
+  size_t fifoLength = 0;
+  uint32_t transactionCount = 0;
+  uint32_t byteCount = 0;
+};
@@ -0,0 +1,196 @@
+#include "OrientationFilter.h"
+
+template <typename Math>
+static float accelPitch(float ax, float ay, float az) {
+  return Math::atan2Deg(ay, Math::sqrt(ax * ax + az * az));
+}
+
+template <typename Math>
+static float accelRoll(float ax, float ay, float az) {
+  return Math::atan2Deg(-ax, Math::sqrt(ay * ay + az * az));
+}
+
+// Seeds the quaternion with the shortest rotation that maps the measured gravity
+// direction onto the vertical, so the filters don't start by converging from level
+template <typename Math>
+static void quaternionFromTilt(float ax, float ay, float az, float& q0, float& q1, float& q2, float& q3) {
+  float normSq = ax * ax + ay * ay + az * az;
+  if (normSq == 0.0f) {
+    q0 = 1; q1 = q2 = q3 = 0;
+    return;
+  }
+  float recipNorm = Math::rsqrt(normSq);
+  ax *= recipNorm;
+  ay *= recipNorm;
+  az *= recipNorm;
+  if (az < -0.9999f) {
+    // Upside down: any half turn about a horizontal axis will do
+    q0 = 0; q1 = 1; q2 = q3 = 0;
+    return;
+  }
+  recipNorm = Math::rsqrt((1.0f + az) * (1.0f + az) + ay * ay + ax * ax);
+  q0 = (1.0f + az) * recipNorm;
+  q1 = ay * recipNorm;
+  q2 = -ax * recipNorm;
+  q3 = 0;
+}
+
+// Reads pitch/roll off the body-frame gravity direction the quaternion implies
+template <typename Math>
+static void anglesFromQuaternion(float q0, float q1, float q2, float q3, Orientation& out) {
+  float vx = 2.0f * (q1 * q3 - q0 * q2);
+  float vy = 2.0f * (q0 * q1 + q2 * q3);
+  float vz = q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3;
+  out.pitch = accelPitch<Math>(vx, vy, vz);
+  out.roll = accelRoll<Math>(vx, vy, vz);
+}
+
+template <typename Math>
+void ComplementaryFilterT<Math>::update(float ax, float ay, float az, float gx, float gy, float gz, float dt) {
+  (void)gz; // Yaw isn't observable from accel and isn't reported
+  float pitchAcc = accelPitch<Math>(ax, ay, az);
+  float rollAcc = accelRoll<Math>(ax, ay, az);
+  out.pitchRate = gx * SENSING_RAD_TO_DEG;
+
+  if (!initialized || dt <= 0) {
+    out.pitch = pitchAcc;
+    out.roll = rollAcc;
+    initialized = true;
+    return;
+  }
+
+  float alpha = tau / (tau + dt);
+  out.pitch = alpha * (out.pitch + out.pitchRate * dt) + (1.0f - alpha) * pitchAcc;
+  out.roll = alpha * (out.roll + gy * SENSING_RAD_TO_DEG * dt) + (1.0f - alpha) * rollAcc;
+}
+
+template <typename Math>
+void MadgwickFilterT<Math>::update(float ax, float ay, float az, float gx, float gy, float gz, float dt) {
+  out.pitchRate = gx * SENSING_RAD_TO_DEG;
+
+  if (!initialized) {
+    quaternionFromTilt<Math>(ax, ay, az, q0, q1, q2, q3);
+    initialized = true;
+    anglesFromQuaternion<Math>(q0, q1, q2, q3, out);
+    return;
+  }
+
+  // Rate of change of quaternion from gyroscope
+  float qDot1 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+  float qDot2 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+  float qDot3 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+  float qDot4 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+  // Accel feedback only when the measurement is valid (avoids NaN on a zero vector)
+  if (!(ax == 0.0f && ay == 0.0f && az == 0.0f)) {
+    float recipNorm = Math::rsqrt(ax * ax + ay * ay + az * az);
+    ax *= recipNorm;
+    ay *= recipNorm;
+    az *= recipNorm;
+
+    float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+    float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+    float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+    float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+    // Gradient descent corrective step
+    float s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+    float s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+    float s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+    float s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+    float sNorm = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+    if (sNorm > 0.0f) {
+      recipNorm = Math::rsqrt(sNorm);
+      qDot1 -= beta * s0 * recipNorm;
+      qDot2 -= beta * s1 * recipNorm;
+      qDot3 -= beta * s2 * recipNorm;
+      qDot4 -= beta * s3 * recipNorm;
+    }
+  }
+
+  q0 += qDot1 * dt;
+  q1 += qDot2 * dt;
+  q2 += qDot3 * dt;
+  q3 += qDot4 * dt;
+
+  float recipNorm = Math::rsqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+  q0 *= recipNorm;
+  q1 *= recipNorm;
+  q2 *= recipNorm;
+  q3 *= recipNorm;
+
+  anglesFromQuaternion<Math>(q0, q1, q2, q3, out);
+}
+
+template <typename Math>
+void MahonyFilterT<Math>::update(float ax, float ay, float az, float gx, float gy, float gz, float dt) {
+  out.pitchRate = gx * SENSING_RAD_TO_DEG;
+
+  if (!initialized) {
+    quaternionFromTilt<Math>(ax, ay, az, q0, q1, q2, q3);
+    biasX = biasY = biasZ = 0;
+    initialized = true;
+    anglesFromQuaternion<Math>(q0, q1, q2, q3, out);
+    return;
+  }
+
+  if (!(ax == 0.0f && ay == 0.0f && az == 0.0f)) {
+    float recipNorm = Math::rsqrt(ax * ax + ay * ay + az * az);
+    ax *= recipNorm;
+    ay *= recipNorm;
+    az *= recipNorm;
+
+    // Estimated direction of gravity
+    float vx = 2.0f * (q1 * q3 - q0 * q2);
+    float vy = 2.0f * (q0 * q1 + q2 * q3);
+    float vz = q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3;
+
+    // Error is the cross product between measured and estimated gravity
+    float ex = ay * vz - az * vy;
+    float ey = az * vx - ax * vz;
+    float ez = ax * vy - ay * vx;
+
+    if (ki > 0.0f) {
+      biasX += ki * ex * dt;
+      biasY += ki * ey * dt;
+      biasZ += ki * ez * dt;
+      gx += biasX;
+      gy += biasY;
+      gz += biasZ;
+    }
+
+    gx += kp * ex;
+    gy += kp * ey;
+    gz += kp * ez;
+  }
+
+  gx *= 0.5f * dt;
+  gy *= 0.5f * dt;
+  gz *= 0.5f * dt;
+  float qa = q0, qb = q1, qc = q2;
+  q0 += -qb * gx - qc * gy - q3 * gz;
+  q1 += qa * gx + qc * gz - q3 * gy;
+  q2 += qa * gy - qb * gz + q3 * gx;
+  q3 += qa * gz + qb * gy - qc * gx;
+
+  float recipNorm = Math::rsqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+  q0 *= recipNorm;
+  q1 *= recipNorm;
+  q2 *= recipNorm;
+  q3 *= recipNorm;
+
+  anglesFromQuaternion<Math>(q0, q1, q2, q3, out);
+}
+
+template class ComplementaryFilterT<FloatMath>;
+template class ComplementaryFilterT<PolyMath>;
+template class ComplementaryFilterT<LutMath>;
+template class ComplementaryFilterT<Q15Math>;
+template class MadgwickFilterT<FloatMath>;
+template class MadgwickFilterT<PolyMath>;
+template class MadgwickFilterT<LutMath>;
+template class MadgwickFilterT<Q15Math>;
+template class MahonyFilterT<FloatMath>;
+template class MahonyFilterT<PolyMath>;
+template class MahonyFilterT<LutMath>;
+template class MahonyFilterT<Q15Math>;
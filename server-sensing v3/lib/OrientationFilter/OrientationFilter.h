@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <SensingMath.h>
+
+// Gyro + accel orientation estimators. All three take accel in any consistent unit
+// (only the direction is used), gyro in rad/s and dt in seconds, and report angles
+// with the same convention the accel-only code used:
+//   pitch = atan2(ay, sqrt(ax^2 + az^2))   (rotation about the X axis)
+//   roll  = atan2(-ax, sqrt(ay^2 + az^2))  (rotation about the Y axis)
+// The atan2/rsqrt they use come from the Math policy (see SensingMath.h). The
+// .cpp instantiates FloatMath, PolyMath, LutMath and Q15Math; a new policy needs
+// its own line there.
+
+struct Orientation {
+  float pitch = 0;      // degrees
+  float roll = 0;       // degrees
+  float pitchRate = 0;  // degrees/s about the pitch (joint) axis
+};
+
+// Blends integrated gyro with accel tilt. timeConstant is the crossover in seconds:
+// below it the gyro dominates, above it the accel pulls out the drift.
+template <typename Math = FloatMath>
+class ComplementaryFilterT {
+public:
+  ComplementaryFilterT(float timeConstant = 0.5f) : tau(timeConstant) {}
+
+  void update(float ax, float ay, float az, float gx, float gy, float gz, float dt);
+  const Orientation& orientation() const { return out; }
+  void reset() { initialized = false; }
+
+private:
+  float tau;
+  bool initialized = false;
+  Orientation out;
+};
+
+// Madgwick gradient-descent IMU filter. beta trades gyro trust for accel correction.
+template <typename Math = FloatMath>
+class MadgwickFilterT {
+public:
+  MadgwickFilterT(float beta = 0.1f) : beta(beta) {}
+
+  void update(float ax, float ay, float az, float gx, float gy, float gz, float dt);
+  const Orientation& orientation() const { return out; }
+  void reset() { initialized = false; }
+
+private:
+  float beta;
+  float q0 = 1, q1 = 0, q2 = 0, q3 = 0;
+  bool initialized = false;
+  Orientation out;
+};
+
+// Mahony PI complementary filter on the quaternion; ki > 0 also estimates gyro bias.
+template <typename Math = FloatMath>
+class MahonyFilterT {
+public:
+  MahonyFilterT(float kp = 1.0f, float ki = 0.0f) : kp(kp), ki(ki) {}
+
+  void update(float ax, float ay, float az, float gx, float gy, float gz, float dt);
+  const Orientation& orientation() const { return out; }
+  void reset() { initialized = false; }
+
+private:
+  float kp, ki;
+  float q0 = 1, q1 = 0, q2 = 0, q3 = 0;
+  float biasX = 0, biasY = 0, biasZ = 0;
+  bool initialized = false;
+  Orientation out;
+};
+
+typedef ComplementaryFilterT<> ComplementaryFilter;
+typedef MadgwickFilterT<> MadgwickFilter;
+typedef MahonyFilterT<> MahonyFilter;
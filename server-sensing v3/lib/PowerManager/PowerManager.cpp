@@ -0,0 +1,60 @@
+#include "PowerManager.h"
+
+#include <math.h>
+
+const char* PowerManager::stateName(PowerState s) {
+  switch (s) {
+    case POWER_ACTIVE: return "active";
+    case POWER_IDLE: return "idle";
+  }
+  return "?";
+}
+
+bool PowerManager::idleDue(uint32_t nowMs, float pitch, float rateDps, bool busy) {
+  if (current != POWER_ACTIVE || config.idleTimeoutMs == 0) {
+    return false;
+  }
+  bool still = tracking && !busy && fabsf(pitch - lastPitch) <= config.stillDegrees &&
+               fabsf(rateDps) <= config.stillRateDps;
+  lastPitch = pitch;
+  if (!still) {
+    tracking = true;
+    stillSinceMs = nowMs;
+    return false;
+  }
+  return nowMs - stillSinceMs >= config.idleTimeoutMs;
+}
+
+void PowerManager::enterIdle(uint32_t nowMs) {
+  if (current == POWER_IDLE) {
+    return;
+  }
+  activeTotalMs += nowMs - stateSinceMs;
+  stateSinceMs = nowMs;
+  current = POWER_IDLE;
+}
+
+void PowerManager::wake(uint32_t nowMs) {
+  if (current == POWER_ACTIVE) {
+    return;
+  }
+  idleTotalMs += nowMs - stateSinceMs;
+  stateSinceMs = nowMs;
+  current = POWER_ACTIVE;
+  tracking = false; // Start the stillness timer over
+  wakes++;
+}
+
+uint32_t PowerManager::activeMs(uint32_t nowMs) const {
+  return activeTotalMs + (current == POWER_ACTIVE ? nowMs - stateSinceMs : 0);
+}
+
+uint32_t PowerManager::idleMs(uint32_t nowMs) const {
+  return idleTotalMs + (current == POWER_IDLE ? nowMs - stateSinceMs : 0);
+}
+
+float PowerManager::dutyCycle(uint32_t nowMs) const {
+  uint32_t active = activeMs(nowMs);
+  uint32_t total = active + idleMs(nowMs);
+  return total == 0 ? 1.0f : (float)active / total;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <SampleScheduler.h>
+
+// Decides when the brace has been still (and unused) long enough to drop into the
+// low-power idle mode, and keeps the duty cycle and wake latency numbers. The
+// hardware side (IMU motion interrupt, light sleep, advertising) lives with the
+// caller; this only tracks state and time, so it runs on the host too.
+
+enum PowerState : uint8_t {
+  POWER_ACTIVE,
+  POWER_IDLE,
+};
+
+class PowerManager {
+public:
+  struct Config {
+    uint32_t idleTimeoutMs = 30000; // Still this long before going idle, 0 never idles
+    float stillDegrees = 1.5f;      // Largest pitch change between checks that counts as still
+    float stillRateDps = 10.0f;     // Largest joint angular rate that counts as still
+  };
+
+  PowerManager() {}
+  PowerManager(const Config& config) : config(config) {}
+
+  // Call at a steady rate while active. busy (e.g. a client is connected) keeps the
+  // device awake. Returns true once it's time to go idle.
+  bool idleDue(uint32_t nowMs, float pitch, float rateDps, bool busy);
+  void setIdleTimeout(uint32_t ms) { config.idleTimeoutMs = ms; }
+
+  void enterIdle(uint32_t nowMs);
+  void wake(uint32_t nowMs);
+  // Time from the wake event to the first full-rate sample
+  void recordWakeLatency(uint32_t micros) { wakeStats.record(micros); }
+
+  PowerState state() const { return current; }
+  uint32_t inStateMs(uint32_t nowMs) const { return nowMs - stateSinceMs; }
+  uint32_t activeMs(uint32_t nowMs) const;
+  uint32_t idleMs(uint32_t nowMs) const;
+  // Fraction of time spent sampling at full rate, 0-1
+  float dutyCycle(uint32_t nowMs) const;
+  uint32_t wakeCount() const { return wakes; }
+  const JitterStats& wakeLatency() const { return wakeStats; }
+
+  static const char* stateName(PowerState s);
+
+private:
+  Config config;
+  PowerState current = POWER_ACTIVE;
+  uint32_t stateSinceMs = 0;
+  uint32_t activeTotalMs = 0;
+  uint32_t idleTotalMs = 0;
+  bool tracking = false;
+  uint32_t stillSinceMs = 0;
+  float lastPitch = 0;
+  uint32_t wakes = 0;
+  JitterStats wakeStats;
+};
@@ -0,0 +1,114 @@
+#include "Profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void StageStats::record(uint32_t ticks) {
+  if (count == 0 || ticks < minTicks) {
+    minTicks = ticks;
+  }
+  if (ticks > maxTicks) {
+    maxTicks = ticks;
+  }
+  count++;
+  totalTicks += ticks;
+  histogram[bucketFor(ticks)]++;
+}
+
+uint32_t StageStats::meanTicks() const {
+  return count == 0 ? 0 : (uint32_t)(totalTicks / count);
+}
+
+uint32_t StageStats::percentileTicks(float p) const {
+  if (count == 0) {
+    return 0;
+  }
+  // Rank of the sample we're after, rounded up so p99 of 100 samples is the 99th
+  uint32_t rank = (uint32_t)((double)count * p / 100.0 + 0.999999);
+  if (rank == 0) {
+    rank = 1;
+  }
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < PROFILER_BUCKETS; i++) {
+    seen += histogram[i];
+    if (seen >= rank) {
+      uint32_t upper = bucketUpper(i);
+      return upper < maxTicks ? upper : maxTicks;
+    }
+  }
+  return maxTicks;
+}
+
+void StageStats::reset() {
+  count = 0;
+  minTicks = 0;
+  maxTicks = 0;
+  totalTicks = 0;
+  for (uint8_t i = 0; i < PROFILER_BUCKETS; i++) {
+    histogram[i] = 0;
+  }
+}
+
+uint8_t StageStats::bucketFor(uint32_t ticks) {
+  const uint32_t linear = 2u << PROFILER_SUB_BITS;
+  if (ticks < linear) {
+    return (uint8_t)ticks;
+  }
+  uint8_t msb = 31 - __builtin_clz(ticks);
+  uint8_t shift = msb - PROFILER_SUB_BITS;
+  // (ticks >> shift) keeps the top PROFILER_SUB_BITS + 1 bits, so it's in [4, 8)
+  return (uint8_t)((shift << PROFILER_SUB_BITS) + (ticks >> shift));
+}
+
+uint32_t StageStats::bucketUpper(uint8_t bucket) {
+  const uint32_t linear = 2u << PROFILER_SUB_BITS;
+  if (bucket < linear) {
+    return bucket;
+  }
+  uint8_t shift = (bucket >> PROFILER_SUB_BITS) - 1;
+  uint32_t mantissa = (bucket & ((1u << PROFILER_SUB_BITS) - 1)) + (1u << PROFILER_SUB_BITS);
+  uint64_t upper = ((uint64_t)(mantissa + 1) << shift) - 1;
+  return upper > 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)upper;
+}
+
+int8_t Profiler::addStage(const char* name) {
+  if (count >= MAX_STAGES) {
+    return -1;
+  }
+  stages[count].name = name;
+  stages[count].stats.reset();
+  return (int8_t)count++;
+}
+
+void Profiler::record(int8_t id, uint32_t ticks) {
+  if (id >= 0 && id < count) {
+    stages[id].stats.record(ticks);
+  }
+}
+
+void Profiler::reset() {
+  for (uint8_t i = 0; i < count; i++) {
+    stages[i].stats.reset();
+  }
+}
+
+size_t Profiler::report(char* out, size_t cap) const {
+  if (cap == 0) {
+    return 0;
+  }
+  size_t length = 0;
+  out[0] = '\0';
+  char line[96];
+  for (uint8_t i = 0; i < count; i++) {
+    const StageStats& s = stages[i].stats;
+    int n = snprintf(line, sizeof(line), "%s %lu %.1f/%.1f/%.1f/%.1f\n", stages[i].name,
+                     (unsigned long)s.count, toMicros(s.minTicks), toMicros(s.meanTicks()),
+                     toMicros(s.percentileTicks(99)), toMicros(s.maxTicks));
+    if (n < 0 || length + n >= cap) {
+      break;
+    }
+    memcpy(out + length, line, n + 1);
+    length += n;
+  }
+  return length;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Scoped hot-path timers with per-stage min/max/mean and a log-linear histogram
+// for percentiles, all in fixed memory. Ticks are CPU cycles on the ESP32 and
+// nanoseconds from steady_clock on the host.
+//
+// Each stage must only be recorded from one task; readers (serial, BLE) may see a
+// sample's worth of skew between fields, which is fine for diagnostics. The cycle
+// counter is per core, so a stage must also start and stop on the same core; all
+// our tasks are pinned.
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+inline uint32_t profilerTicks() { return ESP.getCycleCount(); }
+inline uint32_t profilerTicksPerMicro() { return ESP.getCpuFreqMHz(); }
+#else
+#include <chrono>
+inline uint32_t profilerTicks() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+inline uint32_t profilerTicksPerMicro() { return 1000; }
+#endif
+
+// Buckets are exact below 8 ticks, then 4 per power of two (at most 25% wide),
+// covering the full 32-bit range in 124 counters.
+#define PROFILER_SUB_BITS 2
+#define PROFILER_BUCKETS 124
+
+struct StageStats {
+  uint32_t count = 0;
+  uint32_t minTicks = 0;
+  uint32_t maxTicks = 0;
+  uint64_t totalTicks = 0;
+  uint32_t histogram[PROFILER_BUCKETS] = {};
+
+  void record(uint32_t ticks);
+  uint32_t meanTicks() const;
+  // Upper edge of the bucket holding the p-th percentile (0-100), capped at max
+  uint32_t percentileTicks(float p) const;
+  void reset();
+
+  static uint8_t bucketFor(uint32_t ticks);
+  static uint32_t bucketUpper(uint8_t bucket);
+};
+
+class Profiler {
+public:
+  static const uint8_t MAX_STAGES = 12;
+
+  // Returns the stage id, or -1 if the table is full.
+  int8_t addStage(const char* name);
+  void record(int8_t id, uint32_t ticks);
+
+  uint8_t stageCount() const { return count; }
+  const char* name(uint8_t id) const { return stages[id].name; }
+  const StageStats& stats(uint8_t id) const { return stages[id].stats; }
+  void reset();
+
+  static float toMicros(uint32_t ticks) { return (float)ticks / profilerTicksPerMicro(); }
+
+  // Text table, one line per stage with times in microseconds:
+  //   <stage> <count> <min>/<mean>/<p99>/<max>
+  // Truncated to whole lines if it doesn't fit. Returns the length written.
+  size_t report(char* out, size_t cap) const;
+
+private:
+  struct Stage {
+    const char* name;
+    StageStats stats;
+  };
+
+  Stage stages[MAX_STAGES];
+  uint8_t count = 0;
+};
+
+// Records the time from construction to the end of the enclosing scope.
+class ScopedTimer {
+public:
+  ScopedTimer(Profiler& profiler, int8_t stage)
+    : profiler(profiler), stage(stage), start(profilerTicks()) {}
+  ~ScopedTimer() { profiler.record(stage, profilerTicks() - start); }
+
+private:
+  Profiler& profiler;
+  int8_t stage;
+  uint32_t start;
+};
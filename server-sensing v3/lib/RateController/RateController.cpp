@@ -0,0 +1,117 @@
+#include "RateController.h"
+
+#define SMOOTHING 0.3f          // Weight of a new input in the running averages
+#define BLE_SKIP_THRESHOLD 0.2f // Skipped fraction that counts as a congested BLE link
+
+const char* RateController::modeName(RateMode mode) {
+  switch (mode) {
+    case RATE_ACTIVE: return "active";
+    case RATE_CALM: return "calm";
+    case RATE_DEGRADED: return "degraded";
+  }
+  return "?";
+}
+
+static uint8_t clampRate(uint8_t hz, uint8_t lo, uint8_t hi) {
+  return hz < lo ? lo : (hz > hi ? hi : hz);
+}
+
+void RateController::setLimits(const RateLimits& limits) {
+  config = limits;
+  // Keep min <= max so the rest never has to care
+  if (config.uploadIntervalMaxMs < config.uploadIntervalMinMs) {
+    config.uploadIntervalMaxMs = config.uploadIntervalMinMs;
+  }
+  if (config.recordRateMinHz == 0) config.recordRateMinHz = 1;
+  if (config.recordRateMaxHz < config.recordRateMinHz) config.recordRateMaxHz = config.recordRateMinHz;
+  if (config.streamRateMinHz == 0) config.streamRateMinHz = 1;
+  if (config.streamRateMaxHz < config.streamRateMinHz) config.streamRateMaxHz = config.streamRateMinHz;
+  forceDecision = true;
+}
+
+bool RateController::update(uint32_t nowMs, const RateInputs& in) {
+  activity += SMOOTHING * (in.motionDps - activity);
+  if (in.uploadLatencyMs > 0) {
+    latency = latency == 0 ? in.uploadLatencyMs : latency + SMOOTHING * (in.uploadLatencyMs - latency);
+  }
+
+  // Go active at once, but only drop back after a still spell, so the rates don't
+  // flap between the pauses of one set
+  if (activity > config.activeRateDps) {
+    active = true;
+    lastActiveMs = nowMs;
+  } else if (active && nowMs - lastActiveMs >= CALM_HOLD_MS) {
+    active = false;
+  }
+
+  RateDecision next = {};
+  next.atMs = nowMs;
+  next.activityDps = activity;
+  next.rssiDbm = in.rssiDbm;
+  next.latencyMs = (uint32_t)latency;
+
+  if (!config.adaptive) {
+    next.mode = RATE_ACTIVE;
+    next.reasons = RATE_REASON_FIXED;
+    next.uploadIntervalMs = config.uploadIntervalMinMs;
+    next.recordRateHz = config.recordRateMaxHz;
+    next.streamRateHz = config.streamRateMaxHz;
+  } else {
+    next.mode = active ? RATE_ACTIVE : RATE_CALM;
+    next.reasons = active ? RATE_REASON_MOTION : RATE_REASON_STILL;
+    next.uploadIntervalMs = active ? config.uploadIntervalMinMs : config.uploadIntervalMaxMs;
+    next.recordRateHz = active ? config.recordRateMaxHz : config.recordRateMinHz;
+    next.streamRateHz = active ? config.streamRateMaxHz : config.streamRateMinHz;
+
+    if (in.rssiDbm != 0 && in.rssiDbm < config.rssiFloorDbm) {
+      next.reasons |= RATE_REASON_RSSI;
+    }
+    if (config.latencyCeilingMs > 0 && latency > config.latencyCeilingMs) {
+      next.reasons |= RATE_REASON_LATENCY;
+    }
+    if (next.reasons & (RATE_REASON_RSSI | RATE_REASON_LATENCY)) {
+      // Fewer, larger uploads and half the recorded rows while the link struggles
+      next.mode = RATE_DEGRADED;
+      next.uploadIntervalMs = config.uploadIntervalMaxMs;
+      next.recordRateHz = clampRate(next.recordRateHz / 2, config.recordRateMinHz, config.recordRateMaxHz);
+    }
+    if (in.streamSkipRatio > BLE_SKIP_THRESHOLD) {
+      next.reasons |= RATE_REASON_BLE;
+      next.streamRateHz = clampRate(next.streamRateHz / 2, config.streamRateMinHz, config.streamRateMaxHz);
+    }
+  }
+
+  bool changed = forceDecision || next.mode != current.mode || next.reasons != current.reasons ||
+                 next.uploadIntervalMs != current.uploadIntervalMs ||
+                 next.recordRateHz != current.recordRateHz || next.streamRateHz != current.streamRateHz;
+  if (!changed) {
+    return false;
+  }
+  forceDecision = false;
+  current = next;
+  past[historyHead] = next;
+  historyHead = (historyHead + 1) % HISTORY;
+  if (historyCount < HISTORY) {
+    historyCount++;
+  }
+  return true;
+}
+
+uint8_t RateController::streamRateFor(uint8_t minHz, uint8_t maxHz, float skipRatio) const {
+  if (minHz == 0) minHz = config.streamRateMinHz;
+  if (maxHz == 0) maxHz = config.streamRateMaxHz;
+  if (maxHz < minHz) maxHz = minHz;
+  if (!config.adaptive) {
+    return maxHz;
+  }
+  uint8_t hz = (current.reasons & RATE_REASON_MOTION) ? maxHz : minHz;
+  if (skipRatio > BLE_SKIP_THRESHOLD) {
+    hz = clampRate(hz / 2, minHz, maxHz);
+  }
+  return hz;
+}
+
+const RateDecision& RateController::history(size_t i) const {
+  size_t oldest = (historyHead + HISTORY - historyCount) % HISTORY;
+  return past[(oldest + i) % HISTORY];
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Picks the upload interval and the record and stream rates from how much the
+// patient is moving and how good the links are: full rate during exercise, slow
+// when still, and gentler uploads when WiFi RSSI or upload latency degrade. Every
+// change is kept in a short history (and logged by the caller) so the decisions
+// can be looked at afterwards. No Arduino dependencies, so it runs on the host.
+
+enum RateMode : uint8_t {
+  RATE_ACTIVE,
+  RATE_CALM,
+  RATE_DEGRADED, // Moving or not, the upload link is poor
+};
+
+// Why the current decision was made
+#define RATE_REASON_MOTION  0x01
+#define RATE_REASON_STILL   0x02
+#define RATE_REASON_RSSI    0x04
+#define RATE_REASON_LATENCY 0x08
+#define RATE_REASON_BLE     0x10 // Clients are skipping stream frames
+#define RATE_REASON_FIXED   0x20 // Adaptive rates are off
+
+struct RateLimits {
+  uint32_t uploadIntervalMinMs = 2000;
+  uint32_t uploadIntervalMaxMs = 15000;
+  uint8_t recordRateMinHz = 5;
+  uint8_t recordRateMaxHz = 20;
+  uint8_t streamRateMinHz = 2;
+  uint8_t streamRateMaxHz = 10;
+  float activeRateDps = 20.0f;
+  int8_t rssiFloorDbm = -80;
+  uint16_t latencyCeilingMs = 3000;
+  bool adaptive = true;
+};
+
+struct RateInputs {
+  float motionDps;          // Mean |joint rate| since the last update
+  int8_t rssiDbm;           // WiFi RSSI, 0 while not connected
+  uint32_t uploadLatencyMs; // Latest upload since the last update, 0 if none
+  float streamSkipRatio;    // Fraction of stream sends skipped since the last update
+};
+
+struct RateDecision {
+  uint32_t atMs;
+  RateMode mode;
+  uint8_t reasons;
+  uint32_t uploadIntervalMs;
+  uint8_t recordRateHz;
+  uint8_t streamRateHz;
+  float activityDps; // Smoothed inputs at the time
+  int8_t rssiDbm;
+  uint32_t latencyMs;
+};
+
+class RateController {
+public:
+  static const size_t HISTORY = 32;
+  static const uint32_t CALM_HOLD_MS = 10000; // Still this long before dropping to calm rates
+
+  RateController() { setLimits(RateLimits()); }
+  RateController(const RateLimits& limits) { setLimits(limits); }
+
+  // Takes effect at the next update(), which then always reports a change
+  void setLimits(const RateLimits& limits);
+  const RateLimits& limits() const { return config; }
+
+  // Call at a steady rate. Returns true if the decision changed.
+  bool update(uint32_t nowMs, const RateInputs& in);
+  const RateDecision& decision() const { return current; }
+  // Stream rate for one client within its own limits (0 uses the shared ones),
+  // following the current decision: max while active, min while calm, halved when
+  // that client is skipping frames
+  uint8_t streamRateFor(uint8_t minHz, uint8_t maxHz, float skipRatio) const;
+
+  // Recent decisions, oldest first
+  size_t historySize() const { return historyCount; }
+  const RateDecision& history(size_t i) const;
+
+  static const char* modeName(RateMode mode);
+
+private:
+  RateLimits config;
+  RateDecision current = {};
+  bool forceDecision = true;
+  bool active = false;
+  uint32_t lastActiveMs = 0;
+  float activity = 0;
+  float latency = 0;
+
+  RateDecision past[HISTORY];
+  size_t historyHead = 0;
+  size_t historyCount = 0;
+};
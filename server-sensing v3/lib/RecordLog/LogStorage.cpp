@@ -0,0 +1,127 @@
+#include "LogStorage.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+FileLogStorage::~FileLogStorage() {
+  closeWriter();
+  closeReader();
+}
+
+bool FileLogStorage::begin() {
+  struct stat st;
+  if (stat(dir, &st) == 0) {
+    return true;
+  }
+  return mkdir(dir, 0755) == 0;
+}
+
+void FileLogStorage::segmentPath(uint32_t segment, char* out, size_t outLen) const {
+  snprintf(out, outLen, "%s/%08lu.log", dir, (unsigned long)segment);
+}
+
+void FileLogStorage::closeWriter() {
+  if (writer != nullptr) {
+    sync();
+    fclose(writer);
+    writer = nullptr;
+  }
+}
+
+void FileLogStorage::closeReader() {
+  if (reader != nullptr) {
+    fclose(reader);
+    reader = nullptr;
+  }
+}
+
+bool FileLogStorage::append(uint32_t segment, const uint8_t* data, size_t len) {
+  if (writer == nullptr || writerSegment != segment) {
+    closeWriter();
+    char path[96];
+    segmentPath(segment, path, sizeof(path));
+    writer = fopen(path, "ab");
+    if (writer == nullptr) {
+      return false;
+    }
+    writerSegment = segment;
+  }
+  dirty = true;
+  return fwrite(data, 1, len, writer) == len;
+}
+
+// fflush() only hands the bytes to the VFS; fsync() is what makes LittleFS commit
+// the file's new size, so the data survives a reset and the reader handle sees it
+bool FileLogStorage::sync() {
+  if (writer == nullptr || !dirty) {
+    return true;
+  }
+  if (fflush(writer) != 0 || fsync(fileno(writer)) != 0) {
+    return false;
+  }
+  dirty = false;
+  return true;
+}
+
+int32_t FileLogStorage::read(uint32_t segment, uint32_t offset, uint8_t* out, size_t len) {
+  if (reader == nullptr || readerSegment != segment) {
+    closeReader();
+    char path[96];
+    segmentPath(segment, path, sizeof(path));
+    reader = fopen(path, "rb");
+    if (reader == nullptr) {
+      return -1;
+    }
+    readerSegment = segment;
+  }
+  if (fseek(reader, offset, SEEK_SET) != 0) {
+    return 0;
+  }
+  return (int32_t)fread(out, 1, len, reader);
+}
+
+int32_t FileLogStorage::size(uint32_t segment) {
+  char path[96];
+  segmentPath(segment, path, sizeof(path));
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    return -1;
+  }
+  return (int32_t)st.st_size;
+}
+
+bool FileLogStorage::remove(uint32_t segment) {
+  if (writer != nullptr && writerSegment == segment) {
+    closeWriter();
+  }
+  if (reader != nullptr && readerSegment == segment) {
+    closeReader();
+  }
+  char path[96];
+  segmentPath(segment, path, sizeof(path));
+  return ::remove(path) == 0;
+}
+
+bool FileLogStorage::writeMeta(uint8_t slot, const uint8_t* data, size_t len) {
+  char path[96];
+  snprintf(path, sizeof(path), "%s/cursor%u", dir, (unsigned)slot);
+  FILE* f = fopen(path, "wb");
+  if (f == nullptr) {
+    return false;
+  }
+  bool ok = fwrite(data, 1, len, f) == len && fflush(f) == 0 && fsync(fileno(f)) == 0;
+  ok = (fclose(f) == 0) && ok;
+  return ok;
+}
+
+bool FileLogStorage::readMeta(uint8_t slot, uint8_t* out, size_t len) {
+  char path[96];
+  snprintf(path, sizeof(path), "%s/cursor%u", dir, (unsigned)slot);
+  FILE* f = fopen(path, "rb");
+  if (f == nullptr) {
+    return false;
+  }
+  bool ok = fread(out, 1, len, f) == len;
+  fclose(f);
+  return ok;
+}
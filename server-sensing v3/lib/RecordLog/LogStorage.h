@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Where RecordLog keeps its segments and cursor. Segments are numbered files that
+// are only ever appended to or removed whole; the two meta slots hold the cursor.
+class LogStorage {
+public:
+  virtual ~LogStorage() {}
+
+  virtual bool append(uint32_t segment, const uint8_t* data, size_t len) = 0;
+  // Returns once everything appended is durable and visible to read()
+  virtual bool sync() = 0;
+  // Returns bytes read, or -1 if the segment doesn't exist
+  virtual int32_t read(uint32_t segment, uint32_t offset, uint8_t* out, size_t len) = 0;
+  // Returns the segment size, or -1 if it doesn't exist
+  virtual int32_t size(uint32_t segment) = 0;
+  virtual bool remove(uint32_t segment) = 0;
+  virtual bool writeMeta(uint8_t slot, const uint8_t* data, size_t len) = 0;
+  virtual bool readMeta(uint8_t slot, uint8_t* out, size_t len) = 0;
+};
+
+// Plain stdio files under one directory. On the ESP32 point it at the LittleFS
+// mount (e.g. "/littlefs/log"); on the host any writable directory works.
+class FileLogStorage : public LogStorage {
+public:
+  FileLogStorage(const char* directory) : dir(directory) {}
+  ~FileLogStorage();
+
+  // Creates the directory if needed
+  bool begin();
+
+  bool append(uint32_t segment, const uint8_t* data, size_t len) override;
+  bool sync() override;
+  int32_t read(uint32_t segment, uint32_t offset, uint8_t* out, size_t len) override;
+  int32_t size(uint32_t segment) override;
+  bool remove(uint32_t segment) override;
+  bool writeMeta(uint8_t slot, const uint8_t* data, size_t len) override;
+  bool readMeta(uint8_t slot, uint8_t* out, size_t len) override;
+
+private:
+  void segmentPath(uint32_t segment, char* out, size_t outLen) const;
+  void closeWriter();
+  void closeReader();
+
+  const char* dir;
+  // One handle each for appending and reading, kept open between calls
+  FILE* writer = nullptr;
+  uint32_t writerSegment = 0;
+  bool dirty = false;      // Appended since the last sync()
+  FILE* reader = nullptr;
+  uint32_t readerSegment = 0;
+};
@@ -0,0 +1,191 @@
+#include "RecordLog.h"
+
+#include <stddef.h>
+#include <string.h>
+
+static const uint8_t RECORD_MAGIC = 0xA7;
+static const uint32_t RECORD_OVERHEAD = 4; // magic + len + crc16
+
+static uint16_t crc16(const uint8_t* data, size_t len, uint16_t crc = 0xFFFF) {
+  // CRC-16/CCITT-FALSE
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+struct CursorMeta {
+  uint32_t seq;
+  uint32_t segment;
+  uint32_t offset;
+  uint16_t crc;
+};
+
+bool RecordLog::begin() {
+  if (!loadCursor()) {
+    committed.segment = 0;
+    committed.offset = 0;
+    cursorSeq = 0;
+  }
+
+  // Segments are numbered without gaps, so probe forward to find the newest
+  head = committed.segment;
+  while (storage.size(head + 1) >= 0) {
+    head++;
+  }
+
+  // Segments before the cursor are leftovers from a reset between commit and delete
+  for (uint32_t s = committed.segment; s > 0 && storage.size(s - 1) >= 0; s--) {
+    storage.remove(s - 1);
+  }
+
+  int32_t size = storage.size(head);
+  headBytes = size < 0 ? 0 : (uint32_t)size;
+  if (size > 0 && validLength(head, size) != (uint32_t)size) {
+    // Torn write at the end: leave it for readers to skip and start a fresh segment
+    head++;
+    headBytes = 0;
+  }
+  return true;
+}
+
+bool RecordLog::append(const void* data, uint8_t len) {
+  uint32_t recordBytes = len + RECORD_OVERHEAD;
+  if (headBytes > 0 && headBytes + recordBytes > segmentBytes) {
+    storage.sync();
+    head++;
+    headBytes = 0;
+    // Out of room: give up the oldest segment rather than stop logging
+    if (segmentsInUse() > maxSegments) {
+      storage.remove(committed.segment);
+      committed.segment++;
+      committed.offset = 0;
+      dropped++;
+      saveCursor();
+    }
+  }
+
+  uint8_t record[MAX_RECORD + RECORD_OVERHEAD];
+  record[0] = RECORD_MAGIC;
+  record[1] = len;
+  memcpy(record + 2, data, len);
+  uint16_t crc = crc16(record + 1, len + 1);
+  record[2 + len] = (uint8_t)(crc >> 8);
+  record[3 + len] = (uint8_t)crc;
+
+  if (!storage.append(head, record, recordBytes)) {
+    // Part of the record may have reached the file. Readers stop at a bad record in
+    // the head segment, so move on to a fresh one to keep later records readable.
+    storage.sync();
+    if (storage.size(head) > (int32_t)headBytes) {
+      head++;
+      headBytes = 0;
+    }
+    return false;
+  }
+  headBytes += recordBytes;
+  written++;
+  return true;
+}
+
+bool RecordLog::readRecord(uint32_t segment, uint32_t offset, uint8_t* payload, uint8_t& len) {
+  uint8_t header[2];
+  if (storage.read(segment, offset, header, 2) != 2 || header[0] != RECORD_MAGIC) {
+    return false;
+  }
+  len = header[1];
+  uint8_t body[MAX_RECORD + 2];
+  if (storage.read(segment, offset + 2, body, len + 2) != len + 2) {
+    return false;
+  }
+  uint16_t crc = crc16(header + 1, 1);
+  crc = crc16(body, len, crc);
+  if (body[len] != (uint8_t)(crc >> 8) || body[len + 1] != (uint8_t)crc) {
+    return false;
+  }
+  if (payload != nullptr) {
+    memcpy(payload, body, len);
+  }
+  return true;
+}
+
+uint32_t RecordLog::validLength(uint32_t segment, int32_t fileSize) {
+  uint32_t offset = 0;
+  uint8_t len;
+  while (offset < (uint32_t)fileSize && readRecord(segment, offset, nullptr, len)) {
+    offset += len + RECORD_OVERHEAD;
+  }
+  return offset;
+}
+
+bool RecordLog::read(LogCursor& cursor, void* out, uint8_t maxLen, uint8_t& len) {
+  uint8_t payload[MAX_RECORD];
+  while (true) {
+    if (cursor.segment == head) {
+      if (cursor.offset >= headBytes) {
+        return false;
+      }
+      // The record may still be sitting in the append buffer
+      storage.sync();
+    } else if (cursor.segment > head) {
+      return false;
+    }
+
+    if (readRecord(cursor.segment, cursor.offset, payload, len)) {
+      cursor.offset += len + RECORD_OVERHEAD;
+      memcpy(out, payload, len < maxLen ? len : maxLen);
+      return true;
+    }
+
+    if (cursor.segment == head) {
+      return false;
+    }
+    // End of an older segment, or a torn record: carry on in the next one
+    cursor.segment++;
+    cursor.offset = 0;
+  }
+}
+
+bool RecordLog::commit(const LogCursor& cursor) {
+  if (cursor.segment < committed.segment) {
+    return true; // Those records were already dropped to make room
+  }
+  while (committed.segment < cursor.segment) {
+    storage.remove(committed.segment);
+    committed.segment++;
+  }
+  committed.offset = cursor.offset;
+  return saveCursor();
+}
+
+bool RecordLog::saveCursor() {
+  CursorMeta meta;
+  meta.seq = ++cursorSeq;
+  meta.segment = committed.segment;
+  meta.offset = committed.offset;
+  meta.crc = crc16((const uint8_t*)&meta, offsetof(CursorMeta, crc));
+  return storage.writeMeta(meta.seq & 1, (const uint8_t*)&meta, sizeof(meta));
+}
+
+bool RecordLog::loadCursor() {
+  bool found = false;
+  for (uint8_t slot = 0; slot < 2; slot++) {
+    CursorMeta meta;
+    if (!storage.readMeta(slot, (uint8_t*)&meta, sizeof(meta))) {
+      continue;
+    }
+    if (meta.crc != crc16((const uint8_t*)&meta, offsetof(CursorMeta, crc))) {
+      continue;
+    }
+    if (!found || (int32_t)(meta.seq - cursorSeq) > 0) {
+      cursorSeq = meta.seq;
+      committed.segment = meta.segment;
+      committed.offset = meta.offset;
+      found = true;
+    }
+  }
+  return found;
+}
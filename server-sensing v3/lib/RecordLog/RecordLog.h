@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "LogStorage.h"
+
+// Position of the next record to read
+struct LogCursor {
+  uint32_t segment;
+  uint32_t offset;
+};
+
+// Append-only log of small records, split into numbered segment files.
+//
+// Each record is [magic][len][payload][crc16]; the CRC is written last and acts as
+// the commit marker, so a record torn by a reset is detected and skipped. Segments
+// are never rewritten: new data always goes to the newest segment, fully drained
+// segments are deleted, and when maxSegments is reached the oldest is dropped.
+// The read cursor is saved to two alternating slots so a reset while saving it
+// leaves the previous copy intact.
+class RecordLog {
+public:
+  static const uint8_t MAX_RECORD = 255;
+
+  RecordLog(LogStorage& storage, uint32_t segmentBytes = 16384, uint32_t maxSegments = 64)
+    : storage(storage), segmentBytes(segmentBytes), maxSegments(maxSegments < 2 ? 2 : maxSegments) {}
+
+  // Recovers the cursor and the newest segment after a reset.
+  bool begin();
+
+  // Returns false if the record couldn't be written; it is not in the log.
+  bool append(const void* data, uint8_t len);
+  // Makes appended records durable. Until it succeeds they may be lost on a reset.
+  bool sync() { return storage.sync(); }
+
+  // Reads the record at cursor and advances it. Returns false when nothing is left.
+  // len is set to the stored length even if it exceeds maxLen (the copy is truncated).
+  bool read(LogCursor& cursor, void* out, uint8_t maxLen, uint8_t& len);
+
+  // The oldest unconsumed record. Reads start here.
+  LogCursor tail() const { return committed; }
+  // Marks everything before cursor as consumed and deletes drained segments.
+  bool commit(const LogCursor& cursor);
+
+  bool empty() const { return committed.segment == head && committed.offset >= headBytes; }
+  uint32_t segmentsInUse() const { return head - committed.segment + 1; }
+  uint32_t recordsWritten() const { return written; }
+  uint32_t droppedSegments() const { return dropped; }
+
+private:
+  bool saveCursor();
+  bool loadCursor();
+  // Offset just past the last valid record in a segment
+  uint32_t validLength(uint32_t segment, int32_t fileSize);
+  bool readRecord(uint32_t segment, uint32_t offset, uint8_t* payload, uint8_t& len);
+
+  LogStorage& storage;
+  uint32_t segmentBytes;
+  uint32_t maxSegments;
+
+  uint32_t head = 0;       // Segment new records go to
+  uint32_t headBytes = 0;
+  LogCursor committed = {0, 0};
+  uint32_t cursorSeq = 0;
+
+  uint32_t written = 0;
+  uint32_t dropped = 0;
+};
@@ -0,0 +1,91 @@
+#include "RepAnalytics.h"
+
+void RepAnalytics::openRep(uint32_t micros, float pitch) {
+  open = true;
+  repStartMicros = micros;
+  minPitch = pitch;
+  maxPitch = pitch;
+  peakRate = 0;
+  absRateIntegral = 0;
+  tensionMicros = 0;
+}
+
+bool RepAnalytics::update(uint32_t micros, float pitch, float rateDps, bool bend) {
+  float speed = fabsf(rateDps);
+  if (open) {
+    uint32_t dt = micros - lastMicros;
+    if (pitch < minPitch) {
+      minPitch = pitch;
+    }
+    if (pitch > maxPitch) {
+      maxPitch = pitch;
+    }
+    if (speed > peakRate) {
+      peakRate = speed;
+    }
+    absRateIntegral += speed * (dt / 1000000.0f);
+    if (speed >= config.movingRateDps) {
+      tensionMicros += dt;
+    }
+    if (micros - repStartMicros > config.maxRepMs * 1000UL) {
+      open = false; // Rested too long, this wasn't a rep
+    }
+  }
+  lastMicros = micros;
+
+  if (!bend) {
+    return false;
+  }
+  bool closed = false;
+  if (open) {
+    uint32_t durationMicros = micros - repStartMicros;
+    last.rep = ++reps;
+    last.endMicros = micros;
+    last.durationMs = durationMicros / 1000;
+    last.minPitch = minPitch;
+    last.maxPitch = maxPitch;
+    last.romDeg = maxPitch - minPitch;
+    last.peakVelocityDps = peakRate;
+    last.meanVelocityDps = durationMicros > 0 ? absRateIntegral / (durationMicros / 1000000.0f) : 0;
+    last.tensionMs = tensionMicros / 1000;
+
+    activeMs += last.durationMs;
+    tensionMs += last.tensionMs;
+    if (last.romDeg > maxRom) {
+      maxRom = last.romDeg;
+    }
+    romStats.add(last.romDeg);
+    durationStats.add((float)last.durationMs);
+    peakStats.add(last.peakVelocityDps);
+    closed = true;
+  }
+  openRep(micros, pitch);
+  return closed;
+}
+
+void RepAnalytics::startSession() {
+  open = false;
+  last = RepSummary();
+  reps = 0;
+  activeMs = 0;
+  tensionMs = 0;
+  maxRom = 0;
+  romStats.reset();
+  durationStats.reset();
+  peakStats.reset();
+}
+
+SessionSummary RepAnalytics::session() const {
+  SessionSummary s;
+  s.reps = reps;
+  s.activeMs = activeMs;
+  s.meanRomDeg = romStats.mean();
+  s.maxRomDeg = maxRom;
+  s.meanPeakVelocityDps = peakStats.mean();
+  s.cadenceRpm = activeMs > 0 ? reps * 60000.0f / activeMs : 0;
+  s.tensionMs = tensionMs;
+  // Average spread of ROM and rep duration, mapped so 0 spread scores 100
+  float spread = (romStats.cv() + durationStats.cv()) / 2;
+  s.consistency = spread >= 1 ? 0 : 100 * (1 - spread);
+  return s;
+}
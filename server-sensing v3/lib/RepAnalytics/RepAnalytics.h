@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+// Per-rep and per-session exercise metrics, computed one sample at a time with no
+// sample storage. A rep runs from one detected bend to the next; if the next bend
+// takes longer than maxRepMs the open rep is treated as rest and dropped, and that
+// bend starts a fresh rep.
+
+struct RepSummary {
+  uint16_t rep;           // 1-based index within the session
+  uint32_t endMicros;
+  uint32_t durationMs;
+  float minPitch;         // degrees
+  float maxPitch;
+  float romDeg;           // range of motion, maxPitch - minPitch
+  float peakVelocityDps;  // largest |joint rate|
+  float meanVelocityDps;  // time-averaged |joint rate|
+  uint32_t tensionMs;     // time spent moving faster than movingRateDps
+};
+
+struct SessionSummary {
+  uint16_t reps;
+  uint32_t activeMs;           // sum of rep durations
+  float meanRomDeg;
+  float maxRomDeg;
+  float meanPeakVelocityDps;
+  float cadenceRpm;            // reps per minute of rep time
+  uint32_t tensionMs;
+  float consistency;           // 0-100; 100 means every rep had the same ROM and duration
+};
+
+// Running mean and variance (Welford), stable without keeping the samples.
+class RunningStats {
+public:
+  void add(float x) {
+    n++;
+    float d = x - m;
+    m += d / n;
+    m2 += d * (x - m);
+  }
+  uint32_t count() const { return n; }
+  float mean() const { return m; }
+  float variance() const { return n > 1 ? m2 / (n - 1) : 0.0f; }
+  float stddev() const { return sqrtf(variance()); }
+  // Coefficient of variation, 0 while there's nothing to compare
+  float cv() const { return n > 1 && m > 0 ? stddev() / m : 0.0f; }
+  void reset() { n = 0; m = 0; m2 = 0; }
+
+private:
+  uint32_t n = 0;
+  float m = 0;
+  float m2 = 0;
+};
+
+class RepAnalytics {
+public:
+  struct Config {
+    uint32_t maxRepMs = 10000;   // Longer gaps between bends are rest, not a rep
+    float movingRateDps = 10.0f; // Joint rate that counts as under tension
+  };
+
+  RepAnalytics() {}
+  RepAnalytics(const Config& config) : config(config) {}
+
+  // Feeds one sample along with the bend detector's verdict for it. Returns true if
+  // the sample closed a rep; its summary is then in lastRep().
+  bool update(uint32_t micros, float pitch, float rateDps, bool bend);
+
+  // Clears the session totals (the current rep, if any, is dropped too)
+  void startSession();
+
+  const RepSummary& lastRep() const { return last; }
+  SessionSummary session() const;
+  bool repOpen() const { return open; }
+
+private:
+  void openRep(uint32_t micros, float pitch);
+
+  Config config;
+
+  // Rep in progress
+  bool open = false;
+  uint32_t repStartMicros = 0;
+  uint32_t lastMicros = 0;
+  float minPitch = 0;
+  float maxPitch = 0;
+  float peakRate = 0;
+  float absRateIntegral = 0; // degrees travelled
+  uint32_t tensionMicros = 0;
+
+  // Session
+  RepSummary last = {};
+  uint16_t reps = 0;
+  uint32_t activeMs = 0;
+  uint32_t tensionMs = 0;
+  float maxRom = 0;
+  RunningStats romStats;
+  RunningStats durationStats;
+  RunningStats peakStats;
+};
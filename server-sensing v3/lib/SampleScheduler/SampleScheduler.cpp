@@ -0,0 +1,81 @@
+#include "SampleScheduler.h"
+
+void JitterStats::record(uint32_t lateMicros) {
+  runs++;
+  totalLateMicros += lateMicros;
+  if (lateMicros > maxLateMicros) {
+    maxLateMicros = lateMicros;
+  }
+}
+
+uint32_t JitterStats::meanLateMicros() const {
+  return runs == 0 ? 0 : (uint32_t)(totalLateMicros / runs);
+}
+
+void JitterStats::reset() {
+  runs = 0;
+  missed = 0;
+  maxLateMicros = 0;
+  totalLateMicros = 0;
+}
+
+int8_t SampleScheduler::addJob(const char* name, uint32_t periodMicros, JobFn fn) {
+  if (count >= MAX_JOBS || periodMicros == 0 || fn == nullptr) {
+    return -1;
+  }
+  Job& job = jobs[count];
+  job.name = name;
+  job.periodMicros = periodMicros;
+  job.nextDueMicros = 0;
+  job.started = false;
+  job.fn = fn;
+  job.stats.reset();
+  return (int8_t)count++;
+}
+
+void SampleScheduler::setPeriod(uint8_t id, uint32_t periodMicros) {
+  if (id < count && periodMicros > 0) {
+    jobs[id].periodMicros = periodMicros;
+  }
+}
+
+void SampleScheduler::run(uint32_t nowMicros) {
+  for (uint8_t i = 0; i < count; i++) {
+    Job& job = jobs[i];
+    if (!job.started) {
+      // First call anchors the schedule so every job starts immediately
+      job.started = true;
+      job.nextDueMicros = nowMicros;
+    }
+
+    // Signed difference keeps this correct across the 32-bit micros() wrap
+    int32_t late = (int32_t)(nowMicros - job.nextDueMicros);
+    if (late < 0) {
+      continue;
+    }
+
+    job.stats.record((uint32_t)late);
+    job.nextDueMicros += job.periodMicros;
+
+    // If we fell more than a period behind, skip ahead instead of bursting
+    if ((uint32_t)late >= job.periodMicros) {
+      uint32_t skipped = (uint32_t)late / job.periodMicros;
+      job.stats.missed += skipped;
+      job.nextDueMicros += skipped * job.periodMicros;
+    }
+
+    job.fn(nowMicros);
+  }
+}
+
+void SampleScheduler::resetStats() {
+  for (uint8_t i = 0; i < count; i++) {
+    jobs[i].stats.reset();
+  }
+}
+
+void SampleScheduler::restart() {
+  for (uint8_t i = 0; i < count; i++) {
+    jobs[i].started = false;
+  }
+}
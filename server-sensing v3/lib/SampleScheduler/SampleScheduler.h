@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+
+// Runs a handful of periodic jobs off one microsecond clock, each at its own rate.
+// The clock is passed in by the caller, so the same code runs on the ESP32 with
+// micros() and on the host with a simulated clock.
+
+struct JitterStats {
+  uint32_t runs = 0;
+  uint32_t missed = 0;          // whole periods skipped because we fell behind
+  uint32_t maxLateMicros = 0;   // worst delay between due time and actual run
+  uint64_t totalLateMicros = 0;
+
+  void record(uint32_t lateMicros);
+  uint32_t meanLateMicros() const;
+  void reset();
+};
+
+class SampleScheduler {
+public:
+  typedef void (*JobFn)(uint32_t nowMicros);
+
+  static const uint8_t MAX_JOBS = 8;
+
+  // Returns the job id, or -1 if the table is full or the period is zero.
+  int8_t addJob(const char* name, uint32_t periodMicros, JobFn fn);
+  void setPeriod(uint8_t id, uint32_t periodMicros);
+  uint32_t period(uint8_t id) const { return jobs[id].periodMicros; }
+
+  // Runs every job that is due at nowMicros. Jobs keep a fixed-rate schedule
+  // (next = due + period) so a late run does not push later runs back.
+  void run(uint32_t nowMicros);
+
+  uint8_t jobCount() const { return count; }
+  const char* name(uint8_t id) const { return jobs[id].name; }
+  const JitterStats& stats(uint8_t id) const { return jobs[id].stats; }
+  void resetStats();
+  // Re-anchors every job at the next run(), e.g. after loop() was paused, so the
+  // pause isn't counted as missed periods.
+  void restart();
+
+private:
+  struct Job {
+    const char* name;
+    uint32_t periodMicros;
+    uint32_t nextDueMicros;
+    bool started;
+    JobFn fn;
+    JitterStats stats;
+  };
+
+  Job jobs[MAX_JOBS];
+  uint8_t count = 0;
+};
+
+// Converts a rate in Hz to a period in microseconds, clamped to at least 1 us.
+inline uint32_t periodFromHz(uint32_t hz) {
+  return hz == 0 ? 0 : (hz >= 1000000UL ? 1 : 1000000UL / hz);
+}
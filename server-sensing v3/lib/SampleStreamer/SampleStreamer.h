@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <RehabProtocol.h>
+
+// Queue of angle samples waiting to be streamed over BLE. When the link can't keep
+// up the queue drops its oldest samples, so what does get sent is always recent.
+// Samples only leave the queue once commit() confirms the notify went out.
+template <size_t Capacity>
+class SampleStreamer {
+public:
+  static_assert(Capacity > 0, "stream queue capacity must be non-zero");
+
+  void push(const StreamSample& sample) {
+    if (count == Capacity) {
+      tail = (tail + 1) % Capacity;
+      count--;
+      dropped++;
+    }
+    buf[(tail + count) % Capacity] = sample;
+    count++;
+    pushed++;
+  }
+
+  // Packs the oldest queued samples into one frame of at most maxFrameBytes
+  // (the negotiated ATT MTU minus 3). Returns the frame length, 0 if empty.
+  size_t buildFrame(uint16_t seq, uint8_t* out, size_t maxFrameBytes, size_t& packed) const {
+    if (count == 0) {
+      packed = 0;
+      return 0;
+    }
+    StreamSample batch[MAX_FRAME_BYTES / STREAM_SAMPLE_BYTES];
+    size_t n = count < sizeof(batch) / sizeof(batch[0]) ? count : sizeof(batch) / sizeof(batch[0]);
+    for (size_t i = 0; i < n; i++) {
+      batch[i] = buf[(tail + i) % Capacity];
+    }
+    return encodeStreamFrame(seq, batch, n, out, maxFrameBytes, packed);
+  }
+
+  // Removes the samples of a frame that was handed to the BLE stack.
+  void commit(size_t packed) {
+    if (packed > count) {
+      packed = count;
+    }
+    tail = (tail + packed) % Capacity;
+    count -= packed;
+    sent += packed;
+    frames++;
+  }
+
+  // The stack had no free notify buffers, so this tick sent nothing.
+  void recordStall() { stalls++; }
+
+  void clear() { tail = 0; count = 0; }
+
+  size_t size() const { return count; }
+  uint32_t pushedCount() const { return pushed; }
+  uint32_t sentCount() const { return sent; }
+  uint32_t droppedCount() const { return dropped; }
+  uint32_t framesSent() const { return frames; }
+  uint32_t stallCount() const { return stalls; }
+
+private:
+  StreamSample buf[Capacity];
+  size_t tail = 0;
+  size_t count = 0;
+
+  uint32_t pushed = 0;
+  uint32_t sent = 0;
+  uint32_t dropped = 0;
+  uint32_t frames = 0;
+  uint32_t stalls = 0;
+};
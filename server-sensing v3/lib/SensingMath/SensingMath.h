@@ -0,0 +1,177 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+// Numeric policies for the per-sample pitch and threshold math, picked at compile
+// time by the template argument of the orientation filters and SensingPipeline.
+// A policy provides:
+//   Scalar          the bend detector's signal type (float or a fixed-point type)
+//   atan2Deg(y, x)  atan2 in degrees, so no separate radian conversion
+//   rsqrt(x)        1 / sqrt(x), for the vector and quaternion normalisation
+//   sqrt(x)
+// plus the worst-case error it promises, which test_sensing_math checks against
+// libm. No Arduino headers, so this builds for the native environment too.
+
+static constexpr float SENSING_RAD_TO_DEG = 57.2957795f;
+static constexpr float SENSING_INV_G = 1.0f / 9.81f; // m/s^2 to G without a divide
+
+// Signed fixed point in 32 bits with FracBits fractional bits. Products and
+// quotients go through 64 bits. Sums are exact, so a running window sum can't
+// drift, but it has to fit: a 2000-sample window of +-8 G needs FracBits <= 17.
+template <int FracBits>
+class Fixed {
+public:
+  static_assert(FracBits > 0 && FracBits < 31, "fractional bits must leave a sign bit");
+  static constexpr int32_t ONE = (int32_t)1 << FracBits;
+
+  constexpr Fixed() : raw(0) {}
+  constexpr Fixed(float v) : raw((int32_t)(v * (float)ONE + (v < 0 ? -0.5f : 0.5f))) {}
+  // Integers and doubles; setup code only, double is soft-float on the ESP32
+  template <typename U>
+  constexpr Fixed(U v) : raw(fromDouble((double)v)) {}
+
+  static constexpr Fixed fromRaw(int32_t r) {
+    Fixed f;
+    f.raw = r;
+    return f;
+  }
+
+  constexpr int32_t rawValue() const { return raw; }
+  constexpr float toFloat() const { return raw * (1.0f / ONE); }
+  explicit constexpr operator float() const { return toFloat(); }
+
+  Fixed& operator+=(Fixed o) { raw += o.raw; return *this; }
+  Fixed& operator-=(Fixed o) { raw -= o.raw; return *this; }
+
+  friend constexpr Fixed operator+(Fixed a, Fixed b) { return fromRaw(a.raw + b.raw); }
+  friend constexpr Fixed operator-(Fixed a, Fixed b) { return fromRaw(a.raw - b.raw); }
+  friend constexpr Fixed operator-(Fixed a) { return fromRaw(-a.raw); }
+  friend constexpr Fixed operator*(Fixed a, Fixed b) {
+    return fromRaw((int32_t)(((int64_t)a.raw * b.raw + (ONE >> 1)) >> FracBits));
+  }
+  friend constexpr Fixed operator/(Fixed a, Fixed b) {
+    return fromRaw((int32_t)(((int64_t)a.raw * ONE) / b.raw));
+  }
+  friend constexpr bool operator<(Fixed a, Fixed b) { return a.raw < b.raw; }
+  friend constexpr bool operator>(Fixed a, Fixed b) { return a.raw > b.raw; }
+  friend constexpr bool operator<=(Fixed a, Fixed b) { return a.raw <= b.raw; }
+  friend constexpr bool operator>=(Fixed a, Fixed b) { return a.raw >= b.raw; }
+  friend constexpr bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+  friend constexpr bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+
+private:
+  static constexpr int32_t fromDouble(double v) { return (int32_t)(v * ONE + (v < 0 ? -0.5 : 0.5)); }
+
+  int32_t raw;
+};
+
+// 16.15: +-65536 with 3e-5 resolution
+typedef Fixed<15> Q15;
+
+// atan(x) for table generation. Euler's series converges for any x, about one bit
+// per term at x = 1, so 64 terms is past double precision.
+constexpr double constexprAtan(double x) {
+  double y = x * x / (1 + x * x);
+  double term = x / (1 + x * x);
+  double sum = term;
+  for (int n = 1; n < 64; n++) {
+    term *= y * (2.0 * n) / (2.0 * n + 1);
+    sum += term;
+  }
+  return sum;
+}
+
+// atan(i / N) in degrees for i = 0..N, built by the compiler
+template <size_t N>
+struct AtanTable {
+  float deg[N + 1];
+
+  constexpr AtanTable() : deg() {
+    for (size_t i = 0; i <= N; i++) {
+      deg[i] = (float)(constexprAtan((double)i / N) * 57.29577951308232);
+    }
+  }
+};
+
+// Folds atan2 into the first octant so an approximation only has to cover
+// atan(t) for t in [0, 1], then unfolds the result
+template <typename AtanUnit>
+inline float octantAtan2Deg(float y, float x) {
+  float ay = fabsf(y), ax = fabsf(x);
+  if (ax == 0.0f && ay == 0.0f) {
+    return 0.0f;
+  }
+  bool steep = ay > ax;
+  float a = steep ? 90.0f - AtanUnit::atanDeg(ax / ay) : AtanUnit::atanDeg(ay / ax);
+  if (x < 0.0f) {
+    a = 180.0f - a;
+  }
+  return y < 0.0f ? -a : a;
+}
+
+// Bit-level first guess plus one Newton step, about 0.18% worst case
+inline float fastRsqrt(float x) {
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  bits = 0x5f3759df - (bits >> 1);
+  float r;
+  memcpy(&r, &bits, sizeof(r));
+  return r * (1.5f - 0.5f * x * r * r);
+}
+
+// libm throughout, the reference the others are measured against
+struct FloatMath {
+  typedef float Scalar;
+  static constexpr float ATAN2_MAX_ERROR_DEG = 0.0001f;
+  static constexpr float RSQRT_MAX_REL_ERROR = 0.000001f;
+
+  static float atan2Deg(float y, float x) { return atan2f(y, x) * SENSING_RAD_TO_DEG; }
+  static float rsqrt(float x) { return 1.0f / sqrtf(x); }
+  static float sqrt(float x) { return sqrtf(x); }
+};
+
+// Minimax polynomial atan (Abramowitz & Stegun 4.4.49, 1e-5 rad) and fast rsqrt
+struct PolyMath {
+  typedef float Scalar;
+  static constexpr float ATAN2_MAX_ERROR_DEG = 0.001f;
+  static constexpr float RSQRT_MAX_REL_ERROR = 0.002f;
+
+  static float atanDeg(float t) {
+    float t2 = t * t;
+    return t * (0.9998660f + t2 * (-0.3302995f + t2 * (0.1801410f + t2 * (-0.0851330f + t2 * 0.0208351f)))) *
+           SENSING_RAD_TO_DEG;
+  }
+  static float atan2Deg(float y, float x) { return octantAtan2Deg<PolyMath>(y, x); }
+  static float rsqrt(float x) { return fastRsqrt(x); }
+  static float sqrt(float x) { return x > 0.0f ? x * fastRsqrt(x) : 0.0f; }
+};
+
+// Linear interpolation in a constexpr atan table (0.0003 deg at 128 steps) and fast rsqrt
+struct LutMath {
+  typedef float Scalar;
+  static constexpr size_t ATAN_STEPS = 128;
+  static constexpr float ATAN2_MAX_ERROR_DEG = 0.001f;
+  static constexpr float RSQRT_MAX_REL_ERROR = 0.002f;
+  static constexpr AtanTable<ATAN_STEPS> table = AtanTable<ATAN_STEPS>();
+
+  static float atanDeg(float t) {
+    float pos = t * ATAN_STEPS;
+    size_t i = (size_t)pos;
+    if (i >= ATAN_STEPS) {
+      i = ATAN_STEPS - 1;
+    }
+    return table.deg[i] + (table.deg[i + 1] - table.deg[i]) * (pos - i);
+  }
+  static float atan2Deg(float y, float x) { return octantAtan2Deg<LutMath>(y, x); }
+  static float rsqrt(float x) { return fastRsqrt(x); }
+  static float sqrt(float x) { return x > 0.0f ? x * fastRsqrt(x) : 0.0f; }
+};
+
+// Table trig with the bend detector's window and prefilter in Q15. The ESP32-S3
+// has a single-precision FPU, so the orientation filters stay in float.
+struct Q15Math : LutMath {
+  typedef Q15 Scalar;
+};
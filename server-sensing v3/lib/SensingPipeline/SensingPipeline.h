@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <BendDetector.h>
+#include <OrientationFilter.h>
+
+// The per-sample sensing math, with no hardware behind it, so the firmware and the
+// host replay tool run exactly the same code.
+
+// One raw IMU reading in the units the Adafruit driver reports
+struct ImuReading {
+  float ax, ay, az; // m/s^2
+  float gx, gy, gz; // rad/s
+};
+
+// One IMU reading, already converted to the units the rest of the loop uses
+struct ImuSample {
+  uint32_t micros;
+  float pitch;     // degrees, from the fused orientation estimate
+  float roll;      // degrees
+  float jointRate; // deg/s about the pitch axis
+  float accelY;    // G
+  float gyroY;     // deg/s
+};
+
+// estimate() runs in the sensing task for every IMU read; detect() runs wherever
+// the samples are consumed. The bend window spans 10 s at SampleRateHz. Math picks
+// the detector's number type (see SensingMath.h); the Estimator brings its own
+// trig policy, normally the same one.
+template <uint32_t SampleRateHz, typename Estimator = ComplementaryFilter, typename Math = FloatMath>
+class SensingPipeline {
+public:
+  static const size_t WINDOW_SAMPLES = SampleRateHz * 10;
+  typedef typename Math::Scalar Scalar;
+  typedef BendDetector<Scalar, WINDOW_SAMPLES, Biquad<Scalar> > Detector;
+
+  SensingPipeline(float thresholdMultiplier, float minDifference, uint32_t refractoryMicros,
+                  float filterCutoffHz)
+    : bendDetector(thresholdMultiplier, minDifference, refractoryMicros,
+                   Biquad<Scalar>::lowPass(SampleRateHz, filterCutoffHz)) {}
+
+  ImuSample estimate(const ImuReading& r, uint32_t nowMicros) {
+    float dt = 0;
+    if (lastMicros == 0) {
+      lastMicros = nowMicros;
+    } else {
+      // Signed, so a stamp that lands before the last one can't wrap into a huge
+      // step; a repeated or backwards stamp counts as one nominal period
+      int32_t step = (int32_t)(nowMicros - lastMicros);
+      if (step <= 0) {
+        step = NOMINAL_STEP_MICROS;
+      } else {
+        lastMicros = nowMicros;
+        if (step > MAX_STEP_MICROS) {
+          step = MAX_STEP_MICROS;
+        }
+      }
+      dt = step / 1000000.0f;
+    }
+    estimator.update(r.ax, r.ay, r.az, r.gx, r.gy, r.gz, dt);
+
+    ImuSample sample;
+    sample.micros = nowMicros;
+    sample.pitch = estimator.orientation().pitch;
+    sample.roll = estimator.orientation().roll;
+    sample.jointRate = estimator.orientation().pitchRate;
+    // Calculate angular velocity from gyroscope data (radians to degrees per second conversion)
+    sample.gyroY = r.gy * SENSING_RAD_TO_DEG;
+    // Acceleration data in G's
+    sample.accelY = r.ay * SENSING_INV_G;
+    return sample;
+  }
+
+  // Returns true if this sample completes a bend
+  bool detect(const ImuSample& sample) {
+    return bendDetector.update(Scalar(sample.accelY), sample.micros);
+  }
+
+  Detector& detector() { return bendDetector; }
+  Estimator& orientation() { return estimator; }
+
+  // Call when sampling restarts after a pause so the estimator starts over from the
+  // accelerometer instead of integrating the gap as one huge step. The bend
+  // window is kept.
+  void resume() {
+    estimator.reset();
+    lastMicros = 0;
+  }
+
+  void reset() {
+    estimator.reset();
+    bendDetector.reset();
+    lastMicros = 0;
+  }
+
+private:
+  static const int32_t NOMINAL_STEP_MICROS = 1000000 / SampleRateHz;
+  static const int32_t MAX_STEP_MICROS = 100000; // Longer gaps are integrated as 100 ms
+
+  Estimator estimator;
+  Detector bendDetector;
+  uint32_t lastMicros = 0;
+};
@@ -0,0 +1,94 @@
+#include "TelemetrySink.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+void UpdateWriter::reset() {
+  used = 0;
+  count = 0;
+  overflow = false;
+  finished = false;
+  prefix[0] = '\0';
+  append("{", 1);
+}
+
+void UpdateWriter::child(const char* key) {
+  snprintf(prefix, sizeof(prefix), "%s", key);
+}
+
+void UpdateWriter::append(const char* text, size_t n) {
+  // Keep one byte for the closing brace and one for the terminator
+  if (overflow || used + n + 2 > capacity) {
+    overflow = true;
+    return;
+  }
+  memcpy(buf + used, text, n);
+  used += n;
+}
+
+void UpdateWriter::appendEscaped(const char* text) {
+  for (const char* p = text; *p != '\0'; p++) {
+    unsigned char c = (unsigned char)*p;
+    if (c == '"' || c == '\\') {
+      char escaped[2] = {'\\', (char)c};
+      append(escaped, 2);
+    } else if (c < 0x20) {
+      char escaped[8];
+      int n = snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      append(escaped, (size_t)n);
+    } else {
+      append(p, 1);
+    }
+  }
+}
+
+void UpdateWriter::key(const char* name) {
+  if (count > 0) {
+    append(",", 1);
+  }
+  append("\"", 1);
+  if (prefix[0] != '\0') {
+    appendEscaped(prefix);
+    append("/", 1);
+  }
+  appendEscaped(name);
+  append("\":", 2);
+  count++;
+}
+
+void UpdateWriter::fieldText(const char* name, const char* text) {
+  key(name);
+  append("\"", 1);
+  appendEscaped(text);
+  append("\"", 1);
+}
+
+void UpdateWriter::fieldInt(const char* name, int64_t value) {
+  char text[24];
+  int n = snprintf(text, sizeof(text), "%" PRId64, value);
+  key(name);
+  append(text, (size_t)n);
+}
+
+void UpdateWriter::fieldFloat(const char* name, float value) {
+  char text[24];
+  // JSON has no NaN or infinity
+  int n = value == value && value - value == 0 ? snprintf(text, sizeof(text), "%.6g", value)
+                                               : snprintf(text, sizeof(text), "null");
+  key(name);
+  append(text, (size_t)n);
+}
+
+const char* UpdateWriter::finish() {
+  if (overflow) {
+    return nullptr;
+  }
+  if (!finished) {
+    // append() always leaves room for these two
+    buf[used++] = '}';
+    buf[used] = '\0';
+    finished = true;
+  }
+  return buf;
+}
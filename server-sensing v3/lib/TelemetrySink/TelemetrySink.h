@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Where upload batches go. Every backend takes the same thing: an RTDB-style
+// multi-path update, a JSON object of "child/field": value pairs applied under
+// path, so one batch is one request whichever sink is active. begin() and update()
+// run in the cloud task and may block for one request each.
+class TelemetrySink {
+public:
+  virtual ~TelemetrySink() {}
+
+  virtual const char* name() const = 0;
+  // Connects or signs in; returns false to retry later
+  virtual bool begin() = 0;
+  virtual bool ready() = 0;
+  virtual bool update(const char* path, const char* body, size_t length) = 0;
+  // Why the last update failed, for the log
+  virtual const char* lastError() = 0;
+};
+
+// Running totals for whichever sink is active, printed with the status line
+struct SinkStats {
+  uint32_t requests = 0;
+  uint32_t failures = 0;
+  uint32_t bytes = 0;  // Bodies of successful requests
+  uint32_t fields = 0;
+  uint32_t maxLatencyMs = 0;
+
+  void record(bool ok, size_t length, size_t fieldCount, uint32_t latencyMs) {
+    requests++;
+    if (!ok) {
+      failures++;
+    } else {
+      bytes += length;
+      fields += fieldCount;
+    }
+    if (latencyMs > maxLatencyMs) {
+      maxLatencyMs = latencyMs;
+    }
+  }
+};
+
+// Writes a multi-path update into a fixed buffer, no heap. Fields go under the
+// current child: child("123_000001") then fieldFloat("pitch", 1.5f) gives
+// "123_000001/pitch":1.5. finish() returns the body, or nullptr if it didn't fit.
+// No Arduino dependencies; the host load generator builds the same bodies.
+class UpdateWriter {
+public:
+  UpdateWriter(char* buf, size_t capacity) : buf(buf), capacity(capacity) { reset(); }
+
+  void reset();
+  void child(const char* key);
+  void fieldText(const char* name, const char* text);
+  void fieldInt(const char* name, int64_t value);
+  void fieldFloat(const char* name, float value);
+  const char* finish();
+
+  size_t length() const { return used; }
+  size_t fields() const { return count; }
+  // Room left for fields; callers check before each row and send early when short
+  size_t remaining() const { return used + 2 < capacity ? capacity - used - 2 : 0; }
+  bool overflowed() const { return overflow; }
+
+private:
+  void key(const char* name);
+  void append(const char* text, size_t n);
+  void appendEscaped(const char* text);
+
+  char* buf;
+  size_t capacity;
+  size_t used = 0;
+  size_t count = 0;
+  bool overflow = false;
+  bool finished = false;
+  char prefix[40];
+};
@@ -0,0 +1,94 @@
+#include "Timebase.h"
+
+int64_t Timebase::map(const Mapping& m, uint64_t localMicros) {
+  int64_t elapsed = (int64_t)(localMicros - m.localAnchor);
+  int64_t slewed = 0;
+  if (m.slewPpb != 0) {
+    uint64_t slewEnd = localMicros < m.slewUntil ? localMicros : m.slewUntil;
+    slewed = (int64_t)(slewEnd - m.localAnchor) * m.slewPpb / 1000000000LL;
+  }
+  return m.epochAnchor + elapsed + elapsed * m.driftPpb / 1000000000LL + slewed;
+}
+
+uint64_t Timebase::epochMicros(uint64_t localMicros) const {
+  Mapping m;
+  uint32_t before, after;
+  do {
+    before = version.load(std::memory_order_acquire);
+    if (before == 0) {
+      return 0;
+    }
+    m = mapping;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = version.load(std::memory_order_relaxed);
+  } while ((before & 1) != 0 || before != after);
+  int64_t epoch = map(m, localMicros);
+  return epoch > 0 ? (uint64_t)epoch : 0;
+}
+
+void Timebase::sync(uint64_t localMicros, uint64_t epochMicros) {
+  Mapping next = mapping;
+  uint32_t v = version.load(std::memory_order_relaxed);
+  syncs++;
+
+  if (v == 0) {
+    next = {localMicros, (int64_t)epochMicros, 0, 0, 0};
+    lastError = 0;
+  } else {
+    // Re-anchor where the mapping is now so the output stays continuous, then
+    // work the error off from there
+    int64_t predicted = map(mapping, localMicros);
+    int64_t error = (int64_t)epochMicros - predicted;
+    lastError = error;
+    next.localAnchor = localMicros;
+    next.epochAnchor = predicted;
+    next.slewPpb = 0;
+    next.slewUntil = localMicros;
+
+    if (error > TIMEBASE_STEP_MICROS || error < -TIMEBASE_STEP_MICROS) {
+      next.epochAnchor = (int64_t)epochMicros;
+      steps++;
+    } else {
+      // Drift comes straight from how far the reference moved against the local
+      // clock since the last sync, so the offset correction can't feed back into
+      // it: taken whole the first time, then averaged in a quarter at a time
+      uint64_t interval = localMicros - lastSyncLocal;
+      if (interval >= TIMEBASE_MIN_DRIFT_INTERVAL_US) {
+        int64_t moved = (int64_t)(epochMicros - lastSyncEpoch);
+        int64_t measured = (moved - (int64_t)interval) * 1000000000LL / (int64_t)interval;
+        int64_t drift = driftMeasured ? next.driftPpb + (measured - next.driftPpb) / 4 : measured;
+        if (drift > TIMEBASE_MAX_DRIFT_PPB) drift = TIMEBASE_MAX_DRIFT_PPB;
+        if (drift < -TIMEBASE_MAX_DRIFT_PPB) drift = -TIMEBASE_MAX_DRIFT_PPB;
+        next.driftPpb = (int32_t)drift;
+        driftMeasured = true;
+      }
+      // Slew out half the offset; the other half is as likely to be jitter in this
+      // answer and comes back next time if it was real
+      error /= 2;
+      if (error != 0) {
+        next.slewPpb = error > 0 ? TIMEBASE_MAX_SLEW_PPB : -TIMEBASE_MAX_SLEW_PPB;
+        int64_t magnitude = error > 0 ? error : -error;
+        next.slewUntil = localMicros + (uint64_t)(magnitude * 1000000000LL / TIMEBASE_MAX_SLEW_PPB);
+      }
+    }
+  }
+  lastSyncLocal = localMicros;
+  lastSyncEpoch = epochMicros;
+
+  // Odd while writing; readers retry until they see the same even value twice
+  version.store(v + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  mapping = next;
+  version.store(v + 2, std::memory_order_release);
+}
+
+void Timebase::reset() {
+  version.store(0, std::memory_order_release);
+  mapping = {0, 0, 0, 0, 0};
+  lastSyncLocal = 0;
+  lastSyncEpoch = 0;
+  driftMeasured = false;
+  lastError = 0;
+  syncs = 0;
+  steps = 0;
+}
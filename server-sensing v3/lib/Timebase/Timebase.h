@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// Maps the local monotonic microsecond clock (esp_timer) to epoch microseconds.
+// Each sync() pairs a reference time (an NTP update) with the local clock at that
+// moment. Small errors are slewed out by running the mapping slightly fast or
+// slow, so it never jumps and never goes backwards, and the rate of the local
+// oscillator against the reference is tracked between syncs. Errors beyond
+// TIMEBASE_STEP_MICROS are stepped instead.
+//
+// One writer (sync) and any number of readers on other tasks: the mapping is read
+// under a sequence counter, so epochMicros() never blocks and never sees half an
+// update. No Arduino dependencies, so it runs on the host.
+
+#define TIMEBASE_STEP_MICROS 500000LL      // Larger errors are stepped, not slewed
+#define TIMEBASE_MAX_SLEW_PPB 500000       // 500 ppm, like adjtime()
+#define TIMEBASE_MAX_DRIFT_PPB 200000      // Well past any crystal, keeps a bad sample bounded
+#define TIMEBASE_MIN_DRIFT_INTERVAL_US 60000000ULL // Shorter gaps are mostly NTP jitter
+
+class Timebase {
+public:
+  // The reference read epochMicros at local time localMicros
+  void sync(uint64_t localMicros, uint64_t epochMicros);
+  bool synced() const { return version.load(std::memory_order_acquire) != 0; }
+  void reset();
+
+  // Epoch microseconds at localMicros, 0 before the first sync
+  uint64_t epochMicros(uint64_t localMicros) const;
+
+  int32_t driftPpb() const { return mapping.driftPpb; }
+  int64_t lastErrorMicros() const { return lastError; } // Reference minus mapping at the last sync
+  uint32_t syncCount() const { return syncs; }
+  uint32_t stepCount() const { return steps; }
+
+private:
+  struct Mapping {
+    uint64_t localAnchor;
+    int64_t epochAnchor;
+    int32_t driftPpb;    // Local clock rate correction
+    int32_t slewPpb;     // Extra rate while an offset is worked off
+    uint64_t slewUntil;  // Local time the slew ends
+  };
+
+  static int64_t map(const Mapping& m, uint64_t localMicros);
+
+  Mapping mapping = {0, 0, 0, 0, 0};
+  // Odd while the writer is updating the mapping, 0 until the first sync
+  std::atomic<uint32_t> version{0};
+  uint64_t lastSyncLocal = 0;
+  uint64_t lastSyncEpoch = 0;
+  bool driftMeasured = false;
+  int64_t lastError = 0;
+  uint32_t syncs = 0;
+  uint32_t steps = 0;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Collects items for upload and says when a batch is ready: either batchSize items
+// are waiting, or the oldest one has waited flushDeadlineMs. Storage is a fixed
+// array, so the batch can be sent in one request without any allocation.
+template <typename T, size_t Capacity>
+class UploadBatcher {
+public:
+  static_assert(Capacity > 0, "batch capacity must be non-zero");
+
+  UploadBatcher(size_t batchSize = Capacity, uint32_t flushDeadlineMs = 5000)
+    : targetSize(clampSize(batchSize)), deadlineMs(flushDeadlineMs) {}
+
+  // Adds an item. Returns false, and counts a drop, if the buffer is already full
+  // (for example because earlier uploads keep failing).
+  bool add(const T& item, uint32_t nowMs) {
+    if (count >= Capacity) {
+      dropped++;
+      return false;
+    }
+    if (count == 0) {
+      firstAddedMs = nowMs;
+    }
+    items[count++] = item;
+    return true;
+  }
+
+  bool shouldFlush(uint32_t nowMs) const {
+    if (count == 0) {
+      return false;
+    }
+    return count >= targetSize || nowMs - firstAddedMs >= deadlineMs;
+  }
+
+  // Call after a successful upload of the current batch.
+  void markSent() {
+    batches++;
+    itemsSent += count;
+    count = 0;
+  }
+
+  // Empties the batch without counting it as sent (e.g. after moving it elsewhere).
+  void clear() { count = 0; }
+
+  // Removes the first n items, e.g. the part of a batch that was moved elsewhere
+  // before a failure, and keeps the rest in order.
+  void removeFirst(size_t n) {
+    if (n >= count) {
+      count = 0;
+      return;
+    }
+    for (size_t i = n; i < count; i++) {
+      items[i - n] = items[i];
+    }
+    count -= n;
+  }
+
+  void setBatchSize(size_t n) { targetSize = clampSize(n); }
+  void setFlushDeadline(uint32_t ms) { deadlineMs = ms; }
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  bool full() const { return count >= Capacity; }
+  const T& operator[](size_t i) const { return items[i]; }
+  size_t batchSize() const { return targetSize; }
+
+  uint32_t batchesSent() const { return batches; }
+  uint32_t totalSent() const { return itemsSent; }
+  uint32_t droppedCount() const { return dropped; }
+
+private:
+  static size_t clampSize(size_t n) { return n == 0 ? 1 : (n > Capacity ? Capacity : n); }
+
+  T items[Capacity];
+  size_t count = 0;
+  size_t targetSize;
+  uint32_t deadlineMs;
+  uint32_t firstAddedMs = 0;
+  uint32_t batches = 0;
+  uint32_t itemsSent = 0;
+  uint32_t dropped = 0;
+};
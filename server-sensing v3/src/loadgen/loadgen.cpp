@@ -0,0 +1,415 @@
+// Simulates a fleet of sensing nodes uploading to an RTDB-style HTTP endpoint,
+// normally the mockrtdb tool, to measure ingest latency, batching efficiency and
+// where the backend stops scaling.
+// Built by the `loadgen` environment:  pio run -e loadgen
+// then:  .pio/build/loadgen/program [options]
+//
+//   --host 127.0.0.1 --port 8080   endpoint
+//   --nodes 20                     simulated devices, one thread and connection each
+//   --seconds 30                   run time (wall clock)
+//   --rate 20                      samples per second per node (UPLOAD_SAMPLE_RATE_HZ)
+//   --batch 50                     samples per batch (UPLOAD_BATCH_SIZE)
+//   --interval-ms 5000             longest a sample waits before its batch goes
+//   --format packed|json           SeriesCodec blocks under test/packed, or JSON rows under test/data2
+//   --speedup 1                    runs node time this many times faster than real time
+//
+// Bodies are built with the firmware's UpdateWriter and SeriesEncoder and split at
+// the same UPLOAD_BODY_BYTES, so bytes per row match what a device sends. Prints
+// request latency percentiles, rows per request and bytes per row; exits with 1
+// if any request failed. POSIX sockets only.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <SeriesCodec.h>
+#include <TelemetrySink.h>
+
+// Firmware values, see main.cpp
+#define UPLOAD_BODY_BYTES 12288
+#define UPLOAD_ROW_MAX_BYTES 512
+#define UPLOAD_DROP_MANTISSA_BITS 10
+
+struct Options {
+  const char* host = "127.0.0.1";
+  const char* port = "8080";
+  int nodes = 20;
+  double seconds = 30;
+  double rate = 20;
+  int batch = 50;
+  int intervalMs = 5000;
+  bool packed = true;
+  double speedup = 1;
+};
+
+static Options options;
+
+struct Totals {
+  std::mutex lock;
+  std::vector<uint32_t> latencyMicros; // Successful requests
+  unsigned long requests = 0, failures = 0, rows = 0, reconnects = 0;
+  unsigned long long bytes = 0;
+};
+
+static Totals totals;
+
+struct Sample {
+  uint64_t epochMicros;
+  uint32_t seq;
+  float pitch;
+  float gyroY;
+  uint32_t bendCount;
+};
+
+// One keep-alive HTTP/1.1 connection
+class HttpConnection {
+public:
+  ~HttpConnection() { disconnect(); }
+
+  bool patch(const std::string& target, const char* body, size_t length, int& status) {
+    if (fd < 0 && !connect()) {
+      return false;
+    }
+    char header[256];
+    int n = snprintf(header, sizeof(header),
+                     "PATCH %s HTTP/1.1\r\nHost: %s\r\nContent-Type: application/json\r\n"
+                     "Content-Length: %zu\r\n\r\n",
+                     target.c_str(), options.host, length);
+    if (!sendAll(header, (size_t)n) || !sendAll(body, length) || !readResponse(status)) {
+      disconnect();
+      return false;
+    }
+    return true;
+  }
+
+  unsigned long connects = 0;
+
+private:
+  bool connect() {
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(options.host, options.port, &hints, &found) != 0) {
+      return false;
+    }
+    for (addrinfo* a = found; a != nullptr && fd < 0; a = a->ai_next) {
+      fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+      if (fd >= 0 && ::connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+      }
+    }
+    freeaddrinfo(found);
+    if (fd < 0) {
+      return false;
+    }
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    connects++;
+    return true;
+  }
+
+  void disconnect() {
+    if (fd >= 0) {
+      close(fd);
+      fd = -1;
+    }
+    in.clear();
+  }
+
+  bool sendAll(const char* data, size_t length) {
+    while (length > 0) {
+      ssize_t n = send(fd, data, length, MSG_NOSIGNAL);
+      if (n <= 0) {
+        return false;
+      }
+      data += n;
+      length -= (size_t)n;
+    }
+    return true;
+  }
+
+  bool readResponse(int& status) {
+    char chunk[4096];
+    size_t headerEnd;
+    while ((headerEnd = in.find("\r\n\r\n")) == std::string::npos) {
+      ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+      if (n <= 0) {
+        return false;
+      }
+      in.append(chunk, (size_t)n);
+    }
+    status = 0;
+    sscanf(in.c_str(), "HTTP/%*s %d", &status);
+    size_t contentLength = 0;
+    const char* field = strcasestr(in.c_str(), "\r\ncontent-length:");
+    if (field != nullptr && (size_t)(field - in.c_str()) < headerEnd) {
+      contentLength = strtoul(field + 17, nullptr, 10);
+    }
+    bool close = false;
+    const char* connection = strcasestr(in.c_str(), "\r\nconnection: close");
+    if (connection != nullptr && (size_t)(connection - in.c_str()) < headerEnd) {
+      close = true;
+    }
+    size_t total = headerEnd + 4 + contentLength;
+    while (in.size() < total) {
+      ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+      if (n <= 0) {
+        return false;
+      }
+      in.append(chunk, (size_t)n);
+    }
+    in.erase(0, total);
+    if (close) {
+      disconnect();
+    }
+    return true;
+  }
+
+  int fd = -1;
+  std::string in;
+};
+
+// One simulated device: records samples in node time, batches them like the
+// firmware's UploadBatcher and uploads each batch as multi-path updates
+class Node {
+public:
+  explicit Node(uint32_t id) : bootId(0x10000000u + id), encoder(UPLOAD_DROP_MANTISSA_BITS), writer(body, sizeof(body)) {
+    phase = id * 0.37;
+  }
+
+  void run(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    std::vector<Sample> batch;
+    double samplePeriodS = 1.0 / options.rate;
+    double nodeSeconds = 0;
+    double batchOpenedAt = 0;
+    // Nodes start spread over one interval, like devices that didn't boot together
+    double nextSampleAt = (options.intervalMs / 1000.0) * (phase - floor(phase));
+
+    while (true) {
+      // Advance to whichever comes first: the next sample or the batch deadline
+      double deadline = batch.empty() ? 1e30 : batchOpenedAt + options.intervalMs / 1000.0;
+      nodeSeconds = std::min(nextSampleAt, deadline);
+      auto wake = start + std::chrono::microseconds((int64_t)(nodeSeconds / options.speedup * 1e6));
+      if (wake >= end) {
+        break;
+      }
+      std::this_thread::sleep_until(wake);
+
+      if (nodeSeconds >= nextSampleAt) {
+        if (batch.empty()) {
+          batchOpenedAt = nodeSeconds;
+        }
+        batch.push_back(sample(nodeSeconds));
+        nextSampleAt += samplePeriodS;
+      }
+      if ((int)batch.size() >= options.batch || (!batch.empty() && nodeSeconds >= deadline)) {
+        // Failed batches are dropped rather than retried, so every row is counted once
+        upload(batch);
+        batch.clear();
+      }
+    }
+    std::lock_guard<std::mutex> lock(totals.lock);
+    totals.reconnects += connection.connects > 0 ? connection.connects - 1 : 0;
+  }
+
+private:
+  Sample sample(double t) {
+    // A slow flex-extend cycle with a bend counted at each peak
+    double cycle = 0.25 * t + phase;
+    Sample s;
+    s.epochMicros = 1700000000000000ULL + (uint64_t)(t * 1e6);
+    s.seq = seq++;
+    s.pitch = (float)(45 + 40 * sin(2 * M_PI * cycle));
+    s.gyroY = (float)(40 * 2 * M_PI * 0.25 * cos(2 * M_PI * cycle));
+    s.bendCount = (uint32_t)(cycle + 0.75);
+    return s;
+  }
+
+  void setChild(const Sample& s) {
+    char key[32];
+    snprintf(key, sizeof(key), "%lu_%06lu", (unsigned long)(s.epochMicros / 1000000), (unsigned long)s.seq);
+    writer.child(key);
+  }
+
+  // Sends the body early if fewer than bytes are left, as the firmware does
+  bool makeRoom(const char* path, size_t bytes) {
+    if (writer.remaining() >= bytes || writer.fields() == 0) {
+      return true;
+    }
+    return send(path);
+  }
+
+  bool send(const char* path) {
+    const char* text = writer.finish();
+    size_t length = writer.length();
+    writer.reset();
+    if (text == nullptr) {
+      return false;
+    }
+    std::string target = std::string("/") + path + ".json";
+    auto start = std::chrono::steady_clock::now();
+    int status = 0;
+    bool ok = connection.patch(target, text, length, status) && status == 200;
+    uint32_t micros = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(totals.lock);
+    totals.requests++;
+    if (ok) {
+      totals.latencyMicros.push_back(micros);
+      totals.bytes += length;
+    } else {
+      totals.failures++;
+    }
+    return ok;
+  }
+
+  void upload(const std::vector<Sample>& batch) {
+    const char* path = options.packed ? "test/packed" : "test/data2";
+    writer.reset();
+    if (options.packed) {
+      size_t i = 0;
+      while (i < batch.size()) {
+        const Sample& first = batch[i];
+        encoder.begin(bootId, first.epochMicros);
+        while (i < batch.size()) {
+          const Sample& s = batch[i];
+          SeriesRow row = {(uint32_t)(s.epochMicros / 1000), s.seq, s.pitch, s.gyroY, s.bendCount};
+          if (!encoder.add(row)) {
+            break;
+          }
+          i++;
+        }
+        size_t length = encoder.finish(block, sizeof(block));
+        size_t textLength = base64Encode(block, length, blockText, sizeof(blockText));
+        if (!makeRoom(path, textLength + 64)) {
+          return;
+        }
+        setChild(first);
+        writer.fieldText("b", blockText);
+        writer.fieldInt("n", encoder.count());
+      }
+    } else {
+      for (const Sample& s : batch) {
+        if (!makeRoom(path, UPLOAD_ROW_MAX_BYTES)) {
+          return;
+        }
+        setChild(s);
+        writer.fieldFloat("pitch", s.pitch);
+        writer.fieldInt("bendCount", s.bendCount);
+        writer.fieldFloat("gyroY", s.gyroY);
+        writer.fieldInt("timestamp", s.epochMicros / 1000000);
+        writer.fieldInt("usec", s.epochMicros % 1000000);
+      }
+    }
+    if (send(path)) {
+      std::lock_guard<std::mutex> lock(totals.lock);
+      totals.rows += batch.size();
+    }
+  }
+
+  uint32_t bootId;
+  uint32_t seq = 0;
+  double phase;
+  SeriesEncoder encoder;
+  uint8_t block[SERIES_MAX_BLOCK_BYTES];
+  char blockText[(SERIES_MAX_BLOCK_BYTES + 2) / 3 * 4 + 1];
+  char body[UPLOAD_BODY_BYTES];
+  UpdateWriter writer;
+  HttpConnection connection;
+};
+
+static void usage() {
+  fprintf(stderr,
+          "usage: loadgen [--host H] [--port P] [--nodes N] [--seconds S] [--rate HZ] [--batch N]\n"
+          "               [--interval-ms MS] [--format packed|json] [--speedup X]\n");
+}
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (i + 1 >= argc) {
+      usage();
+      return 2;
+    }
+    const char* value = argv[++i];
+    if (strcmp(arg, "--host") == 0) {
+      options.host = value;
+    } else if (strcmp(arg, "--port") == 0) {
+      options.port = value;
+    } else if (strcmp(arg, "--nodes") == 0) {
+      options.nodes = atoi(value);
+    } else if (strcmp(arg, "--seconds") == 0) {
+      options.seconds = atof(value);
+    } else if (strcmp(arg, "--rate") == 0) {
+      options.rate = atof(value);
+    } else if (strcmp(arg, "--batch") == 0) {
+      options.batch = atoi(value);
+    } else if (strcmp(arg, "--interval-ms") == 0) {
+      options.intervalMs = atoi(value);
+    } else if (strcmp(arg, "--format") == 0 && (strcmp(value, "packed") == 0 || strcmp(value, "json") == 0)) {
+      options.packed = strcmp(value, "packed") == 0;
+    } else if (strcmp(arg, "--speedup") == 0) {
+      options.speedup = atof(value);
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (options.nodes < 1 || options.rate <= 0 || options.batch < 1 || options.speedup <= 0) {
+    usage();
+    return 2;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  printf("%d node(s) at %.0f Hz, batches of %d or %d ms, %s, %.1fx for %.0f s against %s:%s\n", options.nodes,
+         options.rate, options.batch, options.intervalMs, options.packed ? "packed" : "json", options.speedup,
+         options.seconds, options.host, options.port);
+
+  std::vector<Node*> nodes;
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  auto end = start + std::chrono::microseconds((int64_t)(options.seconds * 1e6));
+  for (int i = 0; i < options.nodes; i++) {
+    nodes.push_back(new Node((uint32_t)i));
+  }
+  for (Node* node : nodes) {
+    threads.emplace_back(&Node::run, node, start, end);
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  for (Node* node : nodes) {
+    delete node;
+  }
+
+  std::vector<uint32_t>& lat = totals.latencyMicros;
+  std::sort(lat.begin(), lat.end());
+  auto pctMs = [&](double p) { return lat.empty() ? 0.0 : lat[(size_t)(p * (lat.size() - 1))] / 1000.0; };
+  printf("requests: %lu ok, %lu failed, %lu reconnect(s), %.1f req/s\n", totals.requests - totals.failures,
+         totals.failures, totals.reconnects, totals.requests / elapsed);
+  printf("rows: %lu uploaded, %.1f rows/s, %.1f rows/request, %.1f bytes/row\n", totals.rows,
+         totals.rows / elapsed, lat.empty() ? 0.0 : (double)totals.rows / lat.size(),
+         totals.rows == 0 ? 0.0 : (double)totals.bytes / totals.rows);
+  printf("latency ms: p50 %.2f, p90 %.2f, p99 %.2f, max %.2f\n", pctMs(0.5), pctMs(0.9), pctMs(0.99),
+         lat.empty() ? 0.0 : lat.back() / 1000.0);
+  return totals.failures > 0 ? 1 : 0;
+}
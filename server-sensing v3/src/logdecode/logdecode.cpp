@@ -0,0 +1,126 @@
+// Turns a serial capture with binary DeferredLog frames back into text. Works for
+// both the server and the display, and passes plain text through untouched, so
+// boot messages and serial command output stay readable.
+// Built by the `logdecode` environment:  pio run -e logdecode
+// then, e.g.:  stty -F /dev/ttyACM0 115200 raw && .pio/build/logdecode/program < /dev/ttyACM0
+//          or: .pio/build/logdecode/program capture.bin
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include <DeferredLog.h>
+
+static std::map<uint32_t, std::string> formats;
+static unsigned long frameCount = 0, badFrames = 0, unknownFormats = 0;
+
+static uint32_t readU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void handleFrame(uint8_t type, const uint8_t* payload, size_t len) {
+  if (len < 4) {
+    return;
+  }
+  uint32_t id = readU32(payload);
+  if (type == LOG_FRAME_FORMAT) {
+    formats[id] = std::string((const char*)payload + 4, len - 4);
+    return;
+  }
+  if (type != LOG_FRAME_RECORD || len < LOG_RECORD_HEADER_BYTES) {
+    return;
+  }
+
+  uint32_t micros = readU32(payload + 4);
+  uint8_t level = payload[8];
+  printf("[%lu.%06lu %c] ", (unsigned long)(micros / 1000000), (unsigned long)(micros % 1000000),
+         logLevelLetter(level));
+  auto it = formats.find(id);
+  if (it == formats.end()) {
+    // Started mid-stream; the device resends formats every LOG_FORMAT_RESEND_RECORDS
+    unknownFormats++;
+    printf("<format %08lx not seen yet, %u argument bytes>\n", (unsigned long)id,
+           (unsigned)(len - LOG_RECORD_HEADER_BYTES));
+    return;
+  }
+  char text[512];
+  formatLogRecord(it->second.c_str(), payload + LOG_RECORD_HEADER_BYTES, len - LOG_RECORD_HEADER_BYTES,
+                  text, sizeof(text));
+  printf("%s\n", text);
+}
+
+// Consumes what it can from buf and returns how many bytes were used. A partial
+// frame at the end is left for the next read.
+static size_t decode(const uint8_t* buf, size_t len, bool final) {
+  size_t i = 0;
+  while (i < len) {
+    if (buf[i] != LOG_SYNC0) {
+      uint8_t c = buf[i++];
+      if (c == '\n' || c == '\t' || (c >= 0x20 && c < 0x7f)) {
+        putchar(c);
+      }
+      continue;
+    }
+    if (len - i < LOG_FRAME_HEADER_BYTES) {
+      if (!final) {
+        break;
+      }
+      i++;
+      continue;
+    }
+    size_t payloadLen = buf[i + 3];
+    size_t frameLen = LOG_FRAME_OVERHEAD + payloadLen;
+    if (buf[i + 1] != LOG_SYNC1) {
+      i++;
+      continue;
+    }
+    if (len - i < frameLen) {
+      if (!final) {
+        break;
+      }
+      i++;
+      continue;
+    }
+    if (logCrc8(buf + i + 2, 2 + payloadLen) != buf[i + frameLen - 1]) {
+      badFrames++;
+      i++; // Not a real frame, or corrupted; resync on the next byte
+      continue;
+    }
+    frameCount++;
+    handleFrame(buf[i + 2], buf + i + LOG_FRAME_HEADER_BYTES, payloadLen);
+    i += frameLen;
+  }
+  return i;
+}
+
+int main(int argc, char** argv) {
+  FILE* in = stdin;
+  if (argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+    fprintf(stderr, "usage: logdecode [capture.bin]   (reads stdin without a file)\n");
+    return 2;
+  }
+  if (argc == 2 && (in = fopen(argv[1], "rb")) == nullptr) {
+    fprintf(stderr, "can't read %s\n", argv[1]);
+    return 1;
+  }
+
+  uint8_t buf[8192];
+  size_t have = 0;
+  size_t n;
+  while ((n = fread(buf + have, 1, sizeof(buf) - have, in)) > 0) {
+    have += n;
+    size_t used = decode(buf, have, false);
+    memmove(buf, buf + used, have - used);
+    have -= used;
+    fflush(stdout);
+  }
+  decode(buf, have, true);
+
+  fprintf(stderr, "%lu frames, %lu bad, %lu records with unknown format\n", frameCount, badFrames,
+          unknownFormats);
+  if (in != stdin) {
+    fclose(in);
+  }
+  return 0;
+}
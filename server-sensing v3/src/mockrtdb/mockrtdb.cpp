@@ -0,0 +1,520 @@
+// Local stand-in for the Firebase RTDB REST API, so uploads can be benchmarked
+// without the cloud. Point the firmware's HTTP sink (TELEMETRY_HTTP_URL, or
+// "sink http" on the serial port) or the loadgen tool at it.
+// Built by the `mockrtdb` environment:  pio run -e mockrtdb
+// then:  .pio/build/mockrtdb/program [--port 8080] [--delay-ms N] [--fail-every N] [--discard]
+//
+// Speaks HTTP/1.1 with keep-alive, one thread per connection:
+//   PATCH <path>.json   multi-path update, each "child/field" key is set under path
+//   PUT   <path>.json   replaces everything under path
+//   POST  <path>.json   adds the body under a new generated key
+//   GET   <path>.json   everything stored under path, flattened
+//   GET   /.stats       request, byte and latency totals as JSON
+// --delay-ms holds every write that long before answering, --fail-every N answers
+// every Nth write with 503 and --discard parses bodies without storing them.
+// Throughput and handling latency are printed to stderr every 5 s.
+// POSIX sockets only.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define REPORT_INTERVAL_S 5
+#define MAX_BODY_BYTES (4 * 1024 * 1024)
+
+struct Options {
+  int port = 8080;
+  int delayMs = 0;
+  int failEvery = 0;
+  bool discard = false;
+};
+
+static Options options;
+
+// The database, flattened: "test/packed/123_000001/b" -> raw JSON value
+static std::map<std::string, std::string> store;
+static std::mutex storeLock;
+
+// Totals since start, and handling times since the last report
+static std::mutex statsLock;
+static unsigned long totalRequests = 0, totalWrites = 0, totalFailures = 0, totalFields = 0;
+static unsigned long long totalBytes = 0;
+static std::vector<uint32_t> intervalMicros;
+static unsigned long intervalRequests = 0, intervalFields = 0;
+static unsigned long long intervalBytes = 0;
+static std::atomic<unsigned long> writeCounter{0};
+static std::atomic<int> openConnections{0};
+
+static double nowSeconds() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Minimal JSON reader: enough to split an update into "path" -> value pairs.
+// Objects are flattened, anything else is kept as its raw text.
+class JsonFlattener {
+public:
+  JsonFlattener(const std::string& text, std::vector<std::pair<std::string, std::string>>& out)
+      : text(text), out(out) {}
+
+  bool parse(const std::string& root) {
+    pos = 0;
+    skipSpace();
+    if (!value(root)) {
+      return false;
+    }
+    skipSpace();
+    return pos == text.size();
+  }
+
+private:
+  void skipSpace() {
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n')) {
+      pos++;
+    }
+  }
+
+  bool string(std::string& result) {
+    if (pos >= text.size() || text[pos] != '"') {
+      return false;
+    }
+    pos++;
+    result.clear();
+    while (pos < text.size() && text[pos] != '"') {
+      if (text[pos] == '\\') {
+        if (++pos >= text.size()) {
+          return false;
+        }
+        char c = text[pos];
+        if (c == 'u') {
+          // Keys and values we write only escape control characters
+          if (pos + 4 >= text.size()) {
+            return false;
+          }
+          result += (char)strtol(text.substr(pos + 1, 4).c_str(), nullptr, 16);
+          pos += 5;
+          continue;
+        }
+        result += c == 'n' ? '\n' : c == 't' ? '\t' : c == 'r' ? '\r' : c == 'b' ? '\b' : c == 'f' ? '\f' : c;
+      } else {
+        result += text[pos];
+      }
+      pos++;
+    }
+    if (pos >= text.size()) {
+      return false;
+    }
+    pos++;
+    return true;
+  }
+
+  // Skips a scalar or array, leaving pos after it
+  bool raw() {
+    if (pos >= text.size()) {
+      return false;
+    }
+    if (text[pos] == '"') {
+      std::string ignored;
+      return string(ignored);
+    }
+    if (text[pos] == '[' || text[pos] == '{') {
+      int depth = 0;
+      bool inString = false;
+      for (; pos < text.size(); pos++) {
+        char c = text[pos];
+        if (inString) {
+          if (c == '\\') pos++;
+          else if (c == '"') inString = false;
+        } else if (c == '"') {
+          inString = true;
+        } else if (c == '[' || c == '{') {
+          depth++;
+        } else if ((c == ']' || c == '}') && --depth == 0) {
+          pos++;
+          return true;
+        }
+      }
+      return false;
+    }
+    size_t start = pos;
+    while (pos < text.size() && strchr(",}] \t\r\n", text[pos]) == nullptr) {
+      pos++;
+    }
+    return pos > start;
+  }
+
+  bool value(const std::string& path) {
+    if (pos < text.size() && text[pos] == '{') {
+      pos++;
+      skipSpace();
+      if (pos < text.size() && text[pos] == '}') {
+        pos++;
+        return true;
+      }
+      while (true) {
+        std::string key;
+        skipSpace();
+        if (!string(key)) {
+          return false;
+        }
+        skipSpace();
+        if (pos >= text.size() || text[pos] != ':') {
+          return false;
+        }
+        pos++;
+        skipSpace();
+        if (!value(path.empty() ? key : path + "/" + key)) {
+          return false;
+        }
+        skipSpace();
+        if (pos < text.size() && text[pos] == ',') {
+          pos++;
+          continue;
+        }
+        if (pos < text.size() && text[pos] == '}') {
+          pos++;
+          return true;
+        }
+        return false;
+      }
+    }
+    size_t start = pos;
+    if (!raw()) {
+      return false;
+    }
+    out.emplace_back(path, text.substr(start, pos - start));
+    return true;
+  }
+
+  const std::string& text;
+  std::vector<std::pair<std::string, std::string>>& out;
+  size_t pos = 0;
+};
+
+static void eraseUnder(const std::string& path) {
+  auto it = store.lower_bound(path);
+  while (it != store.end() && it->first.compare(0, path.size(), path) == 0 &&
+         (it->first.size() == path.size() || it->first[path.size()] == '/')) {
+    it = store.erase(it);
+  }
+}
+
+static std::string jsonEscape(const std::string& text) {
+  std::string out;
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+    }
+    out += c;
+  }
+  return out;
+}
+
+static std::string statsJson() {
+  std::lock_guard<std::mutex> lock(statsLock);
+  size_t keys;
+  {
+    std::lock_guard<std::mutex> storeGuard(storeLock);
+    keys = store.size();
+  }
+  char text[256];
+  snprintf(text, sizeof(text),
+           "{\"requests\":%lu,\"writes\":%lu,\"failures\":%lu,\"fields\":%lu,\"bytes\":%llu,\"keys\":%zu,"
+           "\"connections\":%d}",
+           totalRequests, totalWrites, totalFailures, totalFields, totalBytes, keys, openConnections.load());
+  return text;
+}
+
+// "/test/packed.json?auth=x" -> "test/packed"
+static std::string dbPath(std::string target) {
+  size_t query = target.find('?');
+  if (query != std::string::npos) {
+    target.resize(query);
+  }
+  if (target.size() >= 5 && target.compare(target.size() - 5, 5, ".json") == 0) {
+    target.resize(target.size() - 5);
+  }
+  size_t start = target.find_first_not_of('/');
+  size_t end = target.find_last_not_of('/');
+  return start == std::string::npos ? "" : target.substr(start, end - start + 1);
+}
+
+// Applies one request, fills in the status and response body
+static int handle(const std::string& method, const std::string& target, const std::string& body,
+                  std::string& response, size_t& fieldCount) {
+  fieldCount = 0;
+  if (method == "GET") {
+    if (target == "/.stats") {
+      response = statsJson();
+      return 200;
+    }
+    std::string path = dbPath(target);
+    std::lock_guard<std::mutex> lock(storeLock);
+    response = "{";
+    for (auto it = store.lower_bound(path); it != store.end() && it->first.compare(0, path.size(), path) == 0;
+         ++it) {
+      std::string rel = it->first.substr(path.size());
+      if (!rel.empty() && rel[0] != '/') {
+        continue;
+      }
+      if (response.size() > 1) {
+        response += ",";
+      }
+      response += "\"" + jsonEscape(rel.empty() ? "" : rel.substr(1)) + "\":" + it->second;
+    }
+    response += "}";
+    return 200;
+  }
+  if (method != "PATCH" && method != "PUT" && method != "POST") {
+    response = "{\"error\":\"method not allowed\"}";
+    return 405;
+  }
+
+  unsigned long writeNumber = ++writeCounter;
+  if (options.delayMs > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(options.delayMs));
+  }
+  if (options.failEvery > 0 && writeNumber % options.failEvery == 0) {
+    response = "{\"error\":\"injected failure\"}";
+    return 503;
+  }
+
+  std::string path = dbPath(target);
+  std::string pushKey;
+  if (method == "POST") {
+    char key[24];
+    snprintf(key, sizeof(key), "-M%012lu", writeNumber);
+    pushKey = key;
+    path = path.empty() ? pushKey : path + "/" + pushKey;
+  }
+  std::vector<std::pair<std::string, std::string>> fields;
+  JsonFlattener parser(body, fields);
+  if (!parser.parse(path)) {
+    response = "{\"error\":\"Invalid data; couldn't parse JSON object.\"}";
+    return 400;
+  }
+  fieldCount = fields.size();
+  if (!options.discard) {
+    std::lock_guard<std::mutex> lock(storeLock);
+    if (method == "PUT") {
+      eraseUnder(path);
+    }
+    for (auto& field : fields) {
+      // A multi-path update replaces each named child; a null deletes it
+      eraseUnder(field.first);
+      if (field.second != "null") {
+        store[field.first] = field.second;
+      }
+    }
+  }
+  response = method == "POST" ? "{\"name\":\"" + pushKey + "\"}" : body;
+  return 200;
+}
+
+static const char* reason(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    default: return "Service Unavailable";
+  }
+}
+
+static bool sendAll(int fd, const std::string& data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) {
+      return false;
+    }
+    sent += (size_t)n;
+  }
+  return true;
+}
+
+static void serveConnection(int fd) {
+  openConnections++;
+  std::string in;
+  char chunk[16384];
+  bool open = true;
+  while (open) {
+    // Headers
+    size_t headerEnd;
+    while ((headerEnd = in.find("\r\n\r\n")) == std::string::npos) {
+      ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+      if (n <= 0) {
+        open = false;
+        break;
+      }
+      in.append(chunk, (size_t)n);
+    }
+    if (!open) {
+      break;
+    }
+    double start = nowSeconds();
+    std::string head = in.substr(0, headerEnd);
+    in.erase(0, headerEnd + 4);
+
+    char method[16] = "", target[1024] = "", version[16] = "";
+    sscanf(head.c_str(), "%15s %1023s %15s", method, target, version);
+    size_t contentLength = 0;
+    bool keepAlive = strcmp(version, "HTTP/1.0") != 0;
+    size_t lineStart = head.find("\r\n");
+    while (lineStart != std::string::npos) {
+      lineStart += 2;
+      size_t lineEnd = head.find("\r\n", lineStart);
+      std::string line = head.substr(lineStart, lineEnd == std::string::npos ? std::string::npos : lineEnd - lineStart);
+      std::string lower = line;
+      std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+      if (lower.compare(0, 15, "content-length:") == 0) {
+        contentLength = strtoul(line.c_str() + 15, nullptr, 10);
+      } else if (lower.compare(0, 11, "connection:") == 0) {
+        keepAlive = lower.find("close") == std::string::npos;
+      }
+      lineStart = lineEnd;
+    }
+
+    std::string response;
+    int status;
+    size_t fieldCount = 0;
+    if (contentLength > MAX_BODY_BYTES) {
+      response = "{\"error\":\"body too large\"}";
+      status = 413;
+      keepAlive = false;
+    } else {
+      while (in.size() < contentLength) {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) {
+          open = false;
+          break;
+        }
+        in.append(chunk, (size_t)n);
+      }
+      if (!open) {
+        break;
+      }
+      std::string body = in.substr(0, contentLength);
+      in.erase(0, contentLength);
+      status = handle(method, target, body, response, fieldCount);
+    }
+
+    char header[256];
+    snprintf(header, sizeof(header),
+             "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\nConnection: %s\r\n\r\n",
+             status, reason(status), response.size(), keepAlive ? "keep-alive" : "close");
+    open = sendAll(fd, header + response) && keepAlive;
+
+    uint32_t micros = (uint32_t)((nowSeconds() - start) * 1e6);
+    std::lock_guard<std::mutex> lock(statsLock);
+    totalRequests++;
+    intervalRequests++;
+    if (strcmp(method, "GET") != 0) {
+      totalWrites++;
+      if (status != 200) {
+        totalFailures++;
+      } else {
+        totalFields += fieldCount;
+        totalBytes += contentLength;
+        intervalFields += fieldCount;
+        intervalBytes += contentLength;
+      }
+      intervalMicros.push_back(micros);
+    }
+  }
+  close(fd);
+  openConnections--;
+}
+
+static void reportLoop() {
+  double last = nowSeconds();
+  while (true) {
+    std::this_thread::sleep_for(std::chrono::seconds(REPORT_INTERVAL_S));
+    double now = nowSeconds();
+    std::vector<uint32_t> micros;
+    unsigned long requests, fields;
+    unsigned long long bytes;
+    {
+      std::lock_guard<std::mutex> lock(statsLock);
+      micros.swap(intervalMicros);
+      requests = intervalRequests;
+      fields = intervalFields;
+      bytes = intervalBytes;
+      intervalRequests = intervalFields = 0;
+      intervalBytes = 0;
+    }
+    double seconds = now - last;
+    last = now;
+    if (requests == 0) {
+      continue;
+    }
+    std::sort(micros.begin(), micros.end());
+    auto pct = [&](double p) { return micros.empty() ? 0u : micros[(size_t)(p * (micros.size() - 1))]; };
+    fprintf(stderr,
+            "%.0f req/s, %.0f fields/s, %.1f kB/s, %d connection(s); handling p50 %u us, p99 %u us, max %u us\n",
+            requests / seconds, fields / seconds, bytes / seconds / 1000, openConnections.load(), pct(0.5),
+            pct(0.99), micros.empty() ? 0u : micros.back());
+  }
+}
+
+static void usage() {
+  fprintf(stderr, "usage: mockrtdb [--port 8080] [--delay-ms N] [--fail-every N] [--discard]\n");
+}
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* next = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--port") == 0 && next) {
+      options.port = atoi(argv[++i]);
+    } else if (strcmp(arg, "--delay-ms") == 0 && next) {
+      options.delayMs = atoi(argv[++i]);
+    } else if (strcmp(arg, "--fail-every") == 0 && next) {
+      options.failEvery = atoi(argv[++i]);
+    } else if (strcmp(arg, "--discard") == 0) {
+      options.discard = true;
+    } else {
+      usage();
+      return 2;
+    }
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  int yes = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons((uint16_t)options.port);
+  if (listener < 0 || bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 128) != 0) {
+    perror("mockrtdb: can't listen");
+    return 1;
+  }
+  fprintf(stderr, "mockrtdb listening on port %d%s\n", options.port, options.discard ? ", discarding data" : "");
+
+  std::thread(reportLoop).detach();
+  while (true) {
+    int fd = accept(listener, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    std::thread(serveConnection, fd).detach();
+  }
+}
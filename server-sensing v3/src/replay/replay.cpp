@@ -0,0 +1,684 @@
+// Host-side replay of recorded IMU traces through the firmware's sensing pipeline.
+// Built by the `native` environment:  pio run -e native
+// then:  .pio/build/native/program [options] trace.csv|trace.bin
+//
+// Trace formats
+//   CSV:    micros,ax,ay,az,gx,gy,gz[,rep[,pitch_ref]]   (header line optional)
+//           accel in m/s^2, gyro in rad/s, rep = 1 on the sample a labelled rep
+//           peaks, pitch_ref = reference angle in degrees (e.g. from a goniometer)
+//   Binary: little-endian records of {u32 micros; f32 ax,ay,az,gx,gy,gz; u32 rep}
+//
+// Reports bend detection accuracy against the labels, ns per sample for the whole
+// pipeline, ns per update plus pitch error for each orientation estimator, the
+// size and cost of packing the upload rows with SeriesCodec versus JSON, the
+// I2C bus time per sample of the MPU6050 driver, run against a simulated chip, and
+// the error and speed of each SensingMath policy against the float code, and how
+// well Timebase tracks a simulated drifting clock through jittery NTP syncs. Exits
+// with 3 if a math policy or the timebase breaks its bound.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <SensingPipeline.h>
+#include <SeriesCodec.h>
+#include <Mpu6050Sim.h>
+#include <Timebase.h>
+
+#ifndef REPLAY_SAMPLE_RATE_HZ
+#define REPLAY_SAMPLE_RATE_HZ 200 // Must match the SAMPLE_RATE_HZ the trace was recorded at
+#endif
+#ifndef REPLAY_UPLOAD_RATE_HZ
+#define REPLAY_UPLOAD_RATE_HZ 20 // UPLOAD_SAMPLE_RATE_HZ in the firmware
+#endif
+
+struct TraceRow {
+  uint32_t micros;
+  ImuReading reading;
+  bool rep;
+  float pitchRef;
+  bool hasRef;
+};
+
+struct Options {
+  const char* path = nullptr;
+  float synthSeconds = 0;
+  int repeat = 20;
+  float toleranceMs = 1000;
+  // Firmware defaults
+  float thresholdMultiplier = 1.5f;
+  float minDifference = 0.05f;
+  uint32_t refractoryMs = 300;
+  float cutoffHz = 15;
+  int batch = 50;
+  int dropBits = 10;
+};
+
+static bool loadCsv(const char* path, std::vector<TraceRow>& rows) {
+  FILE* f = fopen(path, "r");
+  if (f == nullptr) {
+    return false;
+  }
+  char line[512];
+  while (fgets(line, sizeof(line), f) != nullptr) {
+    if (!(line[0] == '-' || (line[0] >= '0' && line[0] <= '9'))) {
+      continue; // Header or comment
+    }
+    TraceRow row = {};
+    unsigned long micros;
+    int rep = 0;
+    float ref = 0;
+    int n = sscanf(line, "%lu,%f,%f,%f,%f,%f,%f,%d,%f", &micros,
+                   &row.reading.ax, &row.reading.ay, &row.reading.az,
+                   &row.reading.gx, &row.reading.gy, &row.reading.gz, &rep, &ref);
+    if (n < 7) {
+      continue;
+    }
+    row.micros = (uint32_t)micros;
+    row.rep = n >= 8 && rep != 0;
+    row.hasRef = n >= 9;
+    row.pitchRef = ref;
+    rows.push_back(row);
+  }
+  fclose(f);
+  return true;
+}
+
+static bool loadBinary(const char* path, std::vector<TraceRow>& rows) {
+  FILE* f = fopen(path, "rb");
+  if (f == nullptr) {
+    return false;
+  }
+  uint8_t rec[32];
+  while (fread(rec, 1, sizeof(rec), f) == sizeof(rec)) {
+    TraceRow row = {};
+    float v[6];
+    memcpy(&row.micros, rec, 4);
+    memcpy(v, rec + 4, sizeof(v));
+    uint32_t rep;
+    memcpy(&rep, rec + 28, 4);
+    row.reading = {v[0], v[1], v[2], v[3], v[4], v[5]};
+    row.rep = rep != 0;
+    rows.push_back(row);
+  }
+  fclose(f);
+  return true;
+}
+
+// Knee-flexion-like reps every 2.5 s with sensor noise, labelled at each rep peak
+static void synthesize(float seconds, std::vector<TraceRow>& rows) {
+  std::mt19937 rng(42);
+  std::normal_distribution<float> accelNoise(0, 0.3f), gyroNoise(0, 0.02f);
+  const float dt = 1.0f / REPLAY_SAMPLE_RATE_HZ;
+  const float repPeriod = 2.5f, repLength = 1.2f, depth = 1.2f; // rad
+  size_t n = (size_t)(seconds * REPLAY_SAMPLE_RATE_HZ);
+  const size_t repSamples = (size_t)(repPeriod * REPLAY_SAMPLE_RATE_HZ);
+  const size_t peakSample = (size_t)(repLength / 2 * REPLAY_SAMPLE_RATE_HZ);
+  for (size_t i = 0; i < n; i++) {
+    float t = i * dt;
+    float phase = (i % repSamples) * dt;
+    float theta = 0, omega = 0;
+    if (phase < repLength) {
+      float w = 2 * (float)M_PI / repLength;
+      theta = depth * 0.5f * (1 - cosf(w * phase));
+      omega = depth * 0.5f * w * sinf(w * phase);
+    }
+    TraceRow row = {};
+    row.micros = (uint32_t)(t * 1e6f);
+    row.reading.ax = accelNoise(rng);
+    row.reading.ay = 9.81f * sinf(theta) + accelNoise(rng);
+    row.reading.az = 9.81f * cosf(theta) + accelNoise(rng);
+    row.reading.gx = omega + gyroNoise(rng);
+    row.reading.gy = gyroNoise(rng);
+    row.reading.gz = gyroNoise(rng);
+    row.rep = i % repSamples == peakSample;
+    row.pitchRef = theta * 57.2957795f;
+    row.hasRef = true;
+    rows.push_back(row);
+  }
+}
+
+typedef SensingPipeline<REPLAY_SAMPLE_RATE_HZ> Pipeline;
+
+static void replayDetection(const Options& opt, const std::vector<TraceRow>& rows) {
+  // Heap-allocated: the detector window is too big for comfort on the stack
+  Pipeline* pipeline = new Pipeline(opt.thresholdMultiplier, opt.minDifference,
+                                    opt.refractoryMs * 1000, opt.cutoffHz);
+
+  std::vector<uint32_t> detected;
+  for (const TraceRow& row : rows) {
+    if (pipeline->detect(pipeline->estimate(row.reading, row.micros))) {
+      detected.push_back(row.micros);
+    }
+  }
+
+  std::vector<uint32_t> labelled;
+  for (const TraceRow& row : rows) {
+    if (row.rep) {
+      labelled.push_back(row.micros);
+    }
+  }
+
+  // Greedy in-order matching within the tolerance window
+  uint32_t tolerance = (uint32_t)(opt.toleranceMs * 1000);
+  size_t matched = 0, d = 0;
+  for (uint32_t label : labelled) {
+    while (d < detected.size() && detected[d] + tolerance < label) {
+      d++;
+    }
+    if (d < detected.size() && (detected[d] > label ? detected[d] - label : label - detected[d]) <= tolerance) {
+      matched++;
+      d++;
+    }
+  }
+
+  printf("Bends detected:   %zu\n", detected.size());
+  if (!labelled.empty()) {
+    size_t falsePositives = detected.size() - matched;
+    size_t misses = labelled.size() - matched;
+    printf("Labelled reps:    %zu\n", labelled.size());
+    printf("Matched:          %zu (tolerance %.0f ms)\n", matched, opt.toleranceMs);
+    printf("False positives:  %zu\n", falsePositives);
+    printf("Missed:           %zu\n", misses);
+    printf("Precision/recall: %.3f / %.3f\n",
+           detected.empty() ? 0.0 : (double)matched / detected.size(),
+           (double)matched / labelled.size());
+  }
+
+  // Throughput of the whole per-sample path
+  volatile uint32_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < opt.repeat; r++) {
+    pipeline->reset();
+    for (const TraceRow& row : rows) {
+      sink = sink + pipeline->detect(pipeline->estimate(row.reading, row.micros));
+    }
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  double perSample = ns / ((double)rows.size() * opt.repeat);
+  double traceSeconds = rows.size() > 1 ? (rows.back().micros - rows.front().micros) / 1e6 : 0;
+  printf("Pipeline:         %.1f ns/sample, %.0fx real time\n", perSample,
+         traceSeconds > 0 ? traceSeconds * 1e9 / (perSample * rows.size()) : 0.0);
+  delete pipeline;
+}
+
+template <typename Estimator>
+static void benchEstimator(const char* name, const Options& opt, const std::vector<TraceRow>& rows) {
+  Estimator estimator;
+  double errorSum = 0;
+  size_t errorCount = 0;
+  uint32_t last = 0;
+  for (size_t i = 0; i < rows.size(); i++) {
+    const TraceRow& row = rows[i];
+    float dt = i == 0 ? 0 : (row.micros - last) / 1e6f;
+    last = row.micros;
+    estimator.update(row.reading.ax, row.reading.ay, row.reading.az,
+                     row.reading.gx, row.reading.gy, row.reading.gz, dt);
+    // Skip the first second while the filter settles
+    if (row.hasRef && row.micros - rows[0].micros > 1000000) {
+      errorSum += fabs(estimator.orientation().pitch - row.pitchRef);
+      errorCount++;
+    }
+  }
+
+  volatile float sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < opt.repeat; r++) {
+    estimator.reset();
+    for (const TraceRow& row : rows) {
+      estimator.update(row.reading.ax, row.reading.ay, row.reading.az,
+                       row.reading.gx, row.reading.gy, row.reading.gz, 1.0f / REPLAY_SAMPLE_RATE_HZ);
+    }
+    sink = sink + estimator.orientation().pitch;
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  printf("  %-14s %8.1f ns/update", name, ns / ((double)rows.size() * opt.repeat));
+  if (errorCount > 0) {
+    printf("   pitch MAE %.2f deg", errorSum / errorCount);
+  }
+  printf("\n");
+}
+
+// Upload rows as the firmware records them: decimated to the upload rate with
+// the running bend count
+static void uploadRows(const Options& opt, const std::vector<TraceRow>& rows, std::vector<SeriesRow>& out) {
+  Pipeline* pipeline = new Pipeline(opt.thresholdMultiplier, opt.minDifference,
+                                    opt.refractoryMs * 1000, opt.cutoffHz);
+  const size_t every = REPLAY_SAMPLE_RATE_HZ / REPLAY_UPLOAD_RATE_HZ > 0
+    ? REPLAY_SAMPLE_RATE_HZ / REPLAY_UPLOAD_RATE_HZ : 1;
+  uint32_t bends = 0;
+  for (size_t i = 0; i < rows.size(); i++) {
+    ImuSample sample = pipeline->estimate(rows[i].reading, rows[i].micros);
+    bends += pipeline->detect(sample);
+    if (i % every == 0) {
+      out.push_back({rows[i].micros / 1000, (uint32_t)out.size(), sample.pitch, sample.gyroY, bends});
+    }
+  }
+  delete pipeline;
+}
+
+// Packs batches of opt.batch rows and compares them with the JSON the firmware
+// would otherwise send; both include the child keys, the packed size is base64.
+static void benchCodec(const Options& opt, const std::vector<TraceRow>& rows, int dropBits) {
+  std::vector<SeriesRow> series;
+  uploadRows(opt, rows, series);
+  const uint32_t epoch = 1700000000;
+
+  size_t jsonBytes = 0;
+  for (const SeriesRow& row : series) {
+    char text[180];
+    jsonBytes += snprintf(text, sizeof(text),
+                          "\"%lu_%06lu\":{\"pitch\":%.7g,\"bendCount\":%lu,\"gyroY\":%.7g,\"timestamp\":%lu,"
+                          "\"usec\":%lu},",
+                          (unsigned long)(epoch + row.uptimeMs / 1000), (unsigned long)row.seq, row.pitch,
+                          (unsigned long)row.bendCount, row.gyroY, (unsigned long)(epoch + row.uptimeMs / 1000),
+                          (unsigned long)(row.uptimeMs % 1000 * 1000));
+  }
+
+  SeriesEncoder* encoder = new SeriesEncoder(dropBits);
+  std::vector<uint8_t> block(SERIES_MAX_BLOCK_BYTES);
+  std::vector<std::vector<uint8_t>> blocks;
+  size_t packedBytes = 0, textBytes = 0;
+  for (size_t i = 0; i < series.size();) {
+    encoder->begin(1, epoch * 1000000ULL + series[i].uptimeMs * 1000ULL);
+    size_t end = std::min(series.size(), i + (size_t)opt.batch);
+    while (i < end && encoder->add(series[i])) {
+      i++;
+    }
+    size_t length = encoder->finish(block.data(), block.size());
+    blocks.emplace_back(block.begin(), block.begin() + length);
+    packedBytes += length;
+    // "<key>":{"b":"<base64>","n":50},
+    textBytes += 20 + 16 + (length + 2) / 3 * 4;
+  }
+
+  // Round trip, and the float error from dropped mantissa bits
+  size_t decodedRows = 0;
+  float maxPitchError = 0, maxGyroError = 0;
+  bool exact = true;
+  SeriesDecoder decoder;
+  for (const std::vector<uint8_t>& b : blocks) {
+    SeriesRow row;
+    decoder.begin(b.data(), b.size());
+    while (decoder.next(row) && decodedRows < series.size()) {
+      const SeriesRow& in = series[decodedRows++];
+      exact = exact && row.uptimeMs == in.uptimeMs && row.seq == in.seq && row.bendCount == in.bendCount;
+      maxPitchError = std::max(maxPitchError, fabsf(row.pitch - in.pitch));
+      maxGyroError = std::max(maxGyroError, fabsf(row.gyroY - in.gyroY));
+    }
+  }
+
+  volatile size_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < opt.repeat; r++) {
+    for (size_t i = 0; i < series.size();) {
+      encoder->begin(1, epoch * 1000000ULL);
+      size_t end = std::min(series.size(), i + (size_t)opt.batch);
+      while (i < end && encoder->add(series[i])) {
+        i++;
+      }
+      sink = sink + encoder->finish(block.data(), block.size());
+    }
+  }
+  double encodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  start = std::chrono::steady_clock::now();
+  for (int r = 0; r < opt.repeat; r++) {
+    for (const std::vector<uint8_t>& b : blocks) {
+      SeriesRow row;
+      decoder.begin(b.data(), b.size());
+      while (decoder.next(row)) {
+        sink = sink + row.seq;
+      }
+    }
+  }
+  double decodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  delete encoder;
+
+  double samples = (double)series.size() * opt.repeat;
+  printf("  drop %2d bits     %6.2f B/sample, %5.1fx smaller than JSON (%4.1fx as base64), "
+         "encode %.1f ns/sample, decode %.1f ns/sample, max error pitch %.4f gyro %.4f%s\n",
+         dropBits, (double)packedBytes / series.size(), (double)jsonBytes / packedBytes,
+         (double)jsonBytes / textBytes, encodeNs / samples, decodeNs / samples, maxPitchError, maxGyroError,
+         exact && decodedRows == series.size() ? "" : "  ROUND TRIP MISMATCH");
+  if (dropBits == 0) {
+    printf("  JSON             %6.2f B/sample, %zu rows in %zu blocks\n",
+           (double)jsonBytes / series.size(), series.size(), blocks.size());
+  }
+}
+
+// Feeds the trace through the register-map simulator and reads it back with the
+// driver, in burst and in FIFO mode: checks the readings survive the round trip
+// (to within one count) and reports the bus time each sample costs.
+static void benchDriver(const std::vector<TraceRow>& rows, bool fifo, size_t fifoBatch) {
+  Mpu6050Sim chip;
+  Mpu6050Driver<Mpu6050Sim> driver(chip);
+  Mpu6050Driver<Mpu6050Sim>::Config config;
+  config.sampleRateHz = REPLAY_SAMPLE_RATE_HZ;
+  if (!driver.begin(config) || (fifo && !driver.startFifo())) {
+    printf("  driver setup failed\n");
+    return;
+  }
+  chip.resetCounters();
+
+  // One count of each, the most the round trip may lose
+  float accelStep = driver.accelMs2(1), gyroStep = driver.gyroRads(1);
+  double accelError = 0, gyroError = 0;
+  size_t read = 0, bad = 0;
+  std::vector<Mpu6050Raw> raw(fifoBatch);
+  auto check = [&](const Mpu6050Raw& r, const ImuReading& in) {
+    double ea = std::max({fabs(driver.accelMs2(r.ax) - in.ax), fabs(driver.accelMs2(r.ay) - in.ay),
+                          fabs(driver.accelMs2(r.az) - in.az)});
+    double eg = std::max({fabs(driver.gyroRads(r.gx) - in.gx), fabs(driver.gyroRads(r.gy) - in.gy),
+                          fabs(driver.gyroRads(r.gz) - in.gz)});
+    accelError = std::max(accelError, ea);
+    gyroError = std::max(gyroError, eg);
+    bad += ea > accelStep || eg > gyroStep;
+    read++;
+  };
+
+  for (size_t i = 0; i < rows.size(); i++) {
+    const ImuReading& in = rows[i].reading;
+    chip.sample(in.ax, in.ay, in.az, in.gx, in.gy, in.gz);
+    if (!fifo) {
+      driver.readBurst(raw[0]);
+      check(raw[0], in);
+    } else if ((i + 1) % fifoBatch == 0) {
+      size_t n = driver.readFifo(raw.data(), fifoBatch);
+      for (size_t k = 0; k < n; k++) {
+        check(raw[k], rows[i + 1 - n + k].reading);
+      }
+    }
+  }
+
+  double perSample400k = chip.busMicros(400000) / read;
+  double perSample1M = chip.busMicros(1000000) / read;
+  printf("  %-5s x%-3zu %6.1f us/sample at 400 kHz (max %4.0f Hz), %5.1f at 1 MHz, "
+         "%4.1f bytes/sample, max error %.4f m/s^2 %.5f rad/s%s\n",
+         fifo ? "fifo" : "burst", fifo ? fifoBatch : (size_t)1, perSample400k, 1e6 / perSample400k,
+         perSample1M, (double)chip.busBytes() / read, accelError, gyroError,
+         bad == 0 && read == rows.size() - (fifo ? rows.size() % fifoBatch : 0) ? "" : "  READBACK MISMATCH");
+}
+
+// Worst-case atan2 and rsqrt error of a math policy against double-precision libm,
+// and its cost per call
+template <typename Math>
+static bool benchMathFunctions(const char* name, const Options& opt) {
+  std::vector<float> ys, xs, squares;
+  const float radii[] = {0.01f, 1.0f, 9.81f, 100.0f};
+  for (float r : radii) {
+    for (int i = 0; i < 3600; i++) {
+      double a = (i + 0.37) * M_PI / 1800 - M_PI;
+      ys.push_back((float)(r * sin(a)));
+      xs.push_back((float)(r * cos(a)));
+    }
+  }
+  for (int i = 0; i < 10000; i++) {
+    squares.push_back((float)pow(10.0, -4 + 8.0 * i / 10000));
+  }
+
+  double atanError = 0, rsqrtError = 0;
+  for (size_t i = 0; i < ys.size(); i++) {
+    double error = fabs(Math::atan2Deg(ys[i], xs[i]) - atan2((double)ys[i], (double)xs[i]) * 180 / M_PI);
+    atanError = std::max(atanError, std::min(error, 360 - error)); // +-180 is the same angle
+  }
+  for (float x : squares) {
+    rsqrtError = std::max(rsqrtError, fabs(Math::rsqrt(x) * sqrt((double)x) - 1));
+  }
+
+  volatile float sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < opt.repeat; r++) {
+    float acc = 0;
+    for (size_t i = 0; i < ys.size(); i++) {
+      acc += Math::atan2Deg(ys[i], xs[i]);
+    }
+    sink = sink + acc;
+  }
+  double atanNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                  ((double)ys.size() * opt.repeat);
+  start = std::chrono::steady_clock::now();
+  for (int r = 0; r < opt.repeat; r++) {
+    float acc = 0;
+    for (float x : squares) {
+      acc += Math::rsqrt(x);
+    }
+    sink = sink + acc;
+  }
+  double rsqrtNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                   ((double)squares.size() * opt.repeat);
+
+  bool ok = atanError <= Math::ATAN2_MAX_ERROR_DEG && rsqrtError <= Math::RSQRT_MAX_REL_ERROR;
+  printf("  %-6s atan2 %5.1f ns, max error %.5f deg (bound %.4f)   rsqrt %5.1f ns, max error %.1e (bound %.0e)%s\n",
+         name, atanNs, atanError, Math::ATAN2_MAX_ERROR_DEG, rsqrtNs, rsqrtError, Math::RSQRT_MAX_REL_ERROR,
+         ok ? "" : "  OUT OF BOUND");
+  return ok;
+}
+
+// Largest pitch deviation a policy may add to the float pipeline's output, and how
+// many samples a bend may move by
+#define MATH_PITCH_MAX_DEVIATION_DEG 0.05
+#define MATH_BEND_MAX_SHIFT_SAMPLES 2
+
+// The whole pipeline under a math policy against the float one: how far the pitch
+// moves, whether the same bends come out at about the same samples, and ns per sample.
+// The first call (FloatMath) records the reference.
+template <typename Math>
+static bool benchMathPipeline(const char* name, const Options& opt, const std::vector<TraceRow>& rows,
+                              std::vector<float>& refPitch, std::vector<uint32_t>& refBends) {
+  typedef SensingPipeline<REPLAY_SAMPLE_RATE_HZ, ComplementaryFilterT<Math>, Math> MathPipeline;
+  MathPipeline* pipeline = new MathPipeline(opt.thresholdMultiplier, opt.minDifference,
+                                            opt.refractoryMs * 1000, opt.cutoffHz);
+  bool reference = refPitch.empty();
+  double pitchError = 0;
+  std::vector<uint32_t> bends;
+  for (size_t i = 0; i < rows.size(); i++) {
+    ImuSample sample = pipeline->estimate(rows[i].reading, rows[i].micros);
+    if (pipeline->detect(sample)) {
+      bends.push_back(sample.micros);
+    }
+    if (reference) {
+      refPitch.push_back(sample.pitch);
+    } else {
+      pitchError = std::max(pitchError, (double)fabsf(sample.pitch - refPitch[i]));
+    }
+  }
+  if (reference) {
+    refBends = bends;
+  }
+
+  volatile uint32_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < opt.repeat; r++) {
+    pipeline->reset();
+    for (const TraceRow& row : rows) {
+      sink = sink + pipeline->detect(pipeline->estimate(row.reading, row.micros));
+    }
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+              ((double)rows.size() * opt.repeat);
+  delete pipeline;
+
+  uint32_t shift = 0;
+  bool sameBends = bends.size() == refBends.size();
+  for (size_t i = 0; sameBends && i < bends.size(); i++) {
+    shift = std::max(shift, bends[i] > refBends[i] ? bends[i] - refBends[i] : refBends[i] - bends[i]);
+  }
+  sameBends = sameBends && shift <= MATH_BEND_MAX_SHIFT_SAMPLES * 1000000u / REPLAY_SAMPLE_RATE_HZ;
+  bool ok = pitchError <= MATH_PITCH_MAX_DEVIATION_DEG && sameBends;
+  printf("  %-6s %8.1f ns/sample, max pitch deviation %.4f deg, %zu bends, max bend shift %.0f ms%s\n", name,
+         ns, pitchError, bends.size(), shift / 1000.0, ok ? "" : sameBends ? "  OUT OF BOUND" : "  BENDS DIFFER");
+  return ok;
+}
+
+// Bounds for the simulated day of NTP syncs, once the drift estimate has settled:
+// stamp error in multiples of the NTP jitter, and drift estimate error
+#define TIMEBASE_MAX_ERROR_JITTERS 2.5
+#define TIMEBASE_MAX_DRIFT_ERROR_PPB 5000
+
+// A local clock drifting by driftPpm, NTP answers every intervalS with Gaussian
+// jitter, and a sample stamped every 50 ms for a day. Reports the stamp error
+// against true time with and without the timebase's correction, and checks the
+// stamps never go backwards.
+static bool benchTimebase(double driftPpm, double intervalS, double jitterMs) {
+  std::mt19937 rng(7);
+  std::normal_distribution<double> jitter(0, jitterMs * 1000);
+  // Give the drift estimate a few syncs before measuring
+  const double day = 24 * 3600e6, settle = std::max(2 * 3600e6, 6 * intervalS * 1e6);
+  const uint64_t epochAtStart = 1700000000000000ULL;
+  // Local microseconds at true time t (us since start); starts 3 s after boot
+  auto localAt = [&](double t) { return (uint64_t)(3e6 + t * (1 + driftPpm * 1e-6)); };
+
+  Timebase timebase;
+  uint64_t uncorrectedAnchorLocal = 0, uncorrectedAnchorEpoch = 0;
+  double nextSync = 0;
+  double maxError = 0, maxUncorrected = 0, errorSum = 0;
+  size_t errorCount = 0, backwards = 0;
+  uint64_t lastStamp = 0;
+  for (double t = 0; t < day; t += 50000) {
+    if (t >= nextSync) {
+      uint64_t reference = (uint64_t)(epochAtStart + t + jitter(rng));
+      timebase.sync(localAt(t), reference);
+      if (uncorrectedAnchorLocal == 0) {
+        uncorrectedAnchorLocal = localAt(t);
+        uncorrectedAnchorEpoch = reference;
+      }
+      nextSync += intervalS * 1e6;
+    }
+    uint64_t stamp = timebase.epochMicros(localAt(t));
+    if (stamp < lastStamp) {
+      backwards++;
+    }
+    lastStamp = stamp;
+    if (t >= settle) {
+      double error = fabs((double)stamp - (epochAtStart + t));
+      double uncorrected = fabs((double)(uncorrectedAnchorEpoch + (localAt(t) - uncorrectedAnchorLocal)) -
+                                (epochAtStart + t));
+      maxError = std::max(maxError, error);
+      maxUncorrected = std::max(maxUncorrected, uncorrected);
+      errorSum += error;
+      errorCount++;
+    }
+  }
+
+  // A local clock that runs fast needs a negative correction
+  double driftError = fabs(timebase.driftPpb() + driftPpm * 1000 / (1 + driftPpm * 1e-6));
+  bool ok = maxError <= TIMEBASE_MAX_ERROR_JITTERS * jitterMs * 1000 && driftError <= TIMEBASE_MAX_DRIFT_ERROR_PPB && backwards == 0 &&
+            timebase.stepCount() == 0;
+  printf("  drift %+6.1f ppm, sync %4.0f s, jitter %.1f ms: error mean %6.0f us, max %6.0f us (uncorrected %8.0f us), "
+         "drift estimate %+7.2f ppm, %u steps%s\n",
+         driftPpm, intervalS, jitterMs, errorCount ? errorSum / errorCount : 0.0, maxError, maxUncorrected,
+         timebase.driftPpb() / 1000.0, (unsigned)timebase.stepCount(),
+         ok ? "" : backwards ? "  WENT BACKWARDS" : "  OUT OF BOUND");
+  return ok;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: replay [options] <trace.csv|trace.bin>\n"
+          "       replay [options] --synth SECONDS\n"
+          "  --repeat N        timing passes over the trace (default 20)\n"
+          "  --tolerance MS    max distance between a detection and its label (default 1000)\n"
+          "  --multiplier X    bend threshold multiplier (default 1.5)\n"
+          "  --min-diff X      bend minimum difference in G (default 0.05)\n"
+          "  --refractory MS   bend refractory period (default 300)\n"
+          "  --cutoff HZ       detector low-pass cutoff (default 15)\n"
+          "  --batch N         upload rows per packed block (default 50)\n"
+          "  --drop-bits N     float mantissa bits rounded off when packing (default 10)\n");
+}
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--synth" && hasValue) {
+      opt.synthSeconds = atof(argv[++i]);
+    } else if (arg == "--repeat" && hasValue) {
+      opt.repeat = atoi(argv[++i]);
+    } else if (arg == "--tolerance" && hasValue) {
+      opt.toleranceMs = atof(argv[++i]);
+    } else if (arg == "--multiplier" && hasValue) {
+      opt.thresholdMultiplier = atof(argv[++i]);
+    } else if (arg == "--min-diff" && hasValue) {
+      opt.minDifference = atof(argv[++i]);
+    } else if (arg == "--refractory" && hasValue) {
+      opt.refractoryMs = atoi(argv[++i]);
+    } else if (arg == "--cutoff" && hasValue) {
+      opt.cutoffHz = atof(argv[++i]);
+    } else if (arg == "--batch" && hasValue) {
+      opt.batch = atoi(argv[++i]);
+    } else if (arg == "--drop-bits" && hasValue) {
+      opt.dropBits = atoi(argv[++i]);
+    } else if (arg[0] != '-' && opt.path == nullptr) {
+      opt.path = argv[i];
+    } else {
+      usage();
+      return 2;
+    }
+  }
+
+  std::vector<TraceRow> rows;
+  if (opt.synthSeconds > 0) {
+    synthesize(opt.synthSeconds, rows);
+  } else if (opt.path != nullptr) {
+    size_t len = strlen(opt.path);
+    bool binary = len > 4 && strcmp(opt.path + len - 4, ".bin") == 0;
+    if (!(binary ? loadBinary(opt.path, rows) : loadCsv(opt.path, rows))) {
+      fprintf(stderr, "can't read %s\n", opt.path);
+      return 1;
+    }
+  } else {
+    usage();
+    return 2;
+  }
+  if (rows.empty()) {
+    fprintf(stderr, "trace has no samples\n");
+    return 1;
+  }
+  if (opt.repeat < 1) {
+    opt.repeat = 1;
+  }
+  if (opt.batch < 1) {
+    opt.batch = 1;
+  }
+
+  printf("Samples:          %zu at %d Hz\n", rows.size(), REPLAY_SAMPLE_RATE_HZ);
+  replayDetection(opt, rows);
+  printf("Orientation estimators:\n");
+  benchEstimator<ComplementaryFilter>("complementary", opt, rows);
+  benchEstimator<MadgwickFilter>("madgwick", opt, rows);
+  benchEstimator<MahonyFilter>("mahony", opt, rows);
+  printf("Upload packing at %d Hz:\n", REPLAY_UPLOAD_RATE_HZ);
+  benchCodec(opt, rows, 0);
+  if (opt.dropBits > 0) {
+    benchCodec(opt, rows, opt.dropBits);
+  }
+  printf("MPU6050 driver bus time:\n");
+  benchDriver(rows, false, 1);
+  benchDriver(rows, true, 4);
+  benchDriver(rows, true, 10);
+  printf("Math policies, functions against libm:\n");
+  bool mathOk = benchMathFunctions<FloatMath>("float", opt);
+  mathOk &= benchMathFunctions<PolyMath>("poly", opt);
+  mathOk &= benchMathFunctions<LutMath>("lut", opt);
+  printf("Math policies, complementary pipeline against float:\n");
+  std::vector<float> refPitch;
+  std::vector<uint32_t> refBends;
+  mathOk &= benchMathPipeline<FloatMath>("float", opt, rows, refPitch, refBends);
+  mathOk &= benchMathPipeline<PolyMath>("poly", opt, rows, refPitch, refBends);
+  mathOk &= benchMathPipeline<LutMath>("lut", opt, rows, refPitch, refBends);
+  mathOk &= benchMathPipeline<Q15Math>("q15", opt, rows, refPitch, refBends);
+  printf("Timebase over a simulated day:\n");
+  bool timeOk = benchTimebase(40, 900, 2);
+  timeOk &= benchTimebase(-25, 900, 2);
+  timeOk &= benchTimebase(40, 3600, 5);
+  return mathOk && timeOk ? 0 : 3;
+}
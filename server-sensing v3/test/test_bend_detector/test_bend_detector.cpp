@@ -0,0 +1,171 @@
+// BendDetector threshold, re-arm, refractory and prefilter behaviour on synthetic
+// signals, plus a throughput benchmark that checks an update costs the same
+// whatever the window length. Run with:  pio test -e native -f test_bend_detector
+
+#include <unity.h>
+
+#include <chrono>
+#include <cstdio>
+
+#include <BendDetector.h>
+
+#define RATE_HZ 200
+#define PERIOD_US (1000000 / RATE_HZ)
+
+typedef BendDetector<float, 200> Detector; // 1 s window
+
+static uint32_t now;
+
+// Feeds n samples of x, returns how many completed a bend
+template <typename D>
+static int feed(D& d, float x, int n) {
+  int bends = 0;
+  for (int i = 0; i < n; i++, now += PERIOD_US) {
+    bends += d.update(x, now) ? 1 : 0;
+  }
+  return bends;
+}
+
+void setUp() { now = 0; }
+
+void tearDown() {}
+
+void test_running_window_mean() {
+  RunningWindow<float, 4> w;
+  TEST_ASSERT_EQUAL_FLOAT(0, w.mean());
+  w.push(1);
+  w.push(3);
+  TEST_ASSERT_EQUAL_FLOAT(2, w.mean());
+  TEST_ASSERT_FALSE(w.full());
+  for (int i = 0; i < 10; i++) {
+    w.push(10);
+  }
+  TEST_ASSERT_TRUE(w.full());
+  TEST_ASSERT_EQUAL_FLOAT(10, w.mean());
+  w.reset();
+  TEST_ASSERT_EQUAL(0, w.size());
+}
+
+void test_bend_fires_once_above_threshold_and_rearms() {
+  Detector d(1.2f, 2.0f);
+  TEST_ASSERT_EQUAL(0, feed(d, 10, 200));
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 12, d.threshold());
+  // Held high: one bend, not one per sample
+  TEST_ASSERT_EQUAL(1, feed(d, 30, 20));
+  TEST_ASSERT_TRUE(d.aboveThreshold());
+  TEST_ASSERT_EQUAL(0, feed(d, 10, 200));
+  TEST_ASSERT_FALSE(d.aboveThreshold());
+  TEST_ASSERT_EQUAL(1, feed(d, 30, 20));
+  TEST_ASSERT_EQUAL_UINT32(2, d.count());
+}
+
+void test_min_difference_ignores_small_rises() {
+  Detector d(1.2f, 5.0f);
+  feed(d, 10, 200);
+  // 12 is the threshold; 16 is above it but within minDifference
+  TEST_ASSERT_EQUAL(0, feed(d, 16, 5));
+  TEST_ASSERT_EQUAL(1, feed(d, 20, 5));
+}
+
+void test_refractory_merges_close_bends() {
+  Detector d(1.2f, 2.0f, 300000);
+  feed(d, 10, 200);
+  TEST_ASSERT_EQUAL(1, feed(d, 30, 4));
+  TEST_ASSERT_EQUAL(0, feed(d, 10, 10));
+  // 70 ms after the first: same movement
+  TEST_ASSERT_EQUAL(0, feed(d, 30, 4));
+  TEST_ASSERT_EQUAL(0, feed(d, 10, 100));
+  // Well past the refractory period
+  TEST_ASSERT_EQUAL(1, feed(d, 30, 4));
+  TEST_ASSERT_EQUAL_UINT32(2, d.count());
+}
+
+void test_refractory_across_the_micros_wrap() {
+  Detector d(1.2f, 2.0f, 300000);
+  now = 0xFFFFFFFFUL - 1100000;
+  feed(d, 10, 200);
+  TEST_ASSERT_EQUAL(1, feed(d, 30, 4));
+  TEST_ASSERT_EQUAL(0, feed(d, 10, 20)); // Wraps in here
+  TEST_ASSERT_EQUAL(0, feed(d, 30, 4));
+  TEST_ASSERT_EQUAL(0, feed(d, 10, 100));
+  TEST_ASSERT_EQUAL(1, feed(d, 30, 4));
+}
+
+void test_prefilter_rejects_a_one_sample_spike() {
+  Detector raw(1.2f, 2.0f);
+  BendDetector<float, 200, Biquad<float> > filtered(1.2f, 2.0f, 0, Biquad<float>::lowPass(RATE_HZ, 2));
+  feed(raw, 10, 200);
+  now = 0;
+  feed(filtered, 10, 200);
+  uint32_t start = now;
+  TEST_ASSERT_EQUAL(1, feed(raw, 30, 1));
+  now = start;
+  TEST_ASSERT_EQUAL(0, feed(filtered, 30, 1));
+  // A real bend lasting a second still gets through the filter
+  TEST_ASSERT_EQUAL(1, feed(filtered, 30, 200));
+}
+
+void test_filters_start_at_the_first_input() {
+  Biquad<float> b = Biquad<float>::lowPass(RATE_HZ, 2);
+  OnePoleLowPass<float> p = OnePoleLowPass<float>::fromCutoff(RATE_HZ, 2);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 45, b.process(45));
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 45, p.process(45));
+  for (int i = 0; i < 1000; i++) {
+    b.process(20);
+    p.process(20);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 20, b.process(20));
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 20, p.process(20));
+}
+
+void test_reset_clears_count_and_window() {
+  Detector d(1.2f, 2.0f, 300000);
+  feed(d, 10, 200);
+  feed(d, 30, 4);
+  d.reset();
+  TEST_ASSERT_EQUAL_UINT32(0, d.count());
+  TEST_ASSERT_FALSE(d.aboveThreshold());
+  // No refractory carried over from before the reset
+  now = 0;
+  feed(d, 10, 200);
+  TEST_ASSERT_EQUAL(1, feed(d, 30, 4));
+}
+
+template <size_t N>
+static double nsPerUpdate(int samples) {
+  BendDetector<float, N, Biquad<float> > d(1.2f, 2.0f, 300000, Biquad<float>::lowPass(RATE_HZ, 5));
+  uint32_t t = 0;
+  uint32_t bends = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < samples; i++, t += PERIOD_US) {
+    // 0.5 Hz bends; the one at t = 0 is the baseline, not a bend
+    float x = 10 + (i % 400 < 100 ? 20 : 0);
+    bends += d.update(x, t) ? 1 : 0;
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  TEST_ASSERT_EQUAL_UINT32(samples / 400 - 1, bends);
+  return ns / samples;
+}
+
+void test_throughput_does_not_depend_on_window_length() {
+  const int samples = 2000000;
+  nsPerUpdate<16>(samples / 10); // Warm up
+  double small = nsPerUpdate<16>(samples);
+  double large = nsPerUpdate<2048>(samples);
+  printf("BendDetector+Biquad: %.1f ns/update with a 16-sample window, %.1f ns with 2048\n", small, large);
+  TEST_ASSERT_TRUE(large < small * 4 + 20);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_running_window_mean);
+  RUN_TEST(test_bend_fires_once_above_threshold_and_rearms);
+  RUN_TEST(test_min_difference_ignores_small_rises);
+  RUN_TEST(test_refractory_merges_close_bends);
+  RUN_TEST(test_refractory_across_the_micros_wrap);
+  RUN_TEST(test_prefilter_rejects_a_one_sample_spike);
+  RUN_TEST(test_filters_start_at_the_first_input);
+  RUN_TEST(test_reset_clears_count_and_window);
+  RUN_TEST(test_throughput_does_not_depend_on_window_length);
+  return UNITY_END();
+}
@@ -0,0 +1,168 @@
+// Mpu6050Driver against the Mpu6050Sim register map: setup writes the rate and
+// ranges, a burst read decodes signed big-endian counts around the temperature
+// bytes, FIFO drains come back in order across the 10-frame chunks, and a FIFO
+// that overflowed is reset and counted instead of read misaligned.
+// Run with:  pio test -e native -f test_mpu6050_driver
+
+#include <unity.h>
+
+#include <Mpu6050Driver.h>
+#include <Mpu6050Sim.h>
+
+typedef Mpu6050Driver<Mpu6050Sim> Driver;
+
+static const float G = 9.80665f;
+static const float DEG = 0.0174532925f;
+
+void setUp() {}
+
+void tearDown() {}
+
+// Default ranges: +-8 g is 4096 counts/g, +-500 deg/s is 65.536 counts per deg/s
+static bool startDriver(Mpu6050Sim& chip, Driver& driver, bool fifo) {
+  Driver::Config config;
+  return driver.begin(config) && (!fifo || driver.startFifo()) && chip.fifoSize() == 0;
+}
+
+// Sample i has accel x = i counts and gyro z = -i counts, so order and sign show
+static void pushSample(Mpu6050Sim& chip, int i) {
+  chip.sample(i * G / 4096, 0.5f * G, -G, 0, 1.0f * DEG, -i * DEG / 65.536f);
+}
+
+void test_begin_configures_the_chip() {
+  Mpu6050Sim chip;
+  Driver driver(chip);
+  Driver::Config config;
+  config.sampleRateHz = 300; // 1 kHz / 3, rounded to a whole divider
+  config.accelRange = 1;
+  config.gyroRange = 3;
+  TEST_ASSERT_TRUE(driver.begin(config));
+  TEST_ASSERT_EQUAL_UINT16(333, driver.sampleRateHz());
+  TEST_ASSERT_EQUAL_HEX8(2, chip.reg(MPU6050_REG_SMPLRT_DIV));
+  TEST_ASSERT_EQUAL_HEX8(1 << 3, chip.reg(MPU6050_REG_ACCEL_CONFIG));
+  TEST_ASSERT_EQUAL_HEX8(3 << 3, chip.reg(MPU6050_REG_GYRO_CONFIG));
+  TEST_ASSERT_EQUAL_HEX8(MPU6050_PWR_CLOCK_PLL_X, chip.reg(MPU6050_REG_PWR_MGMT_1)); // Awake
+  TEST_ASSERT_FALSE(driver.fifoEnabled());
+
+  Driver absent(chip, MPU6050_ADDRESS + 1);
+  TEST_ASSERT_FALSE(absent.begin(config));
+}
+
+void test_sleeping_chip_latches_nothing() {
+  Mpu6050Sim chip;
+  chip.sample(G, G, G, 1, 1, 1);
+  TEST_ASSERT_EQUAL_HEX8(0, chip.reg(MPU6050_REG_ACCEL_XOUT_H));
+  TEST_ASSERT_EQUAL_HEX8(0, chip.reg(MPU6050_REG_ACCEL_XOUT_H + 1));
+}
+
+void test_read_burst_decodes_counts() {
+  Mpu6050Sim chip;
+  Driver driver(chip);
+  TEST_ASSERT_TRUE(startDriver(chip, driver, false));
+  chip.sample(1.0f * G, -0.5f * G, -8.5f * G, 100 * DEG, -250 * DEG, 0.5f * DEG);
+  Mpu6050Raw raw;
+  TEST_ASSERT_TRUE(driver.readBurst(raw));
+  TEST_ASSERT_EQUAL_INT16(4096, raw.ax);
+  TEST_ASSERT_EQUAL_INT16(-2048, raw.ay);
+  TEST_ASSERT_EQUAL_INT16(-32768, raw.az); // Clamped at full scale
+  TEST_ASSERT_EQUAL_INT16(6554, raw.gx);
+  TEST_ASSERT_EQUAL_INT16(-16384, raw.gy);
+  TEST_ASSERT_EQUAL_INT16(33, raw.gz);
+  TEST_ASSERT_FLOAT_WITHIN(driver.accelMs2(1), G, driver.accelMs2(raw.ax));
+  TEST_ASSERT_FLOAT_WITHIN(driver.gyroRads(1), -250 * DEG, driver.gyroRads(raw.gy));
+}
+
+// 25 samples take one count read and three chunk reads of 10, 10 and 5 frames
+void test_fifo_drains_in_order_across_chunks() {
+  Mpu6050Sim chip;
+  Driver driver(chip);
+  TEST_ASSERT_TRUE(startDriver(chip, driver, true));
+  for (int i = 0; i < 25; i++) {
+    pushSample(chip, i);
+  }
+  TEST_ASSERT_EQUAL_size_t(25 * MPU6050_FRAME_BYTES, chip.fifoSize());
+  TEST_ASSERT_EQUAL(25 * MPU6050_FRAME_BYTES, driver.fifoCount());
+
+  chip.resetCounters();
+  Mpu6050Raw raw[32];
+  TEST_ASSERT_EQUAL_size_t(25, driver.readFifo(raw, 32));
+  TEST_ASSERT_EQUAL_UINT32(1 + 3, chip.transactions());
+  for (int i = 0; i < 25; i++) {
+    TEST_ASSERT_EQUAL_INT16(i, raw[i].ax);
+    TEST_ASSERT_EQUAL_INT16(2048, raw[i].ay);
+    TEST_ASSERT_EQUAL_INT16(-4096, raw[i].az);
+    TEST_ASSERT_EQUAL_INT16(66, raw[i].gy);
+    TEST_ASSERT_EQUAL_INT16(-i, raw[i].gz);
+  }
+  TEST_ASSERT_EQUAL_size_t(0, chip.fifoSize());
+  TEST_ASSERT_EQUAL_size_t(0, driver.readFifo(raw, 32));
+}
+
+// A short buffer takes the oldest samples and leaves the rest for the next drain
+void test_fifo_read_stops_at_max() {
+  Mpu6050Sim chip;
+  Driver driver(chip);
+  TEST_ASSERT_TRUE(startDriver(chip, driver, true));
+  for (int i = 0; i < 25; i++) {
+    pushSample(chip, i);
+  }
+  Mpu6050Raw raw[12];
+  TEST_ASSERT_EQUAL_size_t(12, driver.readFifo(raw, 12));
+  TEST_ASSERT_EQUAL_INT16(11, raw[11].ax);
+  TEST_ASSERT_EQUAL_size_t(12, driver.readFifo(raw, 12));
+  TEST_ASSERT_EQUAL_INT16(12, raw[0].ax);
+  TEST_ASSERT_EQUAL_size_t(1, driver.readFifo(raw, 12));
+  TEST_ASSERT_EQUAL_INT16(24, raw[0].ax);
+}
+
+// 90 frames overrun the 1 KB FIFO, which then starts mid-frame: the driver resets
+// it and counts the overflow, and reads line up again afterwards
+void test_fifo_overflow_resets_and_counts() {
+  Mpu6050Sim chip;
+  Driver driver(chip);
+  TEST_ASSERT_TRUE(startDriver(chip, driver, true));
+  for (int i = 0; i < 90; i++) {
+    pushSample(chip, i);
+  }
+  TEST_ASSERT_EQUAL_size_t(MPU6050_FIFO_BYTES, chip.fifoSize());
+  Mpu6050Raw raw[16];
+  TEST_ASSERT_EQUAL_size_t(0, driver.readFifo(raw, 16));
+  TEST_ASSERT_EQUAL_UINT32(1, driver.fifoOverflows());
+  TEST_ASSERT_EQUAL_size_t(0, chip.fifoSize());
+
+  for (int i = 100; i < 104; i++) {
+    pushSample(chip, i);
+  }
+  TEST_ASSERT_EQUAL_size_t(4, driver.readFifo(raw, 16));
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL_INT16(100 + i, raw[i].ax);
+    TEST_ASSERT_EQUAL_INT16(-(100 + i), raw[i].gz);
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, driver.fifoOverflows());
+}
+
+// Just under the limit is still read whole
+void test_nearly_full_fifo_is_read() {
+  Mpu6050Sim chip;
+  Driver driver(chip);
+  TEST_ASSERT_TRUE(startDriver(chip, driver, true));
+  for (int i = 0; i < 84; i++) {
+    pushSample(chip, i);
+  }
+  Mpu6050Raw raw[84];
+  TEST_ASSERT_EQUAL_size_t(84, driver.readFifo(raw, 84));
+  TEST_ASSERT_EQUAL_INT16(83, raw[83].ax);
+  TEST_ASSERT_EQUAL_UINT32(0, driver.fifoOverflows());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_begin_configures_the_chip);
+  RUN_TEST(test_sleeping_chip_latches_nothing);
+  RUN_TEST(test_read_burst_decodes_counts);
+  RUN_TEST(test_fifo_drains_in_order_across_chunks);
+  RUN_TEST(test_fifo_read_stops_at_max);
+  RUN_TEST(test_fifo_overflow_resets_and_counts);
+  RUN_TEST(test_nearly_full_fifo_is_read);
+  return UNITY_END();
+}
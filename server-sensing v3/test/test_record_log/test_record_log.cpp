@@ -0,0 +1,282 @@
+// RecordLog over FileLogStorage in a scratch directory: records roll over into new
+// segments, the oldest segment goes when the cap is reached, a torn or corrupted
+// record is caught by its CRC and skipped, a failed append doesn't hide the
+// records after it, and the committed cursor survives a reopen, falling back to
+// the other slot if the newest copy is damaged.
+// Run with:  pio test -e native -f test_record_log
+
+#include <unity.h>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <RecordLog.h>
+
+// 10-byte payloads are 14 bytes stored, so four fit a 64-byte segment
+static const uint32_t SEGMENT_BYTES = 64;
+static const uint8_t PAYLOAD = 10;
+
+static char dir[64];
+
+void setUp() {
+  strcpy(dir, "/tmp/test_record_log.XXXXXX");
+  TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+}
+
+void tearDown() {
+  DIR* d = opendir(dir);
+  if (d != nullptr) {
+    struct dirent* entry;
+    while ((entry = readdir(d)) != nullptr) {
+      if (entry->d_name[0] != '.') {
+        char path[sizeof(dir) + sizeof(entry->d_name) + 1];
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        unlink(path);
+      }
+    }
+    closedir(d);
+  }
+  rmdir(dir);
+}
+
+static void segmentPath(uint32_t segment, char* out, size_t outLen) {
+  snprintf(out, outLen, "%s/%08lu.log", dir, (unsigned long)segment);
+}
+
+static void appendRecords(RecordLog& log, int first, int count) {
+  uint8_t payload[PAYLOAD];
+  for (int i = first; i < first + count; i++) {
+    memset(payload, i, sizeof(payload));
+    TEST_ASSERT_TRUE(log.append(payload, sizeof(payload)));
+  }
+  TEST_ASSERT_TRUE(log.sync());
+}
+
+// Reads from cursor until the log runs out, checking each record is the next
+// expected one; returns how many were read
+static int readRecords(RecordLog& log, LogCursor& cursor, int first) {
+  uint8_t payload[RecordLog::MAX_RECORD];
+  uint8_t len;
+  int n = 0;
+  while (log.read(cursor, payload, sizeof(payload), len)) {
+    TEST_ASSERT_EQUAL_UINT8(PAYLOAD, len);
+    TEST_ASSERT_EQUAL_UINT8(first + n, payload[0]);
+    TEST_ASSERT_EQUAL_UINT8(first + n, payload[PAYLOAD - 1]);
+    n++;
+  }
+  return n;
+}
+
+void test_records_roll_into_new_segments() {
+  FileLogStorage storage(dir);
+  TEST_ASSERT_TRUE(storage.begin());
+  RecordLog log(storage, SEGMENT_BYTES, 8);
+  TEST_ASSERT_TRUE(log.begin());
+  TEST_ASSERT_TRUE(log.empty());
+
+  appendRecords(log, 0, 10);
+  TEST_ASSERT_EQUAL_UINT32(10, log.recordsWritten());
+  TEST_ASSERT_EQUAL_UINT32(3, log.segmentsInUse());
+  TEST_ASSERT_EQUAL_INT32(56, storage.size(0));
+  TEST_ASSERT_EQUAL_INT32(56, storage.size(1));
+  TEST_ASSERT_EQUAL_INT32(28, storage.size(2));
+
+  LogCursor cursor = log.tail();
+  TEST_ASSERT_EQUAL(10, readRecords(log, cursor, 0));
+  TEST_ASSERT_EQUAL_UINT32(2, cursor.segment);
+
+  // Committing past a segment deletes it
+  TEST_ASSERT_TRUE(log.commit(cursor));
+  TEST_ASSERT_TRUE(log.empty());
+  TEST_ASSERT_EQUAL_INT32(-1, storage.size(0));
+  TEST_ASSERT_EQUAL_INT32(-1, storage.size(1));
+  TEST_ASSERT_EQUAL_UINT32(1, log.segmentsInUse());
+}
+
+void test_oldest_segment_is_dropped_at_the_cap() {
+  FileLogStorage storage(dir);
+  TEST_ASSERT_TRUE(storage.begin());
+  RecordLog log(storage, SEGMENT_BYTES, 3);
+  TEST_ASSERT_TRUE(log.begin());
+
+  appendRecords(log, 0, 20); // Five segments' worth into three
+  TEST_ASSERT_EQUAL_UINT32(2, log.droppedSegments());
+  TEST_ASSERT_EQUAL_UINT32(3, log.segmentsInUse());
+  TEST_ASSERT_EQUAL_UINT32(2, log.tail().segment);
+  TEST_ASSERT_EQUAL_INT32(-1, storage.size(1));
+
+  LogCursor cursor = log.tail();
+  TEST_ASSERT_EQUAL(12, readRecords(log, cursor, 8));
+}
+
+// A reset mid-append leaves part of a record at the end of the head segment: the
+// reopened log starts a fresh segment and readers step over the torn bytes
+void test_torn_write_is_skipped_after_reopen() {
+  {
+    FileLogStorage storage(dir);
+    TEST_ASSERT_TRUE(storage.begin());
+    RecordLog log(storage, SEGMENT_BYTES, 8);
+    TEST_ASSERT_TRUE(log.begin());
+    appendRecords(log, 0, 3);
+  }
+  char path[128];
+  segmentPath(0, path, sizeof(path));
+  TEST_ASSERT_EQUAL(0, truncate(path, 3 * 14 - 5)); // Last record loses its tail and CRC
+
+  FileLogStorage storage(dir);
+  TEST_ASSERT_TRUE(storage.begin());
+  RecordLog log(storage, SEGMENT_BYTES, 8);
+  TEST_ASSERT_TRUE(log.begin());
+  appendRecords(log, 2, 2); // Record 2 again, then 3, in segment 1
+  TEST_ASSERT_EQUAL_INT32(28, storage.size(1));
+
+  LogCursor cursor = log.tail();
+  TEST_ASSERT_EQUAL(4, readRecords(log, cursor, 0));
+  TEST_ASSERT_EQUAL_UINT32(1, cursor.segment);
+}
+
+// A flipped byte inside an older segment fails that record's CRC; the rest of the
+// segment can't be trusted for framing, so reading resumes at the next segment
+void test_corrupted_record_fails_its_crc() {
+  FileLogStorage storage(dir);
+  TEST_ASSERT_TRUE(storage.begin());
+  RecordLog log(storage, SEGMENT_BYTES, 8);
+  TEST_ASSERT_TRUE(log.begin());
+  appendRecords(log, 0, 6);
+
+  char path[128];
+  segmentPath(0, path, sizeof(path));
+  FILE* f = fopen(path, "r+b");
+  TEST_ASSERT_NOT_NULL(f);
+  fseek(f, 14 + 2 + 4, SEEK_SET); // Payload of record 1
+  fputc(0xEE, f);
+  fclose(f);
+
+  LogCursor cursor = log.tail();
+  uint8_t payload[RecordLog::MAX_RECORD];
+  uint8_t len;
+  const uint8_t expected[] = {0, 4, 5};
+  for (uint8_t id : expected) {
+    TEST_ASSERT_TRUE(log.read(cursor, payload, sizeof(payload), len));
+    TEST_ASSERT_EQUAL_UINT8(id, payload[0]);
+  }
+  TEST_ASSERT_FALSE(log.read(cursor, payload, sizeof(payload), len));
+}
+
+// Writes only part of the next append and reports failure, like a full flash
+class TornAppendStorage : public FileLogStorage {
+public:
+  TornAppendStorage(const char* directory) : FileLogStorage(directory) {}
+  bool tearNext = false;
+
+  bool append(uint32_t segment, const uint8_t* data, size_t len) override {
+    if (tearNext) {
+      tearNext = false;
+      FileLogStorage::append(segment, data, len / 2);
+      return false;
+    }
+    return FileLogStorage::append(segment, data, len);
+  }
+};
+
+// A failed append that left bytes behind moves the log on to a fresh segment, so
+// the records after it stay readable
+void test_failed_append_starts_a_fresh_segment() {
+  TornAppendStorage storage(dir);
+  TEST_ASSERT_TRUE(storage.begin());
+  RecordLog log(storage, SEGMENT_BYTES, 8);
+  TEST_ASSERT_TRUE(log.begin());
+  appendRecords(log, 0, 2);
+
+  uint8_t payload[PAYLOAD];
+  memset(payload, 0xEE, sizeof(payload));
+  storage.tearNext = true;
+  TEST_ASSERT_FALSE(log.append(payload, sizeof(payload)));
+  TEST_ASSERT_EQUAL_INT32(2 * 14 + 7, storage.size(0));
+  appendRecords(log, 2, 2);
+  TEST_ASSERT_EQUAL_INT32(28, storage.size(1));
+
+  LogCursor cursor = log.tail();
+  TEST_ASSERT_EQUAL(4, readRecords(log, cursor, 0));
+}
+
+void test_cursor_survives_reopen() {
+  LogCursor cursor;
+  {
+    FileLogStorage storage(dir);
+    TEST_ASSERT_TRUE(storage.begin());
+    RecordLog log(storage, SEGMENT_BYTES, 8);
+    TEST_ASSERT_TRUE(log.begin());
+    appendRecords(log, 0, 7);
+    cursor = log.tail();
+    uint8_t payload[RecordLog::MAX_RECORD];
+    uint8_t len;
+    for (int i = 0; i < 5; i++) {
+      TEST_ASSERT_TRUE(log.read(cursor, payload, sizeof(payload), len));
+    }
+    TEST_ASSERT_TRUE(log.commit(cursor));
+  }
+
+  FileLogStorage storage(dir);
+  TEST_ASSERT_TRUE(storage.begin());
+  RecordLog log(storage, SEGMENT_BYTES, 8);
+  TEST_ASSERT_TRUE(log.begin());
+  TEST_ASSERT_EQUAL_UINT32(cursor.segment, log.tail().segment);
+  TEST_ASSERT_EQUAL_UINT32(cursor.offset, log.tail().offset);
+  LogCursor reopened = log.tail();
+  TEST_ASSERT_EQUAL(2, readRecords(log, reopened, 5));
+
+  // New records go after the old ones
+  appendRecords(log, 7, 2);
+  TEST_ASSERT_EQUAL(2, readRecords(log, reopened, 7));
+}
+
+// Commits alternate between two slots; a damaged newest copy falls back to the
+// one before it instead of losing the cursor
+void test_damaged_cursor_slot_falls_back() {
+  LogCursor first;
+  {
+    FileLogStorage storage(dir);
+    TEST_ASSERT_TRUE(storage.begin());
+    RecordLog log(storage, SEGMENT_BYTES, 8);
+    TEST_ASSERT_TRUE(log.begin());
+    appendRecords(log, 0, 3);
+    LogCursor cursor = log.tail();
+    uint8_t payload[RecordLog::MAX_RECORD];
+    uint8_t len;
+    TEST_ASSERT_TRUE(log.read(cursor, payload, sizeof(payload), len));
+    TEST_ASSERT_TRUE(log.commit(cursor)); // seq 1, slot 1
+    first = cursor;
+    TEST_ASSERT_TRUE(log.read(cursor, payload, sizeof(payload), len));
+    TEST_ASSERT_TRUE(log.commit(cursor)); // seq 2, slot 0
+  }
+  char path[128];
+  snprintf(path, sizeof(path), "%s/cursor0", dir);
+  FILE* f = fopen(path, "r+b");
+  TEST_ASSERT_NOT_NULL(f);
+  fputc(0x55, f);
+  fclose(f);
+
+  FileLogStorage storage(dir);
+  TEST_ASSERT_TRUE(storage.begin());
+  RecordLog log(storage, SEGMENT_BYTES, 8);
+  TEST_ASSERT_TRUE(log.begin());
+  TEST_ASSERT_EQUAL_UINT32(first.offset, log.tail().offset);
+  LogCursor cursor = log.tail();
+  TEST_ASSERT_EQUAL(2, readRecords(log, cursor, 1));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_records_roll_into_new_segments);
+  RUN_TEST(test_oldest_segment_is_dropped_at_the_cap);
+  RUN_TEST(test_torn_write_is_skipped_after_reopen);
+  RUN_TEST(test_corrupted_record_fails_its_crc);
+  RUN_TEST(test_failed_append_starts_a_fresh_segment);
+  RUN_TEST(test_cursor_survives_reopen);
+  RUN_TEST(test_damaged_cursor_slot_falls_back);
+  return UNITY_END();
+}
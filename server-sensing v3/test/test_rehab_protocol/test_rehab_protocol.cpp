@@ -0,0 +1,384 @@
+// RehabProtocol encode/parse: every frame type round-trips, truncated, oversize and
+// wrong-version input is rejected, and a bounded random-mutation loop checks that
+// nothing accepted by parse() makes an accessor read past the frame.
+// Run with:  pio test -e native -f test_rehab_protocol
+
+#include <unity.h>
+
+#include <random>
+#include <string.h>
+
+#include <RehabProtocol.h>
+
+void setUp() {}
+
+void tearDown() {}
+
+static SampleFrame makeSample() {
+  SampleFrame s;
+  s.seq = 0xBEEF;
+  s.timestampMs = 0x89ABCDEFUL;
+  s.angle = -123.45f;
+  s.bendCount = 70000;
+  s.flags = SAMPLE_FLAG_BEND | SAMPLE_FLAG_TIME_SYNCED;
+  return s;
+}
+
+static RepFrame makeRep() {
+  RepFrame r;
+  r.seq = 7;
+  r.rep = 12;
+  r.durationMs = 2500;
+  r.romDeg = 87.65f;
+  r.peakVelocityDps = 120.3f;
+  r.meanVelocityDps = 45.6f;
+  r.tensionMs = 1800;
+  r.cadenceRpm = 14.2f;
+  r.sessionMeanRomDeg = 85.01f;
+  r.consistency = 93;
+  return r;
+}
+
+static ConfigFrame makeConfig() {
+  ConfigFrame c;
+  c.seq = 3;
+  c.thresholdMultiplier = 1.25f;
+  c.minDifference = 0.05f;
+  c.angleChangeTolerance = 2.5f;
+  c.inactivityTimeoutS = 300;
+  c.uploadIntervalMinMs = 1000;
+  c.uploadIntervalMaxMs = 60000;
+  c.recordRateMinHz = 1;
+  c.recordRateMaxHz = 20;
+  c.streamRateMinHz = 2;
+  c.streamRateMaxHz = 50;
+  c.activeRateDps = 15.5f;
+  c.rssiFloorDbm = -80;
+  c.latencyCeilingMs = 1500;
+  c.flags = CONFIG_FLAG_ADAPTIVE;
+  return c;
+}
+
+void test_sample_round_trip() {
+  uint8_t buf[SAMPLE_FRAME_BYTES];
+  SampleFrame in = makeSample();
+  TEST_ASSERT_EQUAL(SAMPLE_FRAME_BYTES, encodeSampleFrame(in, buf, sizeof(buf)));
+  FrameView view(buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(PARSE_OK, view.parse());
+  TEST_ASSERT_EQUAL(FRAME_SAMPLE, view.type());
+  SampleFrame out;
+  view.toSample(out);
+  TEST_ASSERT_EQUAL_UINT16(in.seq, out.seq);
+  TEST_ASSERT_EQUAL_UINT32(in.timestampMs, out.timestampMs);
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, in.angle, out.angle);
+  TEST_ASSERT_EQUAL_UINT32(in.bendCount, out.bendCount);
+  TEST_ASSERT_EQUAL_UINT8(in.flags, out.flags);
+}
+
+void test_sample_angle_clamps_to_the_wire_range() {
+  uint8_t buf[SAMPLE_FRAME_BYTES];
+  SampleFrame in = makeSample();
+  in.angle = 1000.0f;
+  encodeSampleFrame(in, buf, sizeof(buf));
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, 327.67f, FrameView(buf, sizeof(buf)).angle());
+  in.angle = -1000.0f;
+  encodeSampleFrame(in, buf, sizeof(buf));
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, -327.68f, FrameView(buf, sizeof(buf)).angle());
+}
+
+void test_status_round_trip_and_cut_to_max_frame() {
+  uint8_t buf[MAX_FRAME_BYTES + 16];
+  size_t n = encodeStatusFrame(9, "WiFi connected", buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(FRAME_HEADER_BYTES + 14, n);
+  FrameView view(buf, n);
+  TEST_ASSERT_EQUAL(PARSE_OK, view.parse());
+  TEST_ASSERT_EQUAL(FRAME_STATUS, view.type());
+  TEST_ASSERT_EQUAL(14, view.statusLength());
+  TEST_ASSERT_EQUAL_MEMORY("WiFi connected", view.statusText(), 14);
+
+  char longText[400];
+  memset(longText, 'x', sizeof(longText) - 1);
+  longText[sizeof(longText) - 1] = '\0';
+  n = encodeStatusFrame(10, longText, buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(MAX_FRAME_BYTES, n);
+  TEST_ASSERT_EQUAL(PARSE_OK, FrameView(buf, n).parse());
+}
+
+void test_stream_round_trip() {
+  StreamSample in[80];
+  for (size_t i = 0; i < 80; i++) {
+    in[i].timestampMs = 0xFFFFFF00UL + i * 20; // Crosses the u32 wrap
+    in[i].angle = -40.0f + i * 1.01f;
+  }
+  uint8_t buf[MAX_FRAME_BYTES];
+  size_t packed;
+  size_t n = encodeStreamFrame(5, in, 80, buf, sizeof(buf), packed);
+  // 244-byte frame: 9 header bytes, then 58 samples of 4 bytes
+  TEST_ASSERT_EQUAL(58, packed);
+  TEST_ASSERT_EQUAL(9 + 58 * 4, n);
+  FrameView view(buf, n);
+  TEST_ASSERT_EQUAL(PARSE_OK, view.parse());
+  TEST_ASSERT_EQUAL(58, view.streamCount());
+  for (size_t i = 0; i < packed; i++) {
+    StreamSample out;
+    view.streamSample(i, out);
+    TEST_ASSERT_EQUAL_UINT32(in[i].timestampMs, out.timestampMs);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, in[i].angle, out.angle);
+  }
+}
+
+void test_stream_splits_at_the_offset_range() {
+  StreamSample in[3] = {{1000, 1}, {1000 + 0xFFFF, 2}, {1000 + 0x10000, 3}};
+  uint8_t buf[MAX_FRAME_BYTES];
+  size_t packed;
+  encodeStreamFrame(1, in, 3, buf, sizeof(buf), packed);
+  TEST_ASSERT_EQUAL(2, packed);
+}
+
+void test_rep_round_trip() {
+  uint8_t buf[REP_FRAME_BYTES];
+  RepFrame in = makeRep();
+  TEST_ASSERT_EQUAL(REP_FRAME_BYTES, encodeRepFrame(in, buf, sizeof(buf)));
+  FrameView view(buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(PARSE_OK, view.parse());
+  TEST_ASSERT_EQUAL(FRAME_REP, view.type());
+  RepFrame out;
+  view.toRep(out);
+  TEST_ASSERT_EQUAL_UINT16(in.seq, out.seq);
+  TEST_ASSERT_EQUAL_UINT16(in.rep, out.rep);
+  TEST_ASSERT_EQUAL_UINT16(in.durationMs, out.durationMs);
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, in.romDeg, out.romDeg);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, in.peakVelocityDps, out.peakVelocityDps);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, in.meanVelocityDps, out.meanVelocityDps);
+  TEST_ASSERT_EQUAL_UINT16(in.tensionMs, out.tensionMs);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, in.cadenceRpm, out.cadenceRpm);
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, in.sessionMeanRomDeg, out.sessionMeanRomDeg);
+  TEST_ASSERT_EQUAL_UINT8(in.consistency, out.consistency);
+}
+
+// A default-MTU link gets the REP frame without its last byte
+void test_rep_compact_frame() {
+  uint8_t buf[REP_FRAME_BYTES];
+  RepFrame in = makeRep();
+  TEST_ASSERT_EQUAL(REP_COMPACT_FRAME_BYTES, encodeRepFrame(in, buf, REP_COMPACT_FRAME_BYTES));
+  TEST_ASSERT_EQUAL(20, REP_COMPACT_FRAME_BYTES);
+  FrameView view(buf, REP_COMPACT_FRAME_BYTES);
+  TEST_ASSERT_EQUAL(PARSE_OK, view.parse());
+  RepFrame out;
+  view.toRep(out);
+  TEST_ASSERT_EQUAL_UINT16(in.rep, out.rep);
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, in.sessionMeanRomDeg, out.sessionMeanRomDeg);
+  TEST_ASSERT_EQUAL_UINT8(REP_CONSISTENCY_UNKNOWN, out.consistency);
+}
+
+void test_config_round_trip() {
+  uint8_t buf[CONFIG_FRAME_BYTES];
+  ConfigFrame in = makeConfig();
+  TEST_ASSERT_EQUAL(CONFIG_FRAME_BYTES, encodeConfigFrame(in, buf, sizeof(buf)));
+  FrameView view(buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(PARSE_OK, view.parse());
+  TEST_ASSERT_EQUAL(FRAME_CONFIG, view.type());
+  ConfigFrame out;
+  view.toConfig(out);
+  TEST_ASSERT_EQUAL_UINT16(in.seq, out.seq);
+  TEST_ASSERT_FLOAT_WITHIN(0.0005f, in.thresholdMultiplier, out.thresholdMultiplier);
+  TEST_ASSERT_FLOAT_WITHIN(0.0005f, in.minDifference, out.minDifference);
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, in.angleChangeTolerance, out.angleChangeTolerance);
+  TEST_ASSERT_EQUAL_UINT16(in.inactivityTimeoutS, out.inactivityTimeoutS);
+  TEST_ASSERT_EQUAL_UINT32(in.uploadIntervalMinMs, out.uploadIntervalMinMs);
+  TEST_ASSERT_EQUAL_UINT32(in.uploadIntervalMaxMs, out.uploadIntervalMaxMs);
+  TEST_ASSERT_EQUAL_UINT8(in.recordRateMinHz, out.recordRateMinHz);
+  TEST_ASSERT_EQUAL_UINT8(in.recordRateMaxHz, out.recordRateMaxHz);
+  TEST_ASSERT_EQUAL_UINT8(in.streamRateMinHz, out.streamRateMinHz);
+  TEST_ASSERT_EQUAL_UINT8(in.streamRateMaxHz, out.streamRateMaxHz);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, in.activeRateDps, out.activeRateDps);
+  TEST_ASSERT_EQUAL_INT(in.rssiFloorDbm, out.rssiFloorDbm);
+  TEST_ASSERT_EQUAL_UINT16(in.latencyCeilingMs, out.latencyCeilingMs);
+  TEST_ASSERT_EQUAL_UINT8(in.flags, out.flags);
+}
+
+void test_encoders_refuse_short_buffers() {
+  uint8_t buf[MAX_FRAME_BYTES];
+  TEST_ASSERT_EQUAL(0, encodeSampleFrame(makeSample(), buf, SAMPLE_FRAME_BYTES - 1));
+  TEST_ASSERT_EQUAL(0, encodeRepFrame(makeRep(), buf, REP_COMPACT_FRAME_BYTES - 1));
+  TEST_ASSERT_EQUAL(0, encodeConfigFrame(makeConfig(), buf, CONFIG_FRAME_BYTES - 1));
+  TEST_ASSERT_EQUAL(0, encodeStatusFrame(1, "x", buf, FRAME_HEADER_BYTES - 1));
+  StreamSample s = {0, 0};
+  size_t packed;
+  TEST_ASSERT_EQUAL(0, encodeStreamFrame(1, &s, 1, buf, FRAME_HEADER_BYTES + STREAM_PAYLOAD_HEADER_BYTES + 3, packed));
+  TEST_ASSERT_EQUAL(0, packed);
+}
+
+// Every strict prefix of a fixed-size frame is refused, bar the compact REP length
+void test_truncated_frames_are_rejected() {
+  uint8_t buf[MAX_FRAME_BYTES];
+  size_t sizes[3];
+  uint8_t frames[3][MAX_FRAME_BYTES];
+  sizes[0] = encodeSampleFrame(makeSample(), frames[0], sizeof(frames[0]));
+  sizes[1] = encodeRepFrame(makeRep(), frames[1], sizeof(frames[1]));
+  sizes[2] = encodeConfigFrame(makeConfig(), frames[2], sizeof(frames[2]));
+  for (int f = 0; f < 3; f++) {
+    for (size_t n = 0; n < sizes[f]; n++) {
+      memcpy(buf, frames[f], n);
+      ParseResult r = FrameView(buf, n).parse();
+      if (f == 1 && n == REP_COMPACT_FRAME_BYTES) {
+        TEST_ASSERT_EQUAL(PARSE_OK, r);
+        continue;
+      }
+      TEST_ASSERT_EQUAL(n < FRAME_HEADER_BYTES ? PARSE_TOO_SHORT : PARSE_BAD_LENGTH, r);
+    }
+  }
+
+  StreamSample samples[4] = {{0, 1}, {10, 2}, {20, 3}, {30, 4}};
+  size_t packed;
+  size_t n = encodeStreamFrame(1, samples, 4, buf, sizeof(buf), packed);
+  for (size_t cut = FRAME_HEADER_BYTES; cut < n; cut++) {
+    TEST_ASSERT_EQUAL(PARSE_BAD_LENGTH, FrameView(buf, cut).parse());
+  }
+  TEST_ASSERT_EQUAL(PARSE_TOO_SHORT, FrameView(nullptr, 0).parse());
+}
+
+void test_oversize_frames() {
+  uint8_t buf[MAX_FRAME_BYTES + 1];
+  memset(buf, 0, sizeof(buf));
+  // Fixed-size frames may grow in later minor revisions; the extra is ignored
+  encodeSampleFrame(makeSample(), buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(PARSE_OK, FrameView(buf, SAMPLE_FRAME_BYTES + 8).parse());
+  // Status text longer than one notification can't have come from a server
+  encodeStatusFrame(1, "x", buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(PARSE_OK, FrameView(buf, MAX_FRAME_BYTES).parse());
+  TEST_ASSERT_EQUAL(PARSE_BAD_LENGTH, FrameView(buf, MAX_FRAME_BYTES + 1).parse());
+  // A stream count larger than the bytes that follow
+  StreamSample s = {0, 1};
+  size_t packed;
+  size_t n = encodeStreamFrame(1, &s, 1, buf, sizeof(buf), packed);
+  buf[8] = 2;
+  TEST_ASSERT_EQUAL(PARSE_BAD_LENGTH, FrameView(buf, n).parse());
+}
+
+void test_wrong_version_and_type() {
+  uint8_t buf[SAMPLE_FRAME_BYTES];
+  encodeSampleFrame(makeSample(), buf, sizeof(buf));
+  buf[0] = PROTOCOL_VERSION + 1;
+  TEST_ASSERT_EQUAL(PARSE_BAD_VERSION, FrameView(buf, sizeof(buf)).parse());
+  buf[0] = 0;
+  TEST_ASSERT_EQUAL(PARSE_BAD_VERSION, FrameView(buf, sizeof(buf)).parse());
+  buf[0] = PROTOCOL_VERSION;
+  buf[1] = 0;
+  TEST_ASSERT_EQUAL(PARSE_BAD_TYPE, FrameView(buf, sizeof(buf)).parse());
+  buf[1] = FRAME_CONFIG + 1;
+  TEST_ASSERT_EQUAL(PARSE_BAD_TYPE, FrameView(buf, sizeof(buf)).parse());
+}
+
+// Decodes whatever parse() accepted into a summary of every accessor's result
+static uint32_t decodeAll(const uint8_t* data, size_t length) {
+  FrameView view(data, length);
+  if (view.parse() != PARSE_OK) {
+    return 0;
+  }
+  uint32_t h = view.seq();
+  switch (view.type()) {
+    case FRAME_SAMPLE: {
+      SampleFrame s;
+      view.toSample(s);
+      h = h * 31 + s.timestampMs + s.bendCount + s.flags + (uint32_t)(int32_t)(s.angle * 100);
+      break;
+    }
+    case FRAME_STREAM:
+      for (size_t i = 0; i < view.streamCount(); i++) {
+        StreamSample s;
+        view.streamSample(i, s);
+        h = h * 31 + s.timestampMs + (uint32_t)(int32_t)(s.angle * 100);
+      }
+      break;
+    case FRAME_STATUS:
+      for (size_t i = 0; i < view.statusLength(); i++) {
+        h = h * 31 + (uint8_t)view.statusText()[i];
+      }
+      break;
+    case FRAME_REP: {
+      RepFrame r;
+      view.toRep(r);
+      h = h * 31 + r.rep + r.durationMs + r.tensionMs + r.consistency + (uint32_t)(r.romDeg * 100) +
+          (uint32_t)(r.sessionMeanRomDeg * 100) + (uint32_t)(r.cadenceRpm * 10) +
+          (uint32_t)(r.peakVelocityDps * 10) + (uint32_t)(r.meanVelocityDps * 10);
+      break;
+    }
+    case FRAME_CONFIG: {
+      ConfigFrame c;
+      view.toConfig(c);
+      h = h * 31 + c.inactivityTimeoutS + c.uploadIntervalMinMs + c.uploadIntervalMaxMs + c.recordRateMinHz +
+          c.recordRateMaxHz + c.streamRateMinHz + c.streamRateMaxHz + (uint8_t)c.rssiFloorDbm +
+          c.latencyCeilingMs + c.flags + (uint32_t)(c.thresholdMultiplier * 1000) +
+          (uint32_t)(c.minDifference * 1000) + (uint32_t)(c.angleChangeTolerance * 100) +
+          (uint32_t)(c.activeRateDps * 10);
+      break;
+    }
+  }
+  return h | 1;
+}
+
+// Mutates valid frames at random and checks that an accepted frame decodes the same
+// whatever follows it in memory, i.e. no accessor reads past length
+void test_random_mutations_stay_inside_the_frame() {
+  std::mt19937 rng(12345);
+  uint8_t seeds[5][MAX_FRAME_BYTES];
+  size_t seedSizes[5];
+  StreamSample stream[40];
+  for (size_t i = 0; i < 40; i++) {
+    stream[i].timestampMs = 1000 + i * 50;
+    stream[i].angle = (float)i;
+  }
+  size_t packed;
+  seedSizes[0] = encodeSampleFrame(makeSample(), seeds[0], MAX_FRAME_BYTES);
+  seedSizes[1] = encodeStatusFrame(1, "Connecting to WiFi", seeds[1], MAX_FRAME_BYTES);
+  seedSizes[2] = encodeStreamFrame(2, stream, 40, seeds[2], MAX_FRAME_BYTES, packed);
+  seedSizes[3] = encodeRepFrame(makeRep(), seeds[3], MAX_FRAME_BYTES);
+  seedSizes[4] = encodeConfigFrame(makeConfig(), seeds[4], MAX_FRAME_BYTES);
+
+  uint8_t a[MAX_FRAME_BYTES * 2];
+  uint8_t b[MAX_FRAME_BYTES * 2];
+  uint32_t accepted = 0;
+  for (int iter = 0; iter < 200000; iter++) {
+    int f = rng() % 5;
+    size_t length = seedSizes[f];
+    memcpy(a, seeds[f], length);
+    int mutations = 1 + rng() % 4;
+    for (int m = 0; m < mutations && length > 1; m++) {
+      switch (rng() % 4) {
+        case 0: a[rng() % length] ^= (uint8_t)(1 << (rng() % 8)); break;
+        case 1: a[rng() % length] = (uint8_t)rng(); break;
+        case 2: length = rng() % (length + 1); break;
+        case 3: a[rng() % 2] = (uint8_t)rng(); break; // Version or type
+      }
+    }
+    // Same frame, different bytes after it
+    memcpy(b, a, length);
+    memset(a + length, 0x00, sizeof(a) - length);
+    memset(b + length, 0xFF, sizeof(b) - length);
+    uint32_t ha = decodeAll(a, length);
+    uint32_t hb = decodeAll(b, length);
+    TEST_ASSERT_EQUAL_UINT32(ha, hb);
+    accepted += ha != 0 ? 1 : 0;
+  }
+  // The loop has to exercise the accessors, not only the rejections
+  TEST_ASSERT_GREATER_THAN(10000, accepted);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_sample_round_trip);
+  RUN_TEST(test_sample_angle_clamps_to_the_wire_range);
+  RUN_TEST(test_status_round_trip_and_cut_to_max_frame);
+  RUN_TEST(test_stream_round_trip);
+  RUN_TEST(test_stream_splits_at_the_offset_range);
+  RUN_TEST(test_rep_round_trip);
+  RUN_TEST(test_rep_compact_frame);
+  RUN_TEST(test_config_round_trip);
+  RUN_TEST(test_encoders_refuse_short_buffers);
+  RUN_TEST(test_truncated_frames_are_rejected);
+  RUN_TEST(test_oversize_frames);
+  RUN_TEST(test_wrong_version_and_type);
+  RUN_TEST(test_random_mutations_stay_inside_the_frame);
+  return UNITY_END();
+}
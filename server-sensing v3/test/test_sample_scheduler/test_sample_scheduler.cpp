@@ -0,0 +1,134 @@
+// SampleScheduler under a simulated clock: each job runs at its own rate, lateness
+// is measured against the due time, and falling behind skips periods instead of
+// bursting. Run with:  pio test -e native -f test_sample_scheduler
+
+#include <unity.h>
+
+#include <SampleScheduler.h>
+
+static uint32_t fastRuns, slowRuns, lastRunMicros;
+
+static void fastJob(uint32_t nowMicros) { fastRuns++; lastRunMicros = nowMicros; }
+static void slowJob(uint32_t) { slowRuns++; }
+
+void setUp() {
+  fastRuns = 0;
+  slowRuns = 0;
+  lastRunMicros = 0;
+}
+
+void tearDown() {}
+
+void test_add_job_rejects_bad_jobs() {
+  SampleScheduler s;
+  TEST_ASSERT_EQUAL(-1, s.addJob("zero", 0, fastJob));
+  TEST_ASSERT_EQUAL(-1, s.addJob("none", 1000, nullptr));
+  for (uint8_t i = 0; i < SampleScheduler::MAX_JOBS; i++) {
+    TEST_ASSERT_EQUAL(i, s.addJob("job", 1000, fastJob));
+  }
+  TEST_ASSERT_EQUAL(-1, s.addJob("full", 1000, fastJob));
+}
+
+void test_period_from_hz() {
+  TEST_ASSERT_EQUAL_UINT32(0, periodFromHz(0));
+  TEST_ASSERT_EQUAL_UINT32(5000, periodFromHz(200));
+  TEST_ASSERT_EQUAL_UINT32(1, periodFromHz(2000000));
+}
+
+// Polled every 50 us for a simulated second, like loop() with nothing else to do
+void test_jobs_run_at_their_own_rates() {
+  SampleScheduler s;
+  s.addJob("fast", periodFromHz(200), fastJob);
+  s.addJob("slow", periodFromHz(10), slowJob);
+  for (uint32_t now = 0; now < 1000000; now += 50) {
+    s.run(now);
+  }
+  TEST_ASSERT_EQUAL_UINT32(200, fastRuns);
+  TEST_ASSERT_EQUAL_UINT32(10, slowRuns);
+  TEST_ASSERT_EQUAL_UINT32(0, s.stats(0).missed);
+  TEST_ASSERT_EQUAL_UINT32(0, s.stats(0).maxLateMicros);
+}
+
+// Polling at a step that doesn't divide the period: lateness stays under one step
+// and the fixed-rate schedule doesn't drift
+void test_jitter_is_bounded_by_the_poll_step() {
+  SampleScheduler s;
+  s.addJob("fast", 5000, fastJob);
+  for (uint32_t now = 0; now < 1000000; now += 70) {
+    s.run(now);
+  }
+  const JitterStats& st = s.stats(0);
+  TEST_ASSERT_EQUAL_UINT32(200, st.runs);
+  TEST_ASSERT_EQUAL_UINT32(0, st.missed);
+  TEST_ASSERT_LESS_OR_EQUAL(69, st.maxLateMicros);
+  TEST_ASSERT_GREATER_THAN(0, st.meanLateMicros());
+  TEST_ASSERT_LESS_OR_EQUAL(69, st.meanLateMicros());
+}
+
+void test_stall_skips_periods_instead_of_bursting() {
+  SampleScheduler s;
+  s.addJob("fast", 1000, fastJob);
+  s.run(0);
+  s.run(1000);
+  // 10.5 periods late: one run now, the 10 whole periods are counted as missed
+  s.run(12500);
+  TEST_ASSERT_EQUAL_UINT32(3, fastRuns);
+  TEST_ASSERT_EQUAL_UINT32(10, s.stats(0).missed);
+  TEST_ASSERT_EQUAL_UINT32(10500, s.stats(0).maxLateMicros);
+  // Back on the original grid
+  s.run(12999);
+  TEST_ASSERT_EQUAL_UINT32(3, fastRuns);
+  s.run(13000);
+  TEST_ASSERT_EQUAL_UINT32(4, fastRuns);
+}
+
+void test_runs_across_the_micros_wrap() {
+  SampleScheduler s;
+  s.addJob("fast", 1000, fastJob);
+  uint32_t now = 0xFFFFFFFFUL - 4999;
+  for (int i = 0; i < 200; i++, now += 50) {
+    s.run(now);
+  }
+  TEST_ASSERT_EQUAL_UINT32(10, fastRuns);
+  TEST_ASSERT_EQUAL_UINT32(0, s.stats(0).missed);
+  TEST_ASSERT_EQUAL_UINT32(0, s.stats(0).maxLateMicros);
+}
+
+void test_restart_does_not_count_a_pause_as_missed() {
+  SampleScheduler s;
+  s.addJob("fast", 1000, fastJob);
+  s.run(0);
+  s.restart();
+  s.run(500000);
+  TEST_ASSERT_EQUAL_UINT32(2, fastRuns);
+  TEST_ASSERT_EQUAL_UINT32(0, s.stats(0).missed);
+  TEST_ASSERT_EQUAL_UINT32(500000, lastRunMicros);
+}
+
+void test_set_period_changes_the_rate() {
+  SampleScheduler s;
+  s.addJob("fast", periodFromHz(100), fastJob);
+  for (uint32_t now = 0; now < 500000; now += 100) {
+    s.run(now);
+  }
+  s.setPeriod(0, periodFromHz(20));
+  s.setPeriod(0, 0); // Ignored
+  for (uint32_t now = 500000; now < 1000000; now += 100) {
+    s.run(now);
+  }
+  TEST_ASSERT_EQUAL_UINT32(periodFromHz(20), s.period(0));
+  TEST_ASSERT_EQUAL_UINT32(50 + 10, fastRuns);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_add_job_rejects_bad_jobs);
+  RUN_TEST(test_period_from_hz);
+  RUN_TEST(test_jobs_run_at_their_own_rates);
+  RUN_TEST(test_jitter_is_bounded_by_the_poll_step);
+  RUN_TEST(test_stall_skips_periods_instead_of_bursting);
+  RUN_TEST(test_runs_across_the_micros_wrap);
+  RUN_TEST(test_restart_does_not_count_a_pause_as_missed);
+  RUN_TEST(test_set_period_changes_the_rate);
+  return UNITY_END();
+}
@@ -0,0 +1,174 @@
+// SampleStreamer packing and backpressure: frames fill the negotiated MTU, a full
+// queue drops its oldest samples, and samples stay queued until commit().
+// Run with:  pio test -e native -f test_sample_streamer
+
+#include <unity.h>
+
+#include <SampleStreamer.h>
+
+#define MAX_MTU 247
+#define ATT_HEADER_BYTES 3
+
+static StreamSample sampleAt(uint32_t i) {
+  StreamSample s;
+  s.timestampMs = 10000 + i * 5; // 200 Hz
+  s.angle = (float)(i % 300) - 150.0f;
+  return s;
+}
+
+template <size_t N>
+static void pushRange(SampleStreamer<N>& s, uint32_t from, uint32_t to) {
+  for (uint32_t i = from; i < to; i++) {
+    s.push(sampleAt(i));
+  }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_empty_queue_builds_nothing() {
+  SampleStreamer<64> s;
+  uint8_t frame[MAX_FRAME_BYTES];
+  size_t packed = 99;
+  TEST_ASSERT_EQUAL(0, s.buildFrame(1, frame, sizeof(frame), packed));
+  TEST_ASSERT_EQUAL(0, packed);
+}
+
+void test_frame_fills_the_largest_mtu() {
+  SampleStreamer<256> s;
+  pushRange(s, 0, 200);
+  uint8_t frame[MAX_FRAME_BYTES];
+  size_t packed;
+  size_t n = s.buildFrame(1, frame, MAX_MTU - ATT_HEADER_BYTES, packed);
+  TEST_ASSERT_EQUAL(58, packed);
+  TEST_ASSERT_LESS_OR_EQUAL(MAX_MTU - ATT_HEADER_BYTES, n);
+  TEST_ASSERT_EQUAL(FRAME_HEADER_BYTES + STREAM_PAYLOAD_HEADER_BYTES + 58 * STREAM_SAMPLE_BYTES, n);
+
+  FrameView view(frame, n);
+  TEST_ASSERT_EQUAL(PARSE_OK, view.parse());
+  TEST_ASSERT_EQUAL(58, view.streamCount());
+  for (size_t i = 0; i < packed; i++) {
+    StreamSample out;
+    view.streamSample(i, out);
+    TEST_ASSERT_EQUAL_UINT32(sampleAt(i).timestampMs, out.timestampMs);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, sampleAt(i).angle, out.angle);
+  }
+}
+
+void test_frame_respects_a_small_mtu() {
+  SampleStreamer<64> s;
+  pushRange(s, 0, 40);
+  uint8_t frame[MAX_FRAME_BYTES];
+  size_t packed;
+  // Default 23-byte MTU: 20 bytes of frame, 9 of header, so 2 samples
+  size_t n = s.buildFrame(1, frame, 23 - ATT_HEADER_BYTES, packed);
+  TEST_ASSERT_EQUAL(2, packed);
+  TEST_ASSERT_LESS_OR_EQUAL(20, n);
+  // Larger than a frame can be is clamped, not overrun
+  n = s.buildFrame(1, frame, 1024, packed);
+  TEST_ASSERT_EQUAL(40, packed);
+  TEST_ASSERT_LESS_OR_EQUAL(MAX_FRAME_BYTES, n);
+}
+
+void test_samples_stay_until_commit() {
+  SampleStreamer<64> s;
+  pushRange(s, 0, 10);
+  uint8_t frame[MAX_FRAME_BYTES];
+  size_t packed;
+  s.buildFrame(1, frame, sizeof(frame), packed);
+  // The stack refused the notify: nothing leaves, the same samples go next time
+  s.recordStall();
+  TEST_ASSERT_EQUAL(10, s.size());
+  TEST_ASSERT_EQUAL_UINT32(1, s.stallCount());
+  size_t again;
+  s.buildFrame(2, frame, sizeof(frame), again);
+  TEST_ASSERT_EQUAL(packed, again);
+  StreamSample first;
+  FrameView(frame, sizeof(frame)).streamSample(0, first);
+  TEST_ASSERT_EQUAL_UINT32(sampleAt(0).timestampMs, first.timestampMs);
+
+  s.commit(again);
+  TEST_ASSERT_EQUAL(0, s.size());
+  TEST_ASSERT_EQUAL_UINT32(10, s.sentCount());
+  TEST_ASSERT_EQUAL_UINT32(1, s.framesSent());
+}
+
+void test_partial_commit_keeps_the_rest_in_order() {
+  SampleStreamer<64> s;
+  pushRange(s, 0, 30);
+  s.commit(12);
+  uint8_t frame[MAX_FRAME_BYTES];
+  size_t packed;
+  size_t n = s.buildFrame(1, frame, sizeof(frame), packed);
+  TEST_ASSERT_EQUAL(18, packed);
+  StreamSample first;
+  FrameView(frame, n).streamSample(0, first);
+  TEST_ASSERT_EQUAL_UINT32(sampleAt(12).timestampMs, first.timestampMs);
+  // Committing more than is queued empties it without going negative
+  s.commit(100);
+  TEST_ASSERT_EQUAL(0, s.size());
+}
+
+void test_full_queue_drops_the_oldest() {
+  SampleStreamer<32> s;
+  pushRange(s, 0, 50);
+  TEST_ASSERT_EQUAL(32, s.size());
+  TEST_ASSERT_EQUAL_UINT32(18, s.droppedCount());
+  TEST_ASSERT_EQUAL_UINT32(50, s.pushedCount());
+  uint8_t frame[MAX_FRAME_BYTES];
+  size_t packed;
+  size_t n = s.buildFrame(1, frame, sizeof(frame), packed);
+  TEST_ASSERT_EQUAL(32, packed);
+  FrameView view(frame, n);
+  for (size_t i = 0; i < packed; i++) {
+    StreamSample out;
+    view.streamSample(i, out);
+    TEST_ASSERT_EQUAL_UINT32(sampleAt(18 + i).timestampMs, out.timestampMs);
+  }
+}
+
+// A slow link: 200 Hz in, one 58-sample frame every other 50 ms tick out. Every
+// sample is either sent or counted as dropped, and the sent ones stay in order.
+void test_backpressure_accounts_for_every_sample() {
+  SampleStreamer<128> s;
+  uint8_t frame[MAX_FRAME_BYTES];
+  uint32_t next = 0;
+  uint32_t lastSent = 0;
+  bool anySent = false;
+  for (int tick = 0; tick < 400; tick++) {
+    pushRange(s, next, next + 10);
+    next += 10;
+    if (tick % 2 == 1) {
+      s.recordStall();
+      continue;
+    }
+    size_t packed;
+    size_t n = s.buildFrame((uint16_t)tick, frame, MAX_MTU - ATT_HEADER_BYTES, packed);
+    FrameView view(frame, n);
+    TEST_ASSERT_EQUAL(PARSE_OK, view.parse());
+    for (size_t i = 0; i < packed; i++) {
+      StreamSample out;
+      view.streamSample(i, out);
+      TEST_ASSERT_TRUE(!anySent || out.timestampMs > lastSent);
+      lastSent = out.timestampMs;
+      anySent = true;
+    }
+    s.commit(packed);
+  }
+  TEST_ASSERT_EQUAL_UINT32(next, s.pushedCount());
+  TEST_ASSERT_EQUAL_UINT32(next, s.sentCount() + s.droppedCount() + s.size());
+  TEST_ASSERT_EQUAL_UINT32(200, s.stallCount());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_queue_builds_nothing);
+  RUN_TEST(test_frame_fills_the_largest_mtu);
+  RUN_TEST(test_frame_respects_a_small_mtu);
+  RUN_TEST(test_samples_stay_until_commit);
+  RUN_TEST(test_partial_commit_keeps_the_rest_in_order);
+  RUN_TEST(test_full_queue_drops_the_oldest);
+  RUN_TEST(test_backpressure_accounts_for_every_sample);
+  return UNITY_END();
+}
@@ -0,0 +1,147 @@
+// SensingMath policies against double-precision libm: each policy's atan2, rsqrt
+// and sqrt stay within the error bounds it declares over every quadrant and a wide
+// range of magnitudes, the axes and the origin come out exact, and Q15 arithmetic
+// rounds and sums the way the bend detector relies on.
+// Run with:  pio test -e native -f test_sensing_math
+
+#include <unity.h>
+
+#include <math.h>
+
+#include <SensingMath.h>
+
+void setUp() {}
+
+void tearDown() {}
+
+// Worst atan2 error in degrees on circles from 0.01 to 100, sampled off the axes
+template <typename Math>
+static double worstAtan2Error() {
+  const float radii[] = {0.01f, 1.0f, 9.81f, 100.0f};
+  double worst = 0;
+  for (float r : radii) {
+    for (int i = 0; i < 3600; i++) {
+      double a = (i + 0.37) * M_PI / 1800 - M_PI;
+      float y = (float)(r * sin(a));
+      float x = (float)(r * cos(a));
+      double error = fabs(Math::atan2Deg(y, x) - atan2((double)y, (double)x) * 180 / M_PI);
+      error = error < 360 - error ? error : 360 - error; // +-180 is the same angle
+      worst = error > worst ? error : worst;
+    }
+  }
+  return worst;
+}
+
+// Worst relative rsqrt and sqrt error from 1e-4 to 1e4
+template <typename Math>
+static void worstRootErrors(double& rsqrtError, double& sqrtError) {
+  rsqrtError = 0;
+  sqrtError = 0;
+  for (int i = 0; i < 10000; i++) {
+    float x = (float)pow(10.0, -4 + 8.0 * i / 10000);
+    double exact = sqrt((double)x);
+    double r = fabs(Math::rsqrt(x) * exact - 1);
+    double s = fabs(Math::sqrt(x) / exact - 1);
+    rsqrtError = r > rsqrtError ? r : rsqrtError;
+    sqrtError = s > sqrtError ? s : sqrtError;
+  }
+}
+
+// Errors are non-negative, so "within bound of 0" is "at most bound" with the
+// measured value in the failure message
+template <typename Math>
+static void checkBounds() {
+  TEST_ASSERT_FLOAT_WITHIN(Math::ATAN2_MAX_ERROR_DEG, 0.0f, (float)worstAtan2Error<Math>());
+  double rsqrtError, sqrtError;
+  worstRootErrors<Math>(rsqrtError, sqrtError);
+  TEST_ASSERT_FLOAT_WITHIN(Math::RSQRT_MAX_REL_ERROR, 0.0f, (float)rsqrtError);
+  TEST_ASSERT_FLOAT_WITHIN(Math::RSQRT_MAX_REL_ERROR, 0.0f, (float)sqrtError);
+}
+
+// The octant folding has to land the axes and the origin exactly
+template <typename Math>
+static void checkAxes() {
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, Math::atan2Deg(0.0f, 0.0f));
+  TEST_ASSERT_FLOAT_WITHIN(Math::ATAN2_MAX_ERROR_DEG, 0.0f, Math::atan2Deg(0.0f, 1.0f));
+  TEST_ASSERT_FLOAT_WITHIN(Math::ATAN2_MAX_ERROR_DEG, 90.0f, Math::atan2Deg(1.0f, 0.0f));
+  TEST_ASSERT_FLOAT_WITHIN(Math::ATAN2_MAX_ERROR_DEG, -90.0f, Math::atan2Deg(-1.0f, 0.0f));
+  TEST_ASSERT_FLOAT_WITHIN(Math::ATAN2_MAX_ERROR_DEG, 180.0f, fabsf(Math::atan2Deg(0.0f, -1.0f)));
+  TEST_ASSERT_FLOAT_WITHIN(Math::ATAN2_MAX_ERROR_DEG, 45.0f, Math::atan2Deg(2.0f, 2.0f));
+  TEST_ASSERT_FLOAT_WITHIN(Math::ATAN2_MAX_ERROR_DEG, -135.0f, Math::atan2Deg(-2.0f, -2.0f));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, Math::sqrt(0.0f));
+}
+
+void test_float_math_bounds() {
+  checkBounds<FloatMath>();
+  checkAxes<FloatMath>();
+}
+
+void test_poly_math_bounds() {
+  checkBounds<PolyMath>();
+  checkAxes<PolyMath>();
+}
+
+void test_lut_math_bounds() {
+  checkBounds<LutMath>();
+  checkAxes<LutMath>();
+}
+
+void test_q15_math_bounds() {
+  checkBounds<Q15Math>();
+  checkAxes<Q15Math>();
+}
+
+void test_atan_table_matches_libm() {
+  for (size_t i = 0; i <= LutMath::ATAN_STEPS; i++) {
+    double expected = atan((double)i / LutMath::ATAN_STEPS) * 180 / M_PI;
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, expected, LutMath::table.deg[i]);
+  }
+}
+
+void test_q15_rounds_to_nearest() {
+  TEST_ASSERT_EQUAL_INT32(Q15::ONE, Q15(1.0f).rawValue());
+  TEST_ASSERT_EQUAL_INT32(-Q15::ONE / 2, Q15(-0.5f).rawValue());
+  TEST_ASSERT_EQUAL_INT32(1, Q15(0.6f / Q15::ONE).rawValue());
+  TEST_ASSERT_EQUAL_INT32(-1, Q15(-0.6f / Q15::ONE).rawValue());
+  TEST_ASSERT_EQUAL_INT32(3 * Q15::ONE, Q15(3).rawValue());
+  TEST_ASSERT_FLOAT_WITHIN(1.0f / Q15::ONE, 1.2345f, Q15(1.2345f).toFloat());
+}
+
+void test_q15_arithmetic() {
+  Q15 a(1.5f), b(-2.25f);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f / Q15::ONE, -0.75f, (a + b).toFloat());
+  TEST_ASSERT_FLOAT_WITHIN(1.0f / Q15::ONE, 3.75f, (a - b).toFloat());
+  TEST_ASSERT_FLOAT_WITHIN(2.0f / Q15::ONE, -3.375f, (a * b).toFloat());
+  TEST_ASSERT_FLOAT_WITHIN(2.0f / Q15::ONE, -0.6666667f, (a / b).toFloat());
+  TEST_ASSERT_TRUE(b < a);
+  TEST_ASSERT_TRUE(a >= a);
+  TEST_ASSERT_TRUE(-a == Q15(-1.5f));
+}
+
+// The bend window keeps a running sum: adding then removing the same samples must
+// land back on exactly zero, over a full 2000-sample window at +-8 G
+void test_q15_running_sum_is_exact() {
+  Q15 sum;
+  Q15 window[2000];
+  for (int i = 0; i < 2000; i++) {
+    window[i] = Q15((float)(8.0 * sin(i * 0.0137)));
+    sum += window[i];
+  }
+  for (int i = 0; i < 2000; i++) {
+    sum -= window[i];
+  }
+  TEST_ASSERT_EQUAL_INT32(0, sum.rawValue());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_float_math_bounds);
+  RUN_TEST(test_poly_math_bounds);
+  RUN_TEST(test_lut_math_bounds);
+  RUN_TEST(test_q15_math_bounds);
+  RUN_TEST(test_atan_table_matches_libm);
+  RUN_TEST(test_q15_rounds_to_nearest);
+  RUN_TEST(test_q15_arithmetic);
+  RUN_TEST(test_q15_running_sum_is_exact);
+  return UNITY_END();
+}
@@ -0,0 +1,168 @@
+// SpscQueue with a real producer and consumer on two std::threads: items arrive
+// whole and in order, every failed push is an overrun and a gap the consumer sees,
+// and the high-water mark tracks the deepest the queue got.
+// Run with:  pio test -e native -f test_spsc_queue
+
+#include <unity.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <SpscQueue.h>
+
+// Three words written from one value, so a torn copy shows up as a mismatch
+struct Item {
+  uint32_t seq;
+  uint32_t check;
+  uint64_t payload;
+};
+
+static Item makeItem(uint32_t seq) {
+  Item item;
+  item.seq = seq;
+  item.check = ~seq;
+  item.payload = (uint64_t)seq * 0x9E3779B97F4A7C15ULL;
+  return item;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_fifo_order_and_wrap_on_one_thread() {
+  SpscQueue<Item, 4> q;
+  Item out;
+  TEST_ASSERT_FALSE(q.pop(out));
+  for (uint32_t i = 0; i < 1000; i++) {
+    TEST_ASSERT_TRUE(q.push(makeItem(i)));
+    TEST_ASSERT_TRUE(q.push(makeItem(i + 1000000)));
+    TEST_ASSERT_TRUE(q.pop(out));
+    TEST_ASSERT_EQUAL_UINT32(i, out.seq);
+    TEST_ASSERT_TRUE(q.pop(out));
+    TEST_ASSERT_EQUAL_UINT32(i + 1000000, out.seq);
+  }
+  TEST_ASSERT_TRUE(q.empty());
+  TEST_ASSERT_EQUAL(2, q.highWaterMark());
+  TEST_ASSERT_EQUAL_UINT32(0, q.overruns());
+}
+
+void test_full_queue_counts_overruns() {
+  SpscQueue<Item, 8> q;
+  for (uint32_t i = 0; i < 8; i++) {
+    TEST_ASSERT_TRUE(q.push(makeItem(i)));
+  }
+  TEST_ASSERT_FALSE(q.push(makeItem(8)));
+  TEST_ASSERT_FALSE(q.push(makeItem(9)));
+  TEST_ASSERT_EQUAL_UINT32(2, q.overruns());
+  TEST_ASSERT_EQUAL(8, q.size());
+  TEST_ASSERT_EQUAL(8, q.highWaterMark());
+  // The items already queued are untouched by the failed pushes
+  Item out;
+  TEST_ASSERT_TRUE(q.pop(out));
+  TEST_ASSERT_EQUAL_UINT32(0, out.seq);
+  TEST_ASSERT_TRUE(q.push(makeItem(10)));
+  const uint32_t expect[] = {1, 2, 3, 4, 5, 6, 7, 10};
+  for (uint32_t seq : expect) {
+    TEST_ASSERT_TRUE(q.pop(out));
+    TEST_ASSERT_EQUAL_UINT32(seq, out.seq);
+  }
+}
+
+struct StressResult {
+  uint32_t accepted = 0;   // Pushes that succeeded
+  uint32_t refused = 0;    // Pushes that failed
+  uint32_t received = 0;
+  uint32_t gaps = 0;       // Sequence numbers the consumer never saw
+  uint32_t outOfOrder = 0;
+  uint32_t torn = 0;
+};
+
+// The producer pushes seq 0..count-1 once each, never retrying, like the sensing
+// task; the consumer optionally naps to force the queue full.
+template <size_t N>
+static StressResult stress(SpscQueue<Item, N>& q, uint32_t count, bool slowConsumer) {
+  StressResult r;
+  std::atomic<bool> done{false};
+
+  std::thread consumer([&]() {
+    uint32_t expected = 0;
+    uint32_t spins = 0;
+    Item item;
+    while (true) {
+      if (!q.pop(item)) {
+        if (done.load(std::memory_order_acquire) && q.empty()) {
+          break;
+        }
+        std::this_thread::yield();
+        continue;
+      }
+      r.received++;
+      if (item.check != ~item.seq || item.payload != (uint64_t)item.seq * 0x9E3779B97F4A7C15ULL) {
+        r.torn++;
+      }
+      if (item.seq < expected) {
+        r.outOfOrder++;
+      } else {
+        r.gaps += item.seq - expected;
+        expected = item.seq + 1;
+      }
+      if (slowConsumer && ++spins % 1024 == 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+      }
+    }
+    r.gaps += count - expected;
+  });
+
+  std::thread producer([&]() {
+    for (uint32_t seq = 0; seq < count; seq++) {
+      if (q.push(makeItem(seq))) {
+        r.accepted++;
+      } else {
+        r.refused++;
+      }
+    }
+    done.store(true, std::memory_order_release);
+  });
+
+  producer.join();
+  consumer.join();
+  return r;
+}
+
+void test_threads_keep_order_and_account_for_every_item() {
+  SpscQueue<Item, 64> q;
+  const uint32_t count = 2000000;
+  StressResult r = stress(q, count, false);
+  TEST_ASSERT_EQUAL_UINT32(0, r.torn);
+  TEST_ASSERT_EQUAL_UINT32(0, r.outOfOrder);
+  TEST_ASSERT_EQUAL_UINT32(count, r.accepted + r.refused);
+  TEST_ASSERT_EQUAL_UINT32(r.accepted, r.received);
+  TEST_ASSERT_EQUAL_UINT32(r.refused, q.overruns());
+  TEST_ASSERT_EQUAL_UINT32(r.refused, r.gaps);
+  TEST_ASSERT_TRUE(q.empty());
+  TEST_ASSERT_GREATER_OR_EQUAL(1, q.highWaterMark());
+  TEST_ASSERT_LESS_OR_EQUAL(64, q.highWaterMark());
+}
+
+void test_slow_consumer_overruns_and_hits_the_high_water_mark() {
+  SpscQueue<Item, 16> q;
+  const uint32_t count = 500000;
+  StressResult r = stress(q, count, true);
+  TEST_ASSERT_EQUAL_UINT32(0, r.torn);
+  TEST_ASSERT_EQUAL_UINT32(0, r.outOfOrder);
+  TEST_ASSERT_GREATER_THAN(0, r.refused);
+  TEST_ASSERT_EQUAL_UINT32(r.refused, q.overruns());
+  TEST_ASSERT_EQUAL_UINT32(r.refused, r.gaps);
+  TEST_ASSERT_EQUAL_UINT32(r.accepted, r.received);
+  TEST_ASSERT_EQUAL(16, q.highWaterMark());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_fifo_order_and_wrap_on_one_thread);
+  RUN_TEST(test_full_queue_counts_overruns);
+  RUN_TEST(test_threads_keep_order_and_account_for_every_item);
+  RUN_TEST(test_slow_consumer_overruns_and_hits_the_high_water_mark);
+  return UNITY_END();
+}
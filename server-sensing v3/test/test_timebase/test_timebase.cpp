@@ -0,0 +1,126 @@
+// Timebase against a simulated drifting local clock: drift is measured from the
+// syncs, small offsets are slewed out at the capped rate, large ones are stepped,
+// and the mapped time never goes backwards across a resync.
+// Run with:  pio test -e native -f test_timebase
+
+#include <unity.h>
+
+#include <Timebase.h>
+
+static const uint64_t EPOCH_AT_START = 1700000000000000ULL;
+static const uint64_t BOOT_MICROS = 3000000; // Local clock when true time starts
+
+// Local microseconds at true time t, on a clock that gains driftPpm
+static uint64_t localAt(uint64_t t, double driftPpm) {
+  return BOOT_MICROS + (uint64_t)(t * (1 + driftPpm * 1e-6));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_unsynced_reads_zero() {
+  Timebase tb;
+  TEST_ASSERT_FALSE(tb.synced());
+  TEST_ASSERT_EQUAL_UINT64(0, tb.epochMicros(BOOT_MICROS));
+  tb.sync(BOOT_MICROS, EPOCH_AT_START);
+  TEST_ASSERT_TRUE(tb.synced());
+  tb.reset();
+  TEST_ASSERT_FALSE(tb.synced());
+  TEST_ASSERT_EQUAL_UINT64(0, tb.epochMicros(BOOT_MICROS));
+}
+
+void test_first_sync_anchors_the_mapping() {
+  Timebase tb;
+  tb.sync(BOOT_MICROS, EPOCH_AT_START);
+  TEST_ASSERT_EQUAL_UINT64(EPOCH_AT_START, tb.epochMicros(BOOT_MICROS));
+  TEST_ASSERT_EQUAL_UINT64(EPOCH_AT_START + 1000000, tb.epochMicros(BOOT_MICROS + 1000000));
+  TEST_ASSERT_EQUAL_UINT32(1, tb.syncCount());
+  TEST_ASSERT_EQUAL_INT32(0, tb.driftPpb());
+}
+
+// A clock gaining 100 ppm needs a correction of about -100 ppm, measured over one
+// sync interval, after which the mapping tracks true time
+void test_drift_is_measured_and_corrected() {
+  const double drift = 100;
+  const uint64_t interval = 600000000ULL;
+  Timebase tb;
+  tb.sync(localAt(0, drift), EPOCH_AT_START);
+  tb.sync(localAt(interval, drift), EPOCH_AT_START + interval);
+  TEST_ASSERT_INT32_WITHIN(20, -99990, tb.driftPpb());
+  TEST_ASSERT_EQUAL_UINT32(0, tb.stepCount());
+
+  // The 60 ms gained before the drift was known is halved at each sync; two hours
+  // of syncs later, and an hour after the last one, the mapping is still close
+  for (uint64_t n = 2; n <= 12; n++) {
+    tb.sync(localAt(n * interval, drift), EPOCH_AT_START + n * interval);
+  }
+  uint64_t t = 12 * interval + 3600000000ULL;
+  int64_t error = (int64_t)(tb.epochMicros(localAt(t, drift)) - (EPOCH_AT_START + t));
+  TEST_ASSERT_INT64_WITHIN(100, 0, error);
+}
+
+// An offset under the step threshold: the output doesn't jump at the sync, then
+// half the error is worked off at TIMEBASE_MAX_SLEW_PPB
+void test_small_offset_is_slewed() {
+  Timebase tb;
+  tb.sync(BOOT_MICROS, EPOCH_AT_START);
+  // Ten seconds on, too soon to count as drift, the reference is 100 ms ahead
+  uint64_t local = BOOT_MICROS + 10000000;
+  tb.sync(local, EPOCH_AT_START + 10000000 + 100000);
+  TEST_ASSERT_EQUAL_INT64(100000, tb.lastErrorMicros());
+  TEST_ASSERT_EQUAL_UINT32(0, tb.stepCount());
+  TEST_ASSERT_EQUAL_INT32(0, tb.driftPpb());
+  TEST_ASSERT_EQUAL_UINT64(EPOCH_AT_START + 10000000, tb.epochMicros(local));
+
+  // 50 s in: 50 s at 500 ppm is 25 ms of the 50 ms being slewed
+  uint64_t at = local + 50000000;
+  TEST_ASSERT_EQUAL_UINT64(EPOCH_AT_START + 60000000 + 25000, tb.epochMicros(at));
+  // The slew ends after 100 s and the mapping runs at the plain rate again
+  at = local + 200000000;
+  TEST_ASSERT_EQUAL_UINT64(EPOCH_AT_START + 210000000 + 50000, tb.epochMicros(at));
+}
+
+void test_large_offset_is_stepped() {
+  Timebase tb;
+  tb.sync(BOOT_MICROS, EPOCH_AT_START);
+  uint64_t local = BOOT_MICROS + 10000000;
+  uint64_t reference = EPOCH_AT_START + 10000000 + 2000000;
+  tb.sync(local, reference);
+  TEST_ASSERT_EQUAL_UINT32(1, tb.stepCount());
+  TEST_ASSERT_EQUAL_INT64(2000000, tb.lastErrorMicros());
+  TEST_ASSERT_EQUAL_UINT64(reference, tb.epochMicros(local));
+  TEST_ASSERT_EQUAL_UINT64(reference + 1000, tb.epochMicros(local + 1000));
+}
+
+// Reference answers alternately ahead and behind, on a drifting clock: stamps taken
+// every millisecond never go backwards, including right across each sync
+void test_output_is_monotonic_across_resyncs() {
+  const double drift = -40;
+  const uint64_t interval = 90000000ULL;
+  Timebase tb;
+  uint64_t last = 0;
+  int sign = 1;
+  for (uint64_t t = 0; t < 20 * interval; t += 1000) {
+    if (t % interval == 0) {
+      int64_t offset = t == 0 ? 0 : sign * 300000; // Under the step threshold
+      sign = -sign;
+      tb.sync(localAt(t, drift), (uint64_t)((int64_t)(EPOCH_AT_START + t) + offset));
+    }
+    uint64_t stamp = tb.epochMicros(localAt(t, drift));
+    TEST_ASSERT_TRUE(stamp >= last);
+    last = stamp;
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, tb.stepCount());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_unsynced_reads_zero);
+  RUN_TEST(test_first_sync_anchors_the_mapping);
+  RUN_TEST(test_drift_is_measured_and_corrected);
+  RUN_TEST(test_small_offset_is_slewed);
+  RUN_TEST(test_large_offset_is_stepped);
+  RUN_TEST(test_output_is_monotonic_across_resyncs);
+  return UNITY_END();
+}